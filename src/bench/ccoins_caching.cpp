@@ -5,9 +5,15 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <primitives/block.h>
+#include <random.h>
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <validation.h>
 
+#include <algorithm>
 #include <vector>
 
 // Microbenchmark for simple accesses to a CCoinsViewCache database. Note from
@@ -52,3 +58,58 @@ static void CCoinsCaching(benchmark::Bench& bench)
 }
 
 BENCHMARK(CCoinsCaching);
+
+// Microbenchmark for loading the inputs of a block into an empty
+// CCoinsViewCache from the coins database, either one by one through
+// AccessCoin() or warmed ahead of time by PrefetchBlockInputs().
+static void CCoinsCachingBlockInputs(benchmark::Bench& bench, bool prefetch)
+{
+    static constexpr int NUM_TXS = 500;
+    static constexpr int INPUTS_PER_TX = 4;
+
+    CCoinsViewDB db{"coinsbench", 8 << 20, /* fMemory */ true, /* fWipe */ true};
+    FastRandomContext rng{/* fDeterministic */ true};
+
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    {
+        CCoinsViewCache setup{&db};
+        for (int i = 0; i < NUM_TXS; ++i) {
+            CMutableTransaction tx;
+            for (int j = 0; j < INPUTS_PER_TX; ++j) {
+                const COutPoint prevout{rng.rand256(), (uint32_t)j};
+                setup.AddCoin(prevout, Coin{CTxOut{COIN, CScript() << OP_TRUE}, 1, false}, false);
+                tx.vin.emplace_back(prevout);
+            }
+            tx.vout.emplace_back(INPUTS_PER_TX * COIN, CScript() << OP_TRUE);
+            block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        setup.SetBestBlock(rng.rand256());
+        setup.Flush();
+    }
+
+    if (prefetch) StartScriptCheckWorkerThreads(std::max(GetNumCores() - 1, 0));
+    bench.batch(NUM_TXS * INPUTS_PER_TX).unit("txin").run([&] {
+        CCoinsViewCache cache{&db};
+        if (prefetch) {
+            const CoinsPrefetchStats stats = PrefetchBlockInputs(block, cache, db);
+            assert(stats.fetched == NUM_TXS * INPUTS_PER_TX);
+        }
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                assert(!cache.AccessCoin(txin.prevout).IsSpent());
+            }
+        }
+    });
+    if (prefetch) StopScriptCheckWorkerThreads();
+}
+
+static void CCoinsCachingBlockInputsSerial(benchmark::Bench& bench) { CCoinsCachingBlockInputs(bench, false); }
+static void CCoinsCachingBlockInputsPrefetch(benchmark::Bench& bench) { CCoinsCachingBlockInputs(bench, true); }
+
+BENCHMARK(CCoinsCachingBlockInputsSerial);
+BENCHMARK(CCoinsCachingBlockInputsPrefetch);
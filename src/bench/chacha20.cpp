@@ -9,6 +9,7 @@
 /* Number of bytes to process per iteration */
 static const uint64_t BUFFER_SIZE_TINY  = 64;
 static const uint64_t BUFFER_SIZE_SMALL = 256;
+static const uint64_t BUFFER_SIZE_MEDIUM = 4096;
 static const uint64_t BUFFER_SIZE_LARGE = 1024*1024;
 
 static void CHACHA20(benchmark::Bench& bench, size_t buffersize)
@@ -24,6 +25,18 @@ static void CHACHA20(benchmark::Bench& bench, size_t buffersize)
     });
 }
 
+static void CHACHA20_KEYSTREAM(benchmark::Bench& bench, size_t buffersize)
+{
+    std::vector<uint8_t> key(32,0);
+    ChaCha20 ctx(key.data(), key.size());
+    ctx.SetIV(0);
+    ctx.Seek(0);
+    std::vector<uint8_t> out(buffersize,0);
+    bench.batch(out.size()).unit("byte").run([&] {
+        ctx.Keystream(out.data(), out.size());
+    });
+}
+
 static void CHACHA20_64BYTES(benchmark::Bench& bench)
 {
     CHACHA20(bench, BUFFER_SIZE_TINY);
@@ -34,11 +47,29 @@ static void CHACHA20_256BYTES(benchmark::Bench& bench)
     CHACHA20(bench, BUFFER_SIZE_SMALL);
 }
 
+static void CHACHA20_4KB(benchmark::Bench& bench)
+{
+    CHACHA20(bench, BUFFER_SIZE_MEDIUM);
+}
+
 static void CHACHA20_1MB(benchmark::Bench& bench)
 {
     CHACHA20(bench, BUFFER_SIZE_LARGE);
 }
 
+static void CHACHA20_KEYSTREAM_64BYTES(benchmark::Bench& bench)
+{
+    CHACHA20_KEYSTREAM(bench, BUFFER_SIZE_TINY);
+}
+
+static void CHACHA20_KEYSTREAM_4KB(benchmark::Bench& bench)
+{
+    CHACHA20_KEYSTREAM(bench, BUFFER_SIZE_MEDIUM);
+}
+
 BENCHMARK(CHACHA20_64BYTES);
 BENCHMARK(CHACHA20_256BYTES);
+BENCHMARK(CHACHA20_4KB);
 BENCHMARK(CHACHA20_1MB);
+BENCHMARK(CHACHA20_KEYSTREAM_64BYTES);
+BENCHMARK(CHACHA20_KEYSTREAM_4KB);
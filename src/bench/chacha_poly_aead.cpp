@@ -14,6 +14,7 @@
 /* Number of bytes to process per iteration */
 static constexpr uint64_t BUFFER_SIZE_TINY = 64;
 static constexpr uint64_t BUFFER_SIZE_SMALL = 256;
+static constexpr uint64_t BUFFER_SIZE_MEDIUM = 4096;
 static constexpr uint64_t BUFFER_SIZE_LARGE = 1024 * 1024;
 
 static const unsigned char k1[32] = {0};
@@ -69,6 +70,11 @@ static void CHACHA20_POLY1305_AEAD_256BYTES_ONLY_ENCRYPT(benchmark::Bench& bench
     CHACHA20_POLY1305_AEAD(bench, BUFFER_SIZE_SMALL, false);
 }
 
+static void CHACHA20_POLY1305_AEAD_4KB_ONLY_ENCRYPT(benchmark::Bench& bench)
+{
+    CHACHA20_POLY1305_AEAD(bench, BUFFER_SIZE_MEDIUM, false);
+}
+
 static void CHACHA20_POLY1305_AEAD_1MB_ONLY_ENCRYPT(benchmark::Bench& bench)
 {
     CHACHA20_POLY1305_AEAD(bench, BUFFER_SIZE_LARGE, false);
@@ -84,6 +90,11 @@ static void CHACHA20_POLY1305_AEAD_256BYTES_ENCRYPT_DECRYPT(benchmark::Bench& be
     CHACHA20_POLY1305_AEAD(bench, BUFFER_SIZE_SMALL, true);
 }
 
+static void CHACHA20_POLY1305_AEAD_4KB_ENCRYPT_DECRYPT(benchmark::Bench& bench)
+{
+    CHACHA20_POLY1305_AEAD(bench, BUFFER_SIZE_MEDIUM, true);
+}
+
 static void CHACHA20_POLY1305_AEAD_1MB_ENCRYPT_DECRYPT(benchmark::Bench& bench)
 {
     CHACHA20_POLY1305_AEAD(bench, BUFFER_SIZE_LARGE, true);
@@ -117,9 +128,11 @@ static void HASH_1MB(benchmark::Bench& bench)
 
 BENCHMARK(CHACHA20_POLY1305_AEAD_64BYTES_ONLY_ENCRYPT);
 BENCHMARK(CHACHA20_POLY1305_AEAD_256BYTES_ONLY_ENCRYPT);
+BENCHMARK(CHACHA20_POLY1305_AEAD_4KB_ONLY_ENCRYPT);
 BENCHMARK(CHACHA20_POLY1305_AEAD_1MB_ONLY_ENCRYPT);
 BENCHMARK(CHACHA20_POLY1305_AEAD_64BYTES_ENCRYPT_DECRYPT);
 BENCHMARK(CHACHA20_POLY1305_AEAD_256BYTES_ENCRYPT_DECRYPT);
+BENCHMARK(CHACHA20_POLY1305_AEAD_4KB_ENCRYPT_DECRYPT);
 BENCHMARK(CHACHA20_POLY1305_AEAD_1MB_ENCRYPT_DECRYPT);
 BENCHMARK(HASH_64BYTES);
 BENCHMARK(HASH_256BYTES);
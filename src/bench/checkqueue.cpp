@@ -4,10 +4,12 @@
 
 #include <bench/bench.h>
 #include <checkqueue.h>
+#include <crypto/sha256.h>
 #include <key.h>
 #include <prevector.h>
 #include <pubkey.h>
 #include <random.h>
+#include <uint256.h>
 #include <util/system.h>
 
 #include <vector>
@@ -16,6 +18,8 @@ static const size_t BATCHES = 101;
 static const size_t BATCH_SIZE = 30;
 static const int PREVECTOR_SIZE = 28;
 static const unsigned int QUEUE_BATCH_SIZE = 128;
+static const size_t SCALING_CHECKS = 4000;
+static const int SCALING_HASHES = 16;
 
 // This Benchmark tests the CheckQueue with a slightly realistic workload,
 // where checks all contain a prevector that is indirect 50% of the time
@@ -69,3 +73,62 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
     ECC_Stop();
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+
+// This Benchmark measures how the CheckQueue scales with the number of worker
+// threads, using checks that each do a fixed amount of hashing (roughly the
+// cost of a cheap signature check). Unlike the benchmark above it does not
+// look at the number of available cores, so runs on a large machine can be
+// compared against each other.
+static void CCheckQueueScaling(benchmark::Bench& bench, int worker_threads)
+{
+    struct HashJob {
+        uint256 hash;
+        HashJob() = default;
+        explicit HashJob(FastRandomContext& insecure_rand) : hash{insecure_rand.rand256()} {}
+        bool operator()()
+        {
+            uint256 out{hash};
+            for (int i = 0; i < SCALING_HASHES; ++i) {
+                CSHA256().Write(out.begin(), out.size()).Finalize(out.begin());
+            }
+            return out != uint256::ZERO;
+        }
+        void swap(HashJob& x) { std::swap(hash, x.hash); }
+    };
+    CCheckQueue<HashJob> queue{QUEUE_BATCH_SIZE};
+    queue.StartWorkerThreads(worker_threads);
+
+    // Submit the checks in transaction sized batches, like ConnectBlock does.
+    FastRandomContext insecure_rand(true);
+    std::vector<std::vector<HashJob>> vBatches(SCALING_CHECKS / BATCH_SIZE);
+    for (auto& vChecks : vBatches) {
+        vChecks.reserve(BATCH_SIZE);
+        for (size_t x = 0; x < BATCH_SIZE; ++x)
+            vChecks.emplace_back(insecure_rand);
+    }
+
+    bench.batch(BATCH_SIZE * vBatches.size()).unit("job").run([&] {
+        CCheckQueueControl<HashJob> control(&queue);
+        for (auto vChecks : vBatches) {
+            control.Add(vChecks);
+        }
+        assert(control.Wait());
+    });
+    queue.StopWorkerThreads();
+}
+
+static void CCheckQueueScaling1Thread(benchmark::Bench& bench) { CCheckQueueScaling(bench, 0); }
+static void CCheckQueueScaling2Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 1); }
+static void CCheckQueueScaling4Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 3); }
+static void CCheckQueueScaling8Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 7); }
+static void CCheckQueueScaling16Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 15); }
+static void CCheckQueueScaling32Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 31); }
+static void CCheckQueueScaling64Threads(benchmark::Bench& bench) { CCheckQueueScaling(bench, 63); }
+
+BENCHMARK(CCheckQueueScaling1Thread);
+BENCHMARK(CCheckQueueScaling2Threads);
+BENCHMARK(CCheckQueueScaling4Threads);
+BENCHMARK(CCheckQueueScaling8Threads);
+BENCHMARK(CCheckQueueScaling16Threads);
+BENCHMARK(CCheckQueueScaling32Threads);
+BENCHMARK(CCheckQueueScaling64Threads);
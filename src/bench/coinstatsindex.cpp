@@ -0,0 +1,42 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <index/coinstatsindex.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+// Time a full coinstatsindex sync of a small regtest chain: 100 blocks with
+// only a coinbase, then 100 blocks that each also spend an earlier coinbase,
+// so that half of the blocks need a MuHash division when finalized.
+static void CoinStatsIndexSync(benchmark::Bench& bench)
+{
+    const auto test_setup = std::make_unique<TestChain100Setup>();
+
+    const CScript script_pub_key{CScript() << ToByteVector(test_setup->coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+    const std::vector<CTransactionRef> coinbase_txns{test_setup->m_coinbase_txns};
+    for (size_t i = 0; i < coinbase_txns.size(); ++i) {
+        const CMutableTransaction spend = test_setup->CreateValidMempoolTransaction(
+            coinbase_txns[i], 0, i + 1, test_setup->coinbaseKey, script_pub_key, 1 * COIN, /* submit */ false);
+        test_setup->CreateAndProcessBlock({spend}, script_pub_key);
+    }
+    CChainState& chainstate = test_setup->m_node.chainman->ActiveChainstate();
+
+    bench.epochs(5).epochIterations(1).run([&] {
+        CoinStatsIndex index{1 << 20, /* f_memory */ true};
+        const bool started = index.Start(chainstate);
+        assert(started);
+        while (!index.BlockUntilSyncedToCurrentChain()) {
+            UninterruptibleSleep(std::chrono::milliseconds{1});
+        }
+        index.Stop();
+    });
+}
+
+BENCHMARK(CoinStatsIndexSync);
@@ -72,6 +72,31 @@ static void SHA256D64_1024(benchmark::Bench& bench)
     });
 }
 
+/* Hash 1024 messages of a typical transaction size, one by one... */
+static void SHA256_1024x250b(benchmark::Bench& bench)
+{
+    std::vector<uint8_t> in(250 * 1024, 0);
+    std::vector<uint8_t> out(32 * 1024);
+    bench.batch(in.size()).unit("byte").run([&] {
+        for (size_t i = 0; i < 1024; ++i) {
+            CSHA256().Write(in.data() + 250 * i, 250).Finalize(out.data() + 32 * i);
+        }
+    });
+}
+
+/* ...and in the SIMD lanes. */
+static void SHA256Multi_1024x250b(benchmark::Bench& bench)
+{
+    std::vector<uint8_t> in(250 * 1024, 0);
+    std::vector<uint8_t> out(32 * 1024);
+    std::vector<const unsigned char*> inputs;
+    for (size_t i = 0; i < 1024; ++i) inputs.push_back(in.data() + 250 * i);
+    const std::vector<size_t> lengths(1024, 250);
+    bench.batch(in.size()).unit("byte").run([&] {
+        SHA256Multi(out.data(), inputs.data(), lengths.data(), 1024);
+    });
+}
+
 static void SHA512(benchmark::Bench& bench)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -143,6 +168,20 @@ static void MuHashDiv(benchmark::Bench& bench)
     });
 }
 
+static void MuHashFinalize(benchmark::Bench& bench)
+{
+    FastRandomContext rng(true);
+    MuHash3072 acc{rng.randbytes(32)};
+    acc /= MuHash3072{rng.randbytes(32)};
+
+    bench.run([&] {
+        // Finalize collapses the fraction, so start from a copy every time.
+        MuHash3072 muhash{acc};
+        uint256 out;
+        muhash.Finalize(out);
+    });
+}
+
 static void MuHashPrecompute(benchmark::Bench& bench)
 {
     MuHash3072 acc;
@@ -163,10 +202,13 @@ BENCHMARK(SHA3_256_1M);
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
 BENCHMARK(SHA256D64_1024);
+BENCHMARK(SHA256_1024x250b);
+BENCHMARK(SHA256Multi_1024x250b);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
 
 BENCHMARK(MuHash);
 BENCHMARK(MuHashMul);
 BENCHMARK(MuHashDiv);
+BENCHMARK(MuHashFinalize);
 BENCHMARK(MuHashPrecompute);
@@ -0,0 +1,89 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <consensus/consensus.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <script/sigcache.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
+#include <test/util/mining.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <map>
+#include <vector>
+
+/** Number of inputs of the transaction accepted in the benchmark */
+static constexpr size_t NUM_INPUTS{200};
+
+static CMutableTransaction SpendTo(const std::map<COutPoint, Coin>& coins, size_t num_outputs, const CScript& script, const SigningProvider& keystore)
+{
+    CMutableTransaction mtx;
+    CAmount total{0};
+    for (const auto& [outpoint, coin] : coins) {
+        mtx.vin.emplace_back(outpoint);
+        total += coin.out.nValue;
+    }
+    // Pay well above the minimum relay feerate for any number of inputs and outputs.
+    const CAmount fee = 1000 * (coins.size() + num_outputs);
+    mtx.vout.assign(num_outputs, CTxOut((total - fee) / num_outputs, script));
+    std::map<int, std::string> input_errors;
+    bool signed_ok = SignTransaction(mtx, &keystore, coins, SIGHASH_ALL, input_errors);
+    assert(signed_ok);
+    return mtx;
+}
+
+static void MempoolAcceptManyInputs(benchmark::Bench& bench, bool parallel)
+{
+    // The signature cache is cleared before each run, so that the scripts
+    // are verified every time. Keep it small, so that clearing it is cheap.
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::REGTEST, {"-maxsigcachesize=1"});
+    CChainState& chainstate = test_setup->m_node.chainman->ActiveChainstate();
+    CTxMemPool& pool = *test_setup->m_node.mempool;
+
+    CKey key;
+    key.MakeNewKey(true);
+    FillableSigningProvider keystore;
+    keystore.AddKey(key);
+    const CScript p2wpkh = GetScriptForDestination(WitnessV0KeyHash(key.GetPubKey()));
+
+    // Split a mature coinbase into NUM_INPUTS outputs, all of which are spent
+    // by the transaction accepted in the benchmark.
+    const COutPoint coinbase_out = MineBlock(test_setup->m_node, p2wpkh).prevout;
+    for (int i = 0; i < COINBASE_MATURITY; ++i) {
+        MineBlock(test_setup->m_node, p2wpkh);
+    }
+    const Coin coinbase_coin = WITH_LOCK(::cs_main, return chainstate.CoinsTip().AccessCoin(coinbase_out));
+    const CTransactionRef split = MakeTransactionRef(SpendTo({{coinbase_out, coinbase_coin}}, NUM_INPUTS, p2wpkh, keystore));
+    std::map<COutPoint, Coin> split_coins;
+    for (uint32_t n = 0; n < split->vout.size(); ++n) {
+        split_coins.emplace(COutPoint(split->GetHash(), n), Coin(split->vout[n], MEMPOOL_HEIGHT, false));
+    }
+    const CTransactionRef tx = MakeTransactionRef(SpendTo(split_coins, 1, p2wpkh, keystore));
+    {
+        LOCK(::cs_main);
+        const MempoolAcceptResult res = ::AcceptToMemoryPool(chainstate, pool, split, false /* bypass_limits */);
+        assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+    }
+
+    const bool parallel_script_checks = g_parallel_script_checks;
+    g_parallel_script_checks = parallel;
+    bench.unit("input").batch(NUM_INPUTS).run([&] {
+        InitSignatureCache();
+        LOCK(::cs_main);
+        const MempoolAcceptResult res = ::AcceptToMemoryPool(chainstate, pool, tx, false /* bypass_limits */, true /* test_accept */);
+        assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+    });
+    g_parallel_script_checks = parallel_script_checks;
+}
+
+static void MempoolAcceptManyInputsSerial(benchmark::Bench& bench) { MempoolAcceptManyInputs(bench, false); }
+static void MempoolAcceptManyInputsParallel(benchmark::Bench& bench) { MempoolAcceptManyInputs(bench, true); }
+
+BENCHMARK(MempoolAcceptManyInputsSerial);
+BENCHMARK(MempoolAcceptManyInputsParallel);
@@ -26,7 +26,7 @@ struct Available {
     Available(CTransactionRef& ref, size_t tx_count) : ref(ref), tx_count(tx_count){}
 };
 
-static void ComplexMemPool(benchmark::Bench& bench)
+static void RunComplexMemPool(benchmark::Bench& bench, bool track_clusters)
 {
     int childTxs = 800;
     if (bench.complexityN() > 1) {
@@ -80,7 +80,7 @@ static void ComplexMemPool(benchmark::Bench& bench)
         available_coins.emplace_back(ordered_coins.back(), tx_counter++);
     }
     const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::MAIN);
-    CTxMemPool pool;
+    CTxMemPool pool(/* estimator */ nullptr, /* check_ratio */ 0, track_clusters);
     LOCK2(cs_main, pool.cs);
     bench.run([&]() NO_THREAD_SAFETY_ANALYSIS {
         for (auto& tx : ordered_coins) {
@@ -91,4 +91,15 @@ static void ComplexMemPool(benchmark::Bench& bench)
     });
 }
 
+static void ComplexMemPool(benchmark::Bench& bench)
+{
+    RunComplexMemPool(bench, /* track_clusters */ false);
+}
+
+static void ComplexMemPoolClusters(benchmark::Bench& bench)
+{
+    RunComplexMemPool(bench, /* track_clusters */ true);
+}
+
 BENCHMARK(ComplexMemPool);
+BENCHMARK(ComplexMemPoolClusters);
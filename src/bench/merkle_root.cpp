@@ -3,10 +3,18 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <bench/data.h>
 
 #include <consensus/merkle.h>
+#include <crypto/sha256.h>
+#include <hash.h>
+#include <primitives/block.h>
 #include <random.h>
+#include <streams.h>
 #include <uint256.h>
+#include <version.h>
+
+#include <cassert>
 
 static void MerkleRoot(benchmark::Bench& bench)
 {
@@ -23,4 +31,59 @@ static void MerkleRoot(benchmark::Bench& bench)
     });
 }
 
+/** The serialized transactions (without witness) of a real block, to hash into txids. */
+struct BlockTxs {
+    CBlock block;
+    std::vector<std::vector<unsigned char>> txs;
+
+    BlockTxs()
+    {
+        CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
+        stream >> block;
+        for (const auto& tx : block.vtx) {
+            CDataStream ser(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+            ser << *tx;
+            txs.emplace_back(UCharCast(ser.data()), UCharCast(ser.data() + ser.size()));
+        }
+    }
+};
+
+/* Compute the txids of a block one by one, and its merkle root from them... */
+static void MerkleRootBlockTxids(benchmark::Bench& bench)
+{
+    const BlockTxs data;
+    std::vector<uint256> leaves(data.txs.size());
+    bench.batch(leaves.size()).unit("tx").run([&] {
+        for (size_t i = 0; i < data.txs.size(); ++i) {
+            CHash256().Write(data.txs[i]).Finalize(leaves[i]);
+        }
+        assert(ComputeMerkleRoot(leaves) == data.block.hashMerkleRoot);
+    });
+}
+
+/* ...and with the txids computed in the SIMD lanes. */
+static void MerkleRootBlockTxidsMulti(benchmark::Bench& bench)
+{
+    const BlockTxs data;
+    const size_t count = data.txs.size();
+    std::vector<const unsigned char*> inputs;
+    std::vector<size_t> lengths;
+    for (const auto& tx : data.txs) {
+        inputs.push_back(tx.data());
+        lengths.push_back(tx.size());
+    }
+    std::vector<unsigned char> single(32 * count);
+    std::vector<const unsigned char*> single_inputs;
+    for (size_t i = 0; i < count; ++i) single_inputs.push_back(single.data() + 32 * i);
+    const std::vector<size_t> single_lengths(count, 32);
+    std::vector<uint256> leaves(count);
+    bench.batch(leaves.size()).unit("tx").run([&] {
+        SHA256Multi(single.data(), inputs.data(), lengths.data(), count);
+        SHA256Multi(leaves.data()->begin(), single_inputs.data(), single_lengths.data(), count);
+        assert(ComputeMerkleRoot(leaves) == data.block.hashMerkleRoot);
+    });
+}
+
 BENCHMARK(MerkleRoot);
+BENCHMARK(MerkleRootBlockTxids);
+BENCHMARK(MerkleRootBlockTxidsMulti);
@@ -9,6 +9,7 @@
 /* Number of bytes to process per iteration */
 static constexpr uint64_t BUFFER_SIZE_TINY  = 64;
 static constexpr uint64_t BUFFER_SIZE_SMALL = 256;
+static constexpr uint64_t BUFFER_SIZE_MEDIUM = 4096;
 static constexpr uint64_t BUFFER_SIZE_LARGE = 1024*1024;
 
 static void POLY1305(benchmark::Bench& bench, size_t buffersize)
@@ -31,6 +32,11 @@ static void POLY1305_256BYTES(benchmark::Bench& bench)
     POLY1305(bench, BUFFER_SIZE_SMALL);
 }
 
+static void POLY1305_4KB(benchmark::Bench& bench)
+{
+    POLY1305(bench, BUFFER_SIZE_MEDIUM);
+}
+
 static void POLY1305_1MB(benchmark::Bench& bench)
 {
     POLY1305(bench, BUFFER_SIZE_LARGE);
@@ -38,4 +44,5 @@ static void POLY1305_1MB(benchmark::Bench& bench)
 
 BENCHMARK(POLY1305_64BYTES);
 BENCHMARK(POLY1305_256BYTES);
+BENCHMARK(POLY1305_4KB);
 BENCHMARK(POLY1305_1MB);
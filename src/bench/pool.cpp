@@ -0,0 +1,93 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <random.h>
+#include <support/allocators/pool.h>
+
+#include <unordered_map>
+#include <vector>
+
+template <typename Map>
+void BenchFillClearMap(benchmark::Bench& bench, Map& map)
+{
+    size_t batch_size = 5000;
+
+    // make sure each iteration of the benchmark contains exactly 5000 inserts and one clear.
+    // do this at least 10 times so we get reasonable accurate results
+
+    bench.batch(batch_size).run([&] {
+        auto rng = ankerl::nanobench::Rng(1234);
+        for (size_t i = 0; i < batch_size; ++i) {
+            map[rng()];
+        }
+        map.clear();
+    });
+}
+
+static void PoolAllocator_StdUnorderedMap(benchmark::Bench& bench)
+{
+    auto map = std::unordered_map<uint64_t, uint64_t>();
+    BenchFillClearMap(bench, map);
+}
+
+static void PoolAllocator_StdUnorderedMapWithPoolResource(benchmark::Bench& bench)
+{
+    using Map = std::unordered_map<uint64_t,
+                                   uint64_t,
+                                   std::hash<uint64_t>,
+                                   std::equal_to<uint64_t>,
+                                   PoolAllocator<std::pair<const uint64_t, uint64_t>,
+                                                 sizeof(std::pair<const uint64_t, uint64_t>) + 4 * sizeof(void*)>>;
+
+    // make sure the resource supports large enough pools to hold the node. We do this by adding the size of a few pointers to it.
+    auto pool_resource = Map::allocator_type::ResourceType();
+    auto map = Map{0, std::hash<uint64_t>{}, std::equal_to<uint64_t>{}, &pool_resource};
+    BenchFillClearMap(bench, map);
+}
+
+using StdCoinsMap = std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher>;
+
+// Random lookups into a map holding many coins, to compare the lookup latency
+// of the node-per-malloc map against the pool-allocated CCoinsMap, whose nodes
+// are packed densely in a few large chunks.
+template <typename Map>
+void BenchCoinsMapLookup(benchmark::Bench& bench, Map& map)
+{
+    static constexpr uint32_t NUM_COINS = 200000;
+    FastRandomContext rng{/* fDeterministic */ true};
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(NUM_COINS);
+    for (uint32_t i = 0; i < NUM_COINS; ++i) {
+        outpoints.emplace_back(rng.rand256(), i);
+        map.emplace(outpoints.back(), CCoinsCacheEntry{});
+    }
+
+    size_t pos = 0;
+    bench.run([&] {
+        pos = (pos + 7919) % NUM_COINS;
+        auto it = map.find(outpoints[pos]);
+        assert(it != map.end());
+        ankerl::nanobench::doNotOptimizeAway(it->second.flags);
+    });
+}
+
+static void CoinsMapLookup_StdAllocator(benchmark::Bench& bench)
+{
+    StdCoinsMap map;
+    BenchCoinsMapLookup(bench, map);
+}
+
+static void CoinsMapLookup_PoolAllocator(benchmark::Bench& bench)
+{
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, SaltedOutpointHasher{}, CCoinsMap::key_equal{}, &resource};
+    BenchCoinsMapLookup(bench, map);
+}
+
+BENCHMARK(PoolAllocator_StdUnorderedMap);
+BENCHMARK(PoolAllocator_StdUnorderedMapWithPoolResource);
+BENCHMARK(CoinsMapLookup_StdAllocator);
+BENCHMARK(CoinsMapLookup_PoolAllocator);
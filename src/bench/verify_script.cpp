@@ -3,16 +3,24 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <bench/data.h>
+#include <hash.h>
 #include <key.h>
+#include <primitives/block.h>
 #if defined(HAVE_CONSENSUS_LIB)
 #include <script/bitcoinconsensus.h>
 #endif
+#include <script/interpreter.h>
 #include <script/script.h>
 #include <script/standard.h>
 #include <streams.h>
+#include <test/util/setup_common.h>
 #include <test/util/transaction_utils.h>
 
 #include <array>
+#include <cassert>
+#include <tuple>
+#include <vector>
 
 // Microbenchmark for verification of a basic P2WPKH script. Can be easily
 // modified to measure performance of other types of scripts.
@@ -96,5 +104,131 @@ static void VerifyNestedIfScript(benchmark::Bench& bench)
     });
 }
 
+// Signature checker accepting every signature, so that the benchmarks below
+// measure the cost of getting to the signature check.
+class AcceptingSignatureChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckECDSASignature(const std::vector<unsigned char>&, const std::vector<unsigned char>&, const CScript&, SigVersion) const override { return true; }
+    bool CheckSchnorrSignature(Span<const unsigned char>, Span<const unsigned char>, SigVersion, const ScriptExecutionData&, ScriptError*) const override { return true; }
+};
+
+enum class StandardSpend { P2PKH, P2WPKH, P2TR };
+
+// Microbenchmark for the script overhead of the common standard spends,
+// through VerifyScript() (which takes the fast path) or the generic
+// interpreter.
+static void VerifyStandardSpend(benchmark::Bench& bench, StandardSpend type, bool generic)
+{
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC | SCRIPT_VERIFY_DERSIG | SCRIPT_VERIFY_LOW_S |
+                               SCRIPT_VERIFY_NULLDUMMY | SCRIPT_VERIFY_SIGPUSHONLY | SCRIPT_VERIFY_MINIMALDATA | SCRIPT_VERIFY_NULLFAIL |
+                               SCRIPT_VERIFY_CLEANSTACK | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_WITNESS_PUBKEYTYPE |
+                               SCRIPT_VERIFY_CONST_SCRIPTCODE | SCRIPT_VERIFY_TAPROOT;
+
+    // A well-formed low-S DER signature with SIGHASH_ALL and a compressed pubkey;
+    // they are never verified.
+    std::vector<unsigned char> sig{0x30, 0x44, 0x02, 0x20};
+    sig.resize(sig.size() + 32, 0x11);
+    sig.insert(sig.end(), {0x02, 0x20});
+    sig.resize(sig.size() + 32, 0x22);
+    sig.push_back(SIGHASH_ALL);
+    std::vector<unsigned char> pubkey(33, 0x33);
+    pubkey[0] = 0x02;
+    const uint160 pubkey_hash{Hash160(pubkey)};
+
+    CScript script_sig, script_pubkey;
+    CScriptWitness witness;
+    switch (type) {
+    case StandardSpend::P2PKH:
+        script_pubkey << OP_DUP << OP_HASH160 << ToByteVector(pubkey_hash) << OP_EQUALVERIFY << OP_CHECKSIG;
+        script_sig << sig << pubkey;
+        break;
+    case StandardSpend::P2WPKH:
+        script_pubkey << OP_0 << ToByteVector(pubkey_hash);
+        witness.stack = {sig, pubkey};
+        break;
+    case StandardSpend::P2TR:
+        script_pubkey << OP_1 << std::vector<unsigned char>(32, 0x44);
+        witness.stack = {std::vector<unsigned char>(64, 0x55)};
+        break;
+    }
+
+    const AcceptingSignatureChecker checker;
+    bench.run([&] {
+        ScriptError err;
+        const bool success = generic ? VerifyScriptGeneric(script_sig, script_pubkey, &witness, flags, checker, &err) :
+                                       VerifyScript(script_sig, script_pubkey, &witness, flags, checker, &err);
+        assert(success && err == SCRIPT_ERR_OK);
+    });
+}
+
+static void VerifyStandardSpendP2PKH(benchmark::Bench& bench) { VerifyStandardSpend(bench, StandardSpend::P2PKH, false); }
+static void VerifyStandardSpendP2PKHGeneric(benchmark::Bench& bench) { VerifyStandardSpend(bench, StandardSpend::P2PKH, true); }
+static void VerifyStandardSpendP2WPKH(benchmark::Bench& bench) { VerifyStandardSpend(bench, StandardSpend::P2WPKH, false); }
+static void VerifyStandardSpendP2WPKHGeneric(benchmark::Bench& bench) { VerifyStandardSpend(bench, StandardSpend::P2WPKH, true); }
+static void VerifyStandardSpendP2TR(benchmark::Bench& bench) { VerifyStandardSpend(bench, StandardSpend::P2TR, false); }
+static void VerifyStandardSpendP2TRGeneric(benchmark::Bench& bench) { VerifyStandardSpend(bench, StandardSpend::P2TR, true); }
+
+// The inputs of mainnet block 413567 whose spent scriptPubKey can be
+// recovered from the scriptSig alone: P2PKH when the scriptSig is a signature
+// and a public key, P2SH otherwise. Inputs the guess fails for (such as P2PK
+// spends) are left out.
+struct BlockSpends {
+    CBlock block;
+    std::vector<std::tuple<const CTransaction*, unsigned int, CScript>> spends;
+
+    explicit BlockSpends(unsigned int flags)
+    {
+        CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
+        stream >> block;
+        for (const CTransactionRef& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (unsigned int i = 0; i < tx->vin.size(); ++i) {
+                const CScript& script_sig = tx->vin[i].scriptSig;
+                std::vector<std::vector<unsigned char>> stack;
+                if (!EvalScript(stack, script_sig, SCRIPT_VERIFY_NONE, BaseSignatureChecker(), SigVersion::BASE) || stack.empty()) continue;
+                const CPubKey pubkey{stack.back()};
+                const CScript script_pubkey = stack.size() == 2 && pubkey.IsFullyValid() ?
+                                              GetScriptForDestination(PKHash(pubkey)) :
+                                              GetScriptForDestination(ScriptHash(CScript(stack.back().begin(), stack.back().end())));
+                // Legacy signature hashes do not commit to the amount.
+                if (!VerifyScript(script_sig, script_pubkey, nullptr, flags, TransactionSignatureChecker(tx.get(), i, 0, MissingDataBehavior::FAIL))) continue;
+                spends.emplace_back(tx.get(), i, script_pubkey);
+            }
+        }
+    }
+};
+
+// Microbenchmark for script evaluation of a real block, without the cost of
+// the signature checks themselves.
+static void VerifyBlockSpends(benchmark::Bench& bench, bool generic)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG | SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY | SCRIPT_VERIFY_CHECKSEQUENCEVERIFY;
+    const BlockSpends block_spends{flags};
+    assert(block_spends.spends.size() > 1000);
+
+    const AcceptingSignatureChecker checker;
+    bench.batch(block_spends.spends.size()).unit("input").run([&] {
+        for (const auto& [tx, n_in, script_pubkey] : block_spends.spends) {
+            const CScript& script_sig = tx->vin[n_in].scriptSig;
+            const bool success = generic ? VerifyScriptGeneric(script_sig, script_pubkey, nullptr, flags, checker) :
+                                           VerifyScript(script_sig, script_pubkey, nullptr, flags, checker);
+            assert(success);
+        }
+    });
+}
+
+static void VerifyBlockScripts(benchmark::Bench& bench) { VerifyBlockSpends(bench, false); }
+static void VerifyBlockScriptsGeneric(benchmark::Bench& bench) { VerifyBlockSpends(bench, true); }
+
 BENCHMARK(VerifyScriptBench);
 BENCHMARK(VerifyNestedIfScript);
+BENCHMARK(VerifyStandardSpendP2PKH);
+BENCHMARK(VerifyStandardSpendP2PKHGeneric);
+BENCHMARK(VerifyStandardSpendP2WPKH);
+BENCHMARK(VerifyStandardSpendP2WPKHGeneric);
+BENCHMARK(VerifyStandardSpendP2TR);
+BENCHMARK(VerifyStandardSpendP2TRGeneric);
+BENCHMARK(VerifyBlockScripts);
+BENCHMARK(VerifyBlockScriptsGeneric);
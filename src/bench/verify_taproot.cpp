@@ -0,0 +1,77 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <key.h>
+#include <primitives/transaction.h>
+#include <pubkey.h>
+#include <script/interpreter.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <cassert>
+#include <vector>
+
+static const size_t KEY_PATH_SPENDS = 2000;
+
+// A synthetic block with a single transaction spending many taproot outputs
+// through the key path, so that script validation is all Schnorr signature
+// verification.
+struct TaprootBlock {
+    CMutableTransaction tx;
+    PrecomputedTransactionData txdata;
+    std::vector<CTxOut> spent_outputs;
+
+    TaprootBlock()
+    {
+        std::vector<CKey> keys(KEY_PATH_SPENDS);
+        for (size_t i = 0; i < KEY_PATH_SPENDS; ++i) {
+            keys[i].MakeNewKey(true);
+            const auto output_key = XOnlyPubKey(keys[i].GetPubKey()).CreateTapTweak(nullptr);
+            assert(output_key);
+            spent_outputs.emplace_back(1000, GetScriptForDestination(WitnessV1Taproot(output_key->first)));
+            tx.vin.emplace_back(COutPoint(uint256{}, i));
+        }
+        tx.vout.emplace_back(1000, CScript() << OP_TRUE);
+
+        // All inputs commit to all outputs, so the signatures can only be
+        // made once the transaction is complete. The witnesses are still
+        // empty, so the taproot sighash data has to be forced.
+        txdata.Init(tx, std::vector<CTxOut>(spent_outputs), /*force=*/true);
+        ScriptExecutionData execdata;
+        execdata.m_annex_init = true;
+        execdata.m_annex_present = false;
+        for (size_t i = 0; i < KEY_PATH_SPENDS; ++i) {
+            uint256 sighash;
+            bool ok = SignatureHashSchnorr(sighash, execdata, tx, i, SIGHASH_DEFAULT, SigVersion::TAPROOT, txdata, MissingDataBehavior::FAIL);
+            std::vector<unsigned char> sig(64);
+            ok &= keys[i].SignSchnorr(sighash, sig, &uint256::ZERO);
+            assert(ok);
+            tx.vin[i].scriptWitness.stack = {sig};
+        }
+    }
+};
+
+static void VerifyTaprootKeyPathSpends(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    const TaprootBlock block;
+    const CTransaction tx{block.tx};
+    PrecomputedTransactionData txdata;
+    txdata.Init(tx, std::vector<CTxOut>(block.spent_outputs));
+
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_TAPROOT;
+    bench.batch(KEY_PATH_SPENDS).unit("input").run([&] {
+        // Run the checks a script check thread would, without caching the
+        // results.
+        for (size_t i = 0; i < KEY_PATH_SPENDS; ++i) {
+            CScriptCheck check(block.spent_outputs[i], tx, i, flags, false, &txdata);
+            bool ok = check();
+            assert(ok);
+        }
+    });
+}
+
+BENCHMARK(VerifyTaprootKeyPathSpends);
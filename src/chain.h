@@ -137,6 +137,10 @@ enum BlockStatus: uint32_t {
 class CBlockIndex
 {
 public:
+    // The fields used while walking the block tree (GetAncestor(),
+    // LastCommonAncestor(), chain selection) come first, so that they share
+    // a cache line.
+
     //! pointer to the hash of the block, if any. Memory is owned by this CBlockIndex
     const uint256* phashBlock{nullptr};
 
@@ -149,25 +153,17 @@ public:
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight{0};
 
-    //! Which # file this block is stored in (blk?????.dat)
-    int nFile{0};
-
-    //! Byte offset within blk?????.dat where this block's data is stored
-    unsigned int nDataPos{0};
-
-    //! Byte offset within rev?????.dat where this block's undo data is stored
-    unsigned int nUndoPos{0};
+    //! Verification status of this block. See enum BlockStatus
+    //!
+    //! Note: this value is modified to show BLOCK_OPT_WITNESS during UTXO snapshot
+    //! load to avoid the block index being spuriously rewound.
+    //! @sa NeedsRedownload
+    //! @sa ActivateSnapshot
+    uint32_t nStatus{0};
 
     //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
     arith_uint256 nChainWork{};
 
-    //! Number of transactions in this block.
-    //! Note: in a potential headers-first mode, this number cannot be relied upon
-    //! Note: this value is faked during UTXO snapshot load to ensure that
-    //! LoadBlockIndex() will load index entries for blocks that we lack data for.
-    //! @sa ActivateSnapshot
-    unsigned int nTx{0};
-
     //! (memory only) Number of transactions in the chain up to and including this block.
     //! This value will be non-zero only if and only if transactions for this block and all its parents are available.
     //! Change to 64-bit type when necessary; won't happen before 2030
@@ -178,13 +174,21 @@ public:
     //! @sa ActivateSnapshot
     unsigned int nChainTx{0};
 
-    //! Verification status of this block. See enum BlockStatus
-    //!
-    //! Note: this value is modified to show BLOCK_OPT_WITNESS during UTXO snapshot
-    //! load to avoid the block index being spuriously rewound.
-    //! @sa NeedsRedownload
+    //! Number of transactions in this block.
+    //! Note: in a potential headers-first mode, this number cannot be relied upon
+    //! Note: this value is faked during UTXO snapshot load to ensure that
+    //! LoadBlockIndex() will load index entries for blocks that we lack data for.
     //! @sa ActivateSnapshot
-    uint32_t nStatus{0};
+    unsigned int nTx{0};
+
+    //! Which # file this block is stored in (blk?????.dat)
+    int nFile{0};
+
+    //! Byte offset within blk?????.dat where this block's data is stored
+    unsigned int nDataPos{0};
+
+    //! Byte offset within rev?????.dat where this block's undo data is stored
+    unsigned int nUndoPos{0};
 
     //! block header
     int32_t nVersion{0};
@@ -10,6 +10,12 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
 template <typename T>
@@ -24,12 +30,29 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every participant (each worker, plus the master) owns a deque. Added
+  * checks are spread over the deques, and a participant takes batches from
+  * the back of its own deque before stealing from the front of the others,
+  * so the only lock taken per batch is the one of the deque it comes from.
+  * Completion is tracked with an atomic counter; the master only blocks on
+  * a condition variable once there is nothing left for it to steal.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! A participant's own share of the queued checks.
+    struct WorkerQueue {
+        Mutex m_mutex;
+        //! As the order of checks doesn't matter, the owner uses it as a LIFO
+        //! and thieves take from the other end.
+        std::deque<T> m_checks GUARDED_BY(m_mutex);
+        //! Mirrors m_checks.size(), to skip empty deques without locking.
+        std::atomic<size_t> m_size{0};
+    };
+
+    //! Mutex to protect the sleeping and stopping state
     Mutex m_mutex;
 
     //! Worker threads block on this when out of work
@@ -38,25 +61,24 @@ private:
     //! Master thread blocks on this when out of work
     std::condition_variable m_master_cv;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue GUARDED_BY(m_mutex);
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle GUARDED_BY(m_mutex){0};
+    //! One deque per worker thread; the last one belongs to the master.
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
 
-    //! The total number of workers (including the master).
-    int nTotal GUARDED_BY(m_mutex){0};
+    //! The deque the next added batch starts at.
+    size_t m_next_queue{0};
 
-    //! The temporary evaluation result.
-    bool fAllOk GUARDED_BY(m_mutex){true};
+    //! Number of checks sitting in the deques, not yet taken by anyone.
+    std::atomic<size_t> m_queued{0};
 
     /**
      * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
+     * This includes elements that are no longer queued, but still in a
+     * participant's own batch.
      */
-    unsigned int nTodo GUARDED_BY(m_mutex){0};
+    std::atomic<size_t> m_todo{0};
+
+    //! The temporary evaluation result.
+    std::atomic<bool> m_all_ok{true};
 
     //! The maximum number of elements to be processed in one batch
     const unsigned int nBatchSize;
@@ -64,68 +86,95 @@ private:
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster)
+    //! Mirrors !m_worker_threads.empty(), for callers on other threads.
+    std::atomic<bool> m_has_worker_threads{false};
+
+    /**
+     * Decide how many work units to take from a deque holding `size` of them.
+     * Taking half leaves the rest for thieves, so batches get smaller towards
+     * the end of a block and all participants finish approximately
+     * simultaneously. Never take fewer than 1 or more than nBatchSize.
+     */
+    size_t BatchSize(size_t size) const
+    {
+        return std::clamp<size_t>(size / 2, 1, nBatchSize);
+    }
+
+    /** Move a batch of checks out of the deque at `index` into vChecks. */
+    bool TakeBatch(size_t index, bool steal, std::vector<T>& vChecks)
+    {
+        WorkerQueue& queue = *m_queues[index];
+        if (queue.m_size.load(std::memory_order_relaxed) == 0) return false;
+        LOCK(queue.m_mutex);
+        if (queue.m_checks.empty()) return false;
+        const size_t nNow = BatchSize(queue.m_checks.size());
+        vChecks.resize(nNow);
+        for (size_t i = 0; i < nNow; i++) {
+            // Swap jobs out of the deque instead of copying, to keep the lock
+            // as short as possible.
+            if (steal) {
+                vChecks[i].swap(queue.m_checks.front());
+                queue.m_checks.pop_front();
+            } else {
+                vChecks[i].swap(queue.m_checks.back());
+                queue.m_checks.pop_back();
+            }
+        }
+        queue.m_size.store(queue.m_checks.size(), std::memory_order_relaxed);
+        m_queued.fetch_sub(nNow, std::memory_order_relaxed);
+        return true;
+    }
+
+    /** Take a batch from our own deque, or steal one from another participant. */
+    bool TakeWork(size_t self, std::vector<T>& vChecks)
+    {
+        if (TakeBatch(self, /*steal=*/false, vChecks)) return true;
+        const size_t count = m_queues.size();
+        for (size_t i = 1; i < count; ++i) {
+            if (m_queued.load(std::memory_order_relaxed) == 0) return false;
+            if (TakeBatch((self + i) % count, /*steal=*/true, vChecks)) return true;
+        }
+        return false;
+    }
+
+    /** Execute and destroy a batch, then mark it as done. */
+    void RunBatch(std::vector<T>& vChecks)
+    {
+        // Skip the work when an earlier check already failed.
+        bool fOk = m_all_ok.load(std::memory_order_relaxed);
+        for (T& check : vChecks)
+            if (fOk)
+                fOk = check();
+        if (!fOk) m_all_ok.store(false, std::memory_order_relaxed);
+        const size_t nNow = vChecks.size();
+        // The checks must be destroyed before they are counted as done, as
+        // the master may return as soon as m_todo drops to zero.
+        vChecks.clear();
+        if (m_todo.fetch_sub(nNow, std::memory_order_acq_rel) == nNow) {
+            // We processed the last element; inform the master it can exit
+            // and return the result. Taking the lock makes sure the master
+            // is either still to check m_todo or already waiting.
+            LOCK(m_mutex);
+            m_master_cv.notify_one();
+        }
+    }
+
+    /** Internal function that does bulk of the verification work for a worker thread. */
+    void WorkerLoop(size_t self)
     {
-        std::condition_variable& cond = fMaster ? m_master_cv : m_worker_cv;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
-            {
-                WAIT_LOCK(m_mutex, lock);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        m_master_cv.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty() && !m_request_stop) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                if (m_request_stop) {
-                    return false;
-                }
-
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the m_mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+        while (true) {
+            if (TakeWork(self, vChecks)) {
+                RunBatch(vChecks);
+                continue;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+            WAIT_LOCK(m_mutex, lock);
+            m_worker_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                return m_request_stop || m_queued.load(std::memory_order_relaxed) > 0;
+            });
+            if (m_request_stop) return;
+        }
     }
 
 public:
@@ -136,50 +185,95 @@ public:
     explicit CCheckQueue(unsigned int nBatchSizeIn)
         : nBatchSize(nBatchSizeIn)
     {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
     }
 
-    //! Create a pool of new worker threads.
-    void StartWorkerThreads(const int threads_num)
+    //! Create a pool of new worker threads, named after thread_name.
+    void StartWorkerThreads(const int threads_num, const std::string& thread_name = "scriptch")
     {
-        {
-            LOCK(m_mutex);
-            nIdle = 0;
-            nTotal = 0;
-            fAllOk = true;
-        }
         assert(m_worker_threads.empty());
+        assert(m_todo == 0);
+        m_all_ok = true;
+        m_next_queue = 0;
+        m_queues.clear();
+        for (int n = 0; n < threads_num + 1; ++n) {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
         for (int n = 0; n < threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
-                Loop(false /* worker thread */);
+            m_worker_threads.emplace_back([this, n, thread_name]() {
+                util::ThreadRename(strprintf("%s.%i", thread_name, n));
+                WorkerLoop(n);
             });
         }
+        m_has_worker_threads = threads_num > 0;
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true /* master thread */);
+        // Join the workers until there is nothing left to take.
+        const size_t self = m_queues.size() - 1;
+        std::vector<T> vChecks;
+        vChecks.reserve(nBatchSize);
+        while (m_todo.load(std::memory_order_acquire) != 0 && TakeWork(self, vChecks)) {
+            RunBatch(vChecks);
+        }
+        {
+            // Wait for the batches still in flight on the worker threads.
+            WAIT_LOCK(m_mutex, lock);
+            m_master_cv.wait(lock, [&] { return m_todo.load(std::memory_order_acquire) == 0; });
+        }
+        // reset the status for new work later
+        return m_all_ok.exchange(true);
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        LOCK(m_mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        if (vChecks.empty()) return;
+        // Spread the batch over the deques in contiguous chunks, starting
+        // where the previous batch left off, so that small batches still end
+        // up on different participants.
+        const size_t count = m_queues.size();
+        const size_t chunk = (vChecks.size() + count - 1) / count;
+        m_todo.fetch_add(vChecks.size(), std::memory_order_relaxed);
+        for (size_t begin = 0; begin < vChecks.size(); begin += chunk) {
+            const size_t end = std::min(vChecks.size(), begin + chunk);
+            WorkerQueue& queue = *m_queues[m_next_queue];
+            m_next_queue = (m_next_queue + 1) % count;
+            LOCK(queue.m_mutex);
+            for (size_t i = begin; i < end; ++i) {
+                queue.m_checks.emplace_back();
+                vChecks[i].swap(queue.m_checks.back());
+            }
+            queue.m_size.store(queue.m_checks.size(), std::memory_order_relaxed);
+            // Only count checks once they can be taken, so that woken workers
+            // don't spin on work that isn't there yet. Doing so under the
+            // deque lock keeps the count from going below zero.
+            m_queued.fetch_add(end - begin, std::memory_order_relaxed);
         }
-        nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            m_worker_cv.notify_one();
-        else if (vChecks.size() > 1)
-            m_worker_cv.notify_all();
+        {
+            // Notify under the lock, so no worker misses the new work
+            // between checking m_queued and going to sleep.
+            LOCK(m_mutex);
+            if (vChecks.size() == 1)
+                m_worker_cv.notify_one();
+            else
+                m_worker_cv.notify_all();
+        }
+    }
+
+    //! Whether there are worker threads to run checks in parallel with the caller.
+    //! Safe to call from any thread, while the pool is started or stopped.
+    bool HasWorkerThreads() const
+    {
+        return m_has_worker_threads.load(std::memory_order_relaxed);
     }
 
     //! Stop all of the worker threads.
     void StopWorkerThreads()
     {
+        m_has_worker_threads = false;
         WITH_LOCK(m_mutex, m_request_stop = true);
         m_worker_cv.notify_all();
         for (std::thread& t : m_worker_threads) {
@@ -8,8 +8,47 @@
 #include <crypto/common.h>
 #include <crypto/chacha20.h>
 
+#include <algorithm>
+#include <assert.h>
 #include <string.h>
 
+#include <compat/cpuid.h>
+
+namespace chacha20_sse41
+{
+void Crypt_4way(const uint32_t* input, const unsigned char* m, unsigned char* c);
+}
+
+namespace chacha20_avx2
+{
+void Crypt_8way(const uint32_t* input, const unsigned char* m, unsigned char* c);
+}
+
+namespace {
+/** Compute 4 or 8 consecutive blocks from the state input, XORing them into m unless it is nullptr. */
+typedef void (*CryptMultiFn)(const uint32_t* input, const unsigned char* m, unsigned char* c);
+CryptMultiFn Crypt_4way = nullptr;
+CryptMultiFn Crypt_8way = nullptr;
+
+/** Process as much of a message as the multi-block implementations can, advancing the block counter. */
+void CryptMultiBlock(uint32_t input[16], const unsigned char*& m, unsigned char*& c, size_t& bytes)
+{
+    const auto run = [&](CryptMultiFn fn, size_t blocks) {
+        while (bytes >= 64 * blocks) {
+            fn(input, m, c);
+            const uint64_t counter = (input[12] | ((uint64_t)input[13] << 32)) + blocks;
+            input[12] = counter;
+            input[13] = counter >> 32;
+            if (m) m += 64 * blocks;
+            c += 64 * blocks;
+            bytes -= 64 * blocks;
+        }
+    };
+    if (Crypt_8way) run(Crypt_8way, 8);
+    if (Crypt_4way) run(Crypt_4way, 4);
+}
+} // namespace
+
 constexpr static inline uint32_t rotl32(uint32_t v, int c) { return (v << c) | (v >> (32 - c)); }
 
 #define QUARTERROUND(a,b,c,d) \
@@ -73,6 +112,9 @@ void ChaCha20::Seek(uint64_t pos)
 
 void ChaCha20::Keystream(unsigned char* c, size_t bytes)
 {
+    const unsigned char* no_input = nullptr;
+    CryptMultiBlock(input, no_input, c, bytes);
+
     uint32_t x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15;
     uint32_t j0, j1, j2, j3, j4, j5, j6, j7, j8, j9, j10, j11, j12, j13, j14, j15;
     unsigned char *ctarget = nullptr;
@@ -181,6 +223,8 @@ void ChaCha20::Keystream(unsigned char* c, size_t bytes)
 
 void ChaCha20::Crypt(const unsigned char* m, unsigned char* c, size_t bytes)
 {
+    CryptMultiBlock(input, m, c, bytes);
+
     uint32_t x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15;
     uint32_t j0, j1, j2, j3, j4, j5, j6, j7, j8, j9, j10, j11, j12, j13, j14, j15;
     unsigned char *ctarget = nullptr;
@@ -308,3 +352,55 @@ void ChaCha20::Crypt(const unsigned char* m, unsigned char* c, size_t bytes)
         m += 64;
     }
 }
+
+namespace {
+/** Check the multi-block implementations against one block at a time, across a block counter carry. */
+bool SelfTest()
+{
+    static const unsigned char key[32] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32};
+    unsigned char message[64 * 13], multi[64 * 13], single[64 * 13];
+    for (size_t i = 0; i < sizeof(message); ++i) message[i] = i;
+    ChaCha20 a(key, 32), b(key, 32);
+    a.SetIV(0x0123456789abcdefULL);
+    b.SetIV(0x0123456789abcdefULL);
+    a.Seek(0xfffffffaULL);
+    b.Seek(0xfffffffaULL);
+    a.Crypt(message, multi, sizeof(message));
+    for (size_t i = 0; i < sizeof(message); i += 64) b.Crypt(message + i, single + i, 64);
+    return std::equal(multi, multi + sizeof(multi), single);
+}
+} // namespace
+
+std::string ChaCha20AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_sse4 = (ecx >> 19) & 1;
+    const bool enabled_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && (GetXCR0() & 6) == 6;
+    bool have_avx2 = false;
+    if (have_sse4) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+    (void)enabled_avx;
+    (void)have_avx2;
+
+#if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_sse4) {
+        Crypt_4way = chacha20_sse41::Crypt_4way;
+        ret = "sse41(4way)";
+    }
+#endif
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && enabled_avx) {
+        Crypt_8way = chacha20_avx2::Crypt_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace chacha20_avx2 {
+namespace {
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+template <int N>
+__m256i inline RotL(__m256i x) { return _mm256_or_si256(_mm256_slli_epi32(x, N), _mm256_srli_epi32(x, 32 - N)); }
+__m256i inline RotL16(__m256i x) { return _mm256_shuffle_epi8(x, _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13, 2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13)); }
+__m256i inline RotL8(__m256i x) { return _mm256_shuffle_epi8(x, _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14, 3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14)); }
+
+void inline __attribute__((always_inline)) QuarterRound(__m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+    a = Add(a, b); d = RotL16(Xor(d, a));
+    c = Add(c, d); b = RotL<12>(Xor(b, c));
+    a = Add(a, b); d = RotL8(Xor(d, a));
+    c = Add(c, d); b = RotL<7>(Xor(b, c));
+}
+
+/** Write (or XOR into the input and write) 32 bytes of output. */
+void inline Store(const unsigned char* m, unsigned char* c, __m256i x)
+{
+    if (m) x = Xor(x, _mm256_loadu_si256((const __m256i*)m));
+    _mm256_storeu_si256((__m256i*)c, x);
+}
+
+} // namespace
+
+void Crypt_8way(const uint32_t* input, const unsigned char* m, unsigned char* c)
+{
+    __m256i j[16];
+    for (int i = 0; i < 16; ++i) j[i] = _mm256_set1_epi32(input[i]);
+    // Lane i is block counter + i, a 64-bit number split over words 12 and 13.
+    const uint64_t counter = input[12] | ((uint64_t)input[13] << 32);
+    uint32_t lo[8], hi[8];
+    for (int i = 0; i < 8; ++i) {
+        lo[i] = (uint32_t)(counter + i);
+        hi[i] = (uint32_t)((counter + i) >> 32);
+    }
+    j[12] = _mm256_loadu_si256((const __m256i*)lo);
+    j[13] = _mm256_loadu_si256((const __m256i*)hi);
+
+    __m256i x[16];
+    for (int i = 0; i < 16; ++i) x[i] = j[i];
+    for (int i = 0; i < 10; ++i) {
+        QuarterRound(x[0], x[4], x[8], x[12]);
+        QuarterRound(x[1], x[5], x[9], x[13]);
+        QuarterRound(x[2], x[6], x[10], x[14]);
+        QuarterRound(x[3], x[7], x[11], x[15]);
+        QuarterRound(x[0], x[5], x[10], x[15]);
+        QuarterRound(x[1], x[6], x[11], x[12]);
+        QuarterRound(x[2], x[7], x[8], x[13]);
+        QuarterRound(x[3], x[4], x[9], x[14]);
+    }
+    for (int i = 0; i < 16; ++i) x[i] = Add(x[i], j[i]);
+
+    // Transpose from one word of every block per register to the words of
+    // one block per register half. For each group g of four words, y[g][b]
+    // holds those words of block b in its low half, and of block b + 4 in its
+    // high half.
+    __m256i y[4][4];
+    for (int g = 0; g < 4; ++g) {
+        const __m256i t0 = _mm256_unpacklo_epi32(x[4 * g], x[4 * g + 1]);
+        const __m256i t1 = _mm256_unpacklo_epi32(x[4 * g + 2], x[4 * g + 3]);
+        const __m256i t2 = _mm256_unpackhi_epi32(x[4 * g], x[4 * g + 1]);
+        const __m256i t3 = _mm256_unpackhi_epi32(x[4 * g + 2], x[4 * g + 3]);
+        y[g][0] = _mm256_unpacklo_epi64(t0, t1);
+        y[g][1] = _mm256_unpackhi_epi64(t0, t1);
+        y[g][2] = _mm256_unpacklo_epi64(t2, t3);
+        y[g][3] = _mm256_unpackhi_epi64(t2, t3);
+    }
+    for (int b = 0; b < 4; ++b) {
+        const size_t lo_block = 64 * b, hi_block = 64 * (b + 4);
+        Store(m ? m + lo_block : nullptr, c + lo_block, _mm256_permute2x128_si256(y[0][b], y[1][b], 0x20));
+        Store(m ? m + lo_block + 32 : nullptr, c + lo_block + 32, _mm256_permute2x128_si256(y[2][b], y[3][b], 0x20));
+        Store(m ? m + hi_block : nullptr, c + hi_block, _mm256_permute2x128_si256(y[0][b], y[1][b], 0x31));
+        Store(m ? m + hi_block + 32 : nullptr, c + hi_block + 32, _mm256_permute2x128_si256(y[2][b], y[3][b], 0x31));
+    }
+}
+
+}
+
+#endif
@@ -59,6 +59,54 @@ inline void muln2(limb_t& c0, limb_t& c1, const limb_t& n)
     c1 = t;
 }
 
+#if defined(__x86_64__) && defined(HAVE___INT128)
+
+/* The C versions below leave it to the compiler to spot the carry chains, which
+ * it often does not, spilling the double limb product to the stack instead. On
+ * x86_64 spell out the add-with-carry sequences, and use mulx (which leaves the
+ * flags alone and takes any registers) when the target has BMI2. */
+
+/** [lo,hi] = a * b */
+inline void mul2(limb_t& lo, limb_t& hi, const limb_t& a, const limb_t& b)
+{
+#if defined(__BMI2__)
+    __asm__("mulxq %3, %0, %1" : "=r"(lo), "=r"(hi) : "d"(a), "rm"(b));
+#else
+    __asm__("mulq %3" : "=a"(lo), "=d"(hi) : "a"(a), "rm"(b) : "cc");
+#endif
+}
+
+/** [c0,c1,c2] += a * b */
+inline void muladd3(limb_t& c0, limb_t& c1, limb_t& c2, const limb_t& a, const limb_t& b)
+{
+    limb_t tl, th;
+    mul2(tl, th, a, b);
+    __asm__("addq %3, %0\n\t"
+            "adcq %4, %1\n\t"
+            "adcq $0, %2"
+            : "+r"(c0), "+r"(c1), "+r"(c2)
+            : "r"(tl), "r"(th)
+            : "cc");
+}
+
+/** [c0,c1,c2] += 2 * a * b */
+inline void muldbladd3(limb_t& c0, limb_t& c1, limb_t& c2, const limb_t& a, const limb_t& b)
+{
+    limb_t tl, th;
+    mul2(tl, th, a, b);
+    __asm__("addq %3, %0\n\t"
+            "adcq %4, %1\n\t"
+            "adcq $0, %2\n\t"
+            "addq %3, %0\n\t"
+            "adcq %4, %1\n\t"
+            "adcq $0, %2"
+            : "+r"(c0), "+r"(c1), "+r"(c2)
+            : "r"(tl), "r"(th)
+            : "cc");
+}
+
+#else
+
 /** [c0,c1,c2] += a * b */
 inline void muladd3(limb_t& c0, limb_t& c1, limb_t& c2, const limb_t& a, const limb_t& b)
 {
@@ -89,6 +137,8 @@ inline void muldbladd3(limb_t& c0, limb_t& c1, limb_t& c2, const limb_t& a, cons
     c2 += (c1 < th) ? 1 : 0;
 }
 
+#endif
+
 /**
  * Add limb a to [c0,c1]: [c0,c1] += a. Then extract the lowest
  * limb of [c0,c1] into n, and left shift the number by 1 limb.
@@ -258,9 +308,20 @@ void Num3072::SetToOne()
     for (int i = 1; i < LIMBS; ++i) this->limbs[i] = 0;
 }
 
+bool Num3072::IsOne() const
+{
+    if (this->limbs[0] != 1) return false;
+    for (int i = 1; i < LIMBS; ++i) {
+        if (this->limbs[i] != 0) return false;
+    }
+    return true;
+}
+
 void Num3072::Divide(const Num3072& a)
 {
     if (this->IsOverflow()) this->FullReduce();
+    // Nothing was removed since the last division; skip the inversion.
+    if (a.IsOne()) return;
 
     Num3072 inv{};
     if (a.IsOverflow()) {
@@ -324,13 +385,13 @@ void MuHash3072::Finalize(uint256& out) noexcept
 MuHash3072& MuHash3072::operator*=(const MuHash3072& mul) noexcept
 {
     m_numerator.Multiply(mul.m_numerator);
-    m_denominator.Multiply(mul.m_denominator);
+    if (!mul.m_denominator.IsOne()) m_denominator.Multiply(mul.m_denominator);
     return *this;
 }
 
 MuHash3072& MuHash3072::operator/=(const MuHash3072& div) noexcept
 {
-    m_numerator.Multiply(div.m_denominator);
+    if (!div.m_denominator.IsOne()) m_numerator.Multiply(div.m_denominator);
     m_denominator.Multiply(div.m_numerator);
     return *this;
 }
@@ -48,6 +48,7 @@ public:
     void Multiply(const Num3072& a);
     void Divide(const Num3072& a);
     void SetToOne();
+    bool IsOne() const;
     void Square();
     void ToBytes(unsigned char (&out)[BYTE_SIZE]);
 
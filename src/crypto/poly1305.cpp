@@ -8,8 +8,25 @@
 #include <crypto/common.h>
 #include <crypto/poly1305.h>
 
+#include <assert.h>
 #include <string.h>
 
+#include <compat/cpuid.h>
+
+namespace poly1305_avx2
+{
+size_t Blocks_4way(uint32_t h[5], const uint32_t r[5], const unsigned char* m, size_t inlen);
+}
+
+namespace {
+/** Absorb the whole groups of four blocks of m into the radix 2^26 state h. Returns the number of bytes absorbed. */
+typedef size_t (*BlocksMultiFn)(uint32_t h[5], const uint32_t r[5], const unsigned char* m, size_t inlen);
+BlocksMultiFn Blocks_4way = nullptr;
+
+/** Below this many bytes, computing r^2..r^4 for the four-way implementation does not pay off. */
+constexpr size_t POLY1305_4WAY_MIN_BYTES = 128;
+} // namespace
+
 #define mul32x32_64(a,b) ((uint64_t)(a) * (b))
 
 void poly1305_auth(unsigned char out[POLY1305_TAGLEN], const unsigned char *m, size_t inlen, const unsigned char key[POLY1305_KEYLEN]) {
@@ -50,6 +67,16 @@ void poly1305_auth(unsigned char out[POLY1305_TAGLEN], const unsigned char *m, s
     h3 = 0;
     h4 = 0;
 
+    /* groups of four full blocks */
+    if (Blocks_4way && inlen >= POLY1305_4WAY_MIN_BYTES) {
+        uint32_t h[5] = {h0, h1, h2, h3, h4};
+        const uint32_t r[5] = {r0, r1, r2, r3, r4};
+        const size_t done = Blocks_4way(h, r, m, inlen);
+        m += done;
+        inlen -= done;
+        h0 = h[0]; h1 = h[1]; h2 = h[2]; h3 = h[3]; h4 = h[4];
+    }
+
     /* full blocks */
     if (inlen < 16) goto poly1305_donna_atmost15bytes;
 poly1305_donna_16bytes:
@@ -139,3 +166,44 @@ poly1305_donna_finish:
     WriteLE32(&out[ 8], f2); f3 += (f2 >> 32);
     WriteLE32(&out[12], f3);
 }
+
+namespace {
+/** Check the four-way implementation against a known tag (computed with an independent implementation). */
+bool SelfTest()
+{
+    static const unsigned char key[POLY1305_KEYLEN] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31};
+    static const unsigned char expected[POLY1305_TAGLEN] = {0xb7, 0x4c, 0xe6, 0x6f, 0x76, 0xa2, 0x56, 0x6f, 0xb0, 0x05, 0x29, 0x67, 0xc1, 0x46, 0xde, 0x6d};
+    unsigned char message[1000], tag[POLY1305_TAGLEN];
+    for (size_t i = 0; i < sizeof(message); ++i) message[i] = i * 7 + 3;
+    poly1305_auth(tag, message, sizeof(message), key);
+    return memcmp(tag, expected, sizeof(tag)) == 0;
+}
+} // namespace
+
+std::string Poly1305AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_sse4 = (ecx >> 19) & 1;
+    const bool enabled_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && (GetXCR0() & 6) == 6;
+    bool have_avx2 = false;
+    if (have_sse4) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+    (void)enabled_avx;
+    (void)have_avx2;
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && enabled_avx) {
+        Blocks_4way = poly1305_avx2::Blocks_4way;
+        ret = "avx2(4way)";
+    }
+#endif
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
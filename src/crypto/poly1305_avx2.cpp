@@ -0,0 +1,133 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Four-way Poly1305 block processing, after "Vectorization of Poly1305
+// Message Authentication Code" by Shay Gueron and Martin Goll: lane i absorbs
+// blocks i, i + 4, i + 8, ... with multiplier r^4, and the lanes are combined
+// with multipliers r^4, r^3, r^2 and r at the end.
+
+#ifdef ENABLE_AVX2
+
+#include <stddef.h>
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace poly1305_avx2 {
+namespace {
+
+constexpr uint32_t MASK26 = 0x3ffffff;
+
+/** Propagate the carries of five 64-bit limb sums in radix 2^26, modulo 2^130 - 5. */
+void inline Carry(uint64_t t[5], uint32_t h[5])
+{
+    t[1] += t[0] >> 26; h[0] = t[0] & MASK26;
+    t[2] += t[1] >> 26; h[1] = t[1] & MASK26;
+    t[3] += t[2] >> 26; h[2] = t[2] & MASK26;
+    t[4] += t[3] >> 26; h[3] = t[3] & MASK26;
+    const uint64_t h0 = h[0] + (t[4] >> 26) * 5; h[4] = t[4] & MASK26;
+    h[0] = h0 & MASK26;
+    h[1] += h0 >> 26;
+}
+
+/** Multiply a by b modulo 2^130 - 5, in radix 2^26. */
+void inline MulMod(uint32_t out[5], const uint32_t a[5], const uint32_t b[5])
+{
+    const uint64_t s1 = b[1] * 5, s2 = b[2] * 5, s3 = b[3] * 5, s4 = b[4] * 5;
+    uint64_t t[5];
+    t[0] = (uint64_t)a[0] * b[0] + a[1] * s4 + a[2] * s3 + a[3] * s2 + a[4] * s1;
+    t[1] = (uint64_t)a[0] * b[1] + (uint64_t)a[1] * b[0] + a[2] * s4 + a[3] * s3 + a[4] * s2;
+    t[2] = (uint64_t)a[0] * b[2] + (uint64_t)a[1] * b[1] + (uint64_t)a[2] * b[0] + a[3] * s4 + a[4] * s3;
+    t[3] = (uint64_t)a[0] * b[3] + (uint64_t)a[1] * b[2] + (uint64_t)a[2] * b[1] + (uint64_t)a[3] * b[0] + a[4] * s4;
+    t[4] = (uint64_t)a[0] * b[4] + (uint64_t)a[1] * b[3] + (uint64_t)a[2] * b[2] + (uint64_t)a[3] * b[1] + (uint64_t)a[4] * b[0];
+    Carry(t, out);
+}
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Mul(__m256i x, __m256i y) { return _mm256_mul_epu32(x, y); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z, __m256i w, __m256i v) { return Add(Add(Add(x, y), Add(z, w)), v); }
+
+/** Per lane, t = h * r, with s = 5 * r. All limbs are in the low 32 bits of the 64-bit lanes. */
+void inline MulLanes(__m256i t[5], const __m256i h[5], const __m256i r[5], const __m256i s[5])
+{
+    t[0] = Add(Mul(h[0], r[0]), Mul(h[1], s[4]), Mul(h[2], s[3]), Mul(h[3], s[2]), Mul(h[4], s[1]));
+    t[1] = Add(Mul(h[0], r[1]), Mul(h[1], r[0]), Mul(h[2], s[4]), Mul(h[3], s[3]), Mul(h[4], s[2]));
+    t[2] = Add(Mul(h[0], r[2]), Mul(h[1], r[1]), Mul(h[2], r[0]), Mul(h[3], s[4]), Mul(h[4], s[3]));
+    t[3] = Add(Mul(h[0], r[3]), Mul(h[1], r[2]), Mul(h[2], r[1]), Mul(h[3], r[0]), Mul(h[4], s[4]));
+    t[4] = Add(Mul(h[0], r[4]), Mul(h[1], r[3]), Mul(h[2], r[2]), Mul(h[3], r[1]), Mul(h[4], r[0]));
+}
+
+/** Per lane version of Carry(). */
+void inline CarryLanes(__m256i t[5], __m256i h[5])
+{
+    const __m256i mask = _mm256_set1_epi64x(MASK26);
+    t[1] = Add(t[1], _mm256_srli_epi64(t[0], 26)); h[0] = _mm256_and_si256(t[0], mask);
+    t[2] = Add(t[2], _mm256_srli_epi64(t[1], 26)); h[1] = _mm256_and_si256(t[1], mask);
+    t[3] = Add(t[3], _mm256_srli_epi64(t[2], 26)); h[2] = _mm256_and_si256(t[2], mask);
+    t[4] = Add(t[4], _mm256_srli_epi64(t[3], 26)); h[3] = _mm256_and_si256(t[3], mask);
+    const __m256i c = _mm256_srli_epi64(t[4], 26); h[4] = _mm256_and_si256(t[4], mask);
+    h[0] = Add(h[0], Add(c, _mm256_slli_epi64(c, 2)));
+    h[1] = Add(h[1], _mm256_srli_epi64(h[0], 26)); h[0] = _mm256_and_si256(h[0], mask);
+}
+
+/** Load four 16-byte blocks, one per lane, as radix 2^26 limbs with the 2^128 bit set. */
+void inline LoadBlocks(__m256i l[5], const unsigned char* m)
+{
+    const __m256i a = _mm256_loadu_si256((const __m256i*)m);
+    const __m256i b = _mm256_loadu_si256((const __m256i*)(m + 32));
+    // The unpacks interleave per 128-bit half, giving blocks 0, 2, 1, 3.
+    const __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xd8);
+    const __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xd8);
+    const __m256i mask = _mm256_set1_epi64x(MASK26);
+    l[0] = _mm256_and_si256(lo, mask);
+    l[1] = _mm256_and_si256(_mm256_srli_epi64(lo, 26), mask);
+    l[2] = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo, 52), _mm256_slli_epi64(hi, 12)), mask);
+    l[3] = _mm256_and_si256(_mm256_srli_epi64(hi, 14), mask);
+    l[4] = _mm256_or_si256(_mm256_srli_epi64(hi, 40), _mm256_set1_epi64x(1 << 24));
+}
+
+} // namespace
+
+size_t Blocks_4way(uint32_t h[5], const uint32_t r[5], const unsigned char* m, size_t inlen)
+{
+    const size_t groups = inlen / 64;
+    if (groups == 0) return 0;
+
+    uint32_t r2[5], r3[5], r4[5];
+    MulMod(r2, r, r);
+    MulMod(r3, r2, r);
+    MulMod(r4, r3, r);
+
+    __m256i acc[5], t[5], msg[5], mul[5], mul5[5];
+    LoadBlocks(acc, m);
+    for (int k = 0; k < 5; ++k) {
+        acc[k] = Add(acc[k], _mm256_set_epi64x(0, 0, 0, h[k]));
+        mul[k] = _mm256_set1_epi64x(r4[k]);
+        mul5[k] = _mm256_set1_epi64x(r4[k] * 5);
+    }
+    for (size_t g = 1; g < groups; ++g) {
+        MulLanes(t, acc, mul, mul5);
+        CarryLanes(t, acc);
+        LoadBlocks(msg, m + 64 * g);
+        for (int k = 0; k < 5; ++k) acc[k] = Add(acc[k], msg[k]);
+    }
+
+    // Lane i holds the earliest block of its group, so it needs r^(4 - i).
+    for (int k = 0; k < 5; ++k) {
+        mul[k] = _mm256_set_epi64x(r[k], r2[k], r3[k], r4[k]);
+        mul5[k] = _mm256_set_epi64x(r[k] * 5, r2[k] * 5, r3[k] * 5, r4[k] * 5);
+    }
+    MulLanes(t, acc, mul, mul5);
+    uint64_t sum[5];
+    for (int k = 0; k < 5; ++k) {
+        alignas(32) uint64_t lanes[4];
+        _mm256_store_si256((__m256i*)lanes, t[k]);
+        sum[k] = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    Carry(sum, h);
+    return groups * 64;
+}
+
+}
+
+#endif
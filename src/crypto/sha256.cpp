@@ -29,6 +29,21 @@ namespace sha256d64_avx2
 void Transform_8way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256_avx2
+{
+void Transform_8way(uint32_t* s, const unsigned char* const* blocks);
+}
+
+namespace sha256d64_avx512
+{
+void Transform_16way(unsigned char* out, const unsigned char* in);
+}
+
+namespace sha256_avx512
+{
+void Transform_16way(uint32_t* s, const unsigned char* const* blocks);
+}
+
 namespace sha256d64_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
@@ -416,6 +431,10 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+/** Process one 64-byte block for each of several independent states, in
+ *  parallel lanes. s holds 8 words of state per lane, one lane after the
+ *  other; blocks points to the block of each lane. */
+typedef void (*TransformMultiType)(uint32_t* s, const unsigned char* const* blocks);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -461,6 +480,18 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformD64Type TransformD64_16way = nullptr;
+TransformMultiType TransformMulti = nullptr;
+size_t TransformMultiLanes = 0;
+
+/** TransformMulti on top of the single-block Transform, one lane at a time. */
+template<size_t lanes>
+void TransformMultiWrapper(uint32_t* s, const unsigned char* const* blocks)
+{
+    for (size_t lane = 0; lane < lanes; ++lane) {
+        Transform(s + 8 * lane, blocks[lane], 1);
+    }
+}
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +575,43 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformD64_16way, if available, on the input above twice.
+    if (TransformD64_16way) {
+        unsigned char in[1024];
+        std::copy(data + 1, data + 513, in);
+        std::copy(data + 1, data + 513, in + 512);
+        unsigned char out[512];
+        TransformD64_16way(out, in);
+        if (!std::equal(out, out + 256, result_d64)) return false;
+        if (!std::equal(out + 256, out + 512, result_d64)) return false;
+    }
+
+    // Test TransformMulti, if available, by hashing 0 through 8 blocks of
+    // the input above in the lanes (repeating when there are more lanes).
+    if (TransformMulti) {
+        uint32_t states[16 * 8];
+        const unsigned char* blocks[16];
+        for (size_t lane = 0; lane < TransformMultiLanes; ++lane) {
+            std::copy(init, init + 8, states + 8 * lane);
+        }
+        for (size_t round = 0; round < 8; ++round) {
+            for (size_t lane = 0; lane < TransformMultiLanes; ++lane) {
+                // Lane i stops after (i % 9) blocks, by hashing a throwaway
+                // copy of its state from then on.
+                blocks[lane] = data + 1 + 64 * round;
+            }
+            uint32_t saved[16 * 8];
+            std::copy(states, states + 8 * TransformMultiLanes, saved);
+            TransformMulti(states, blocks);
+            for (size_t lane = 0; lane < TransformMultiLanes; ++lane) {
+                if (round >= lane % 9) std::copy(saved + 8 * lane, saved + 8 * lane + 8, states + 8 * lane);
+            }
+        }
+        for (size_t lane = 0; lane < TransformMultiLanes; ++lane) {
+            if (!std::equal(states + 8 * lane, states + 8 * lane + 8, result[lane % 9])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -555,6 +623,14 @@ bool AVXEnabled()
     __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
     return (a & 6) == 6;
 }
+
+/** Check whether the OS has enabled AVX-512 registers (on top of AVX). */
+bool AVX512Enabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 0xe6) == 0xe6;
+}
 #endif
 } // namespace
 
@@ -567,16 +643,21 @@ std::string SHA256AutoDetect()
     bool have_xsave = false;
     bool have_avx = false;
     bool have_avx2 = false;
+    bool have_avx512 = false;
     bool have_shani = false;
     bool enabled_avx = false;
+    bool enabled_avx512 = false;
 
     (void)AVXEnabled;
+    (void)AVX512Enabled;
     (void)have_sse4;
     (void)have_avx;
     (void)have_xsave;
     (void)have_avx2;
+    (void)have_avx512;
     (void)have_shani;
     (void)enabled_avx;
+    (void)enabled_avx512;
 
     uint32_t eax, ebx, ecx, edx;
     GetCPUID(1, 0, eax, ebx, ecx, edx);
@@ -585,10 +666,12 @@ std::string SHA256AutoDetect()
     have_avx = (ecx >> 28) & 1;
     if (have_xsave && have_avx) {
         enabled_avx = AVXEnabled();
+        enabled_avx512 = AVX512Enabled();
     }
     if (have_sse4) {
         GetCPUID(7, 0, eax, ebx, ecx, edx);
         have_avx2 = (ebx >> 5) & 1;
+        have_avx512 = (ebx >> 16) & 1;
         have_shani = (ebx >> 29) & 1;
     }
 
@@ -618,9 +701,20 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti = sha256_avx2::Transform_8way;
+        TransformMultiLanes = 8;
         ret += ",avx2(8way)";
     }
 #endif
+
+#if defined(ENABLE_AVX512) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx512 && have_avx && enabled_avx512) {
+        TransformD64_16way = sha256d64_avx512::Transform_16way;
+        TransformMulti = sha256_avx512::Transform_16way;
+        TransformMultiLanes = 16;
+        ret += ",avx512(16way)";
+    }
+#endif
 #endif
 
     assert(SelfTest());
@@ -686,6 +780,14 @@ CSHA256& CSHA256::Reset()
 
 void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
 {
+    if (TransformD64_16way) {
+        while (blocks >= 16) {
+            TransformD64_16way(out, in);
+            out += 512;
+            in += 1024;
+            blocks -= 16;
+        }
+    }
     if (TransformD64_8way) {
         while (blocks >= 8) {
             TransformD64_8way(out, in);
@@ -717,3 +819,106 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+static void SHA256MultiLanes(unsigned char* out, const unsigned char* const* in, const size_t* lengths, size_t count, TransformMultiType transform_multi, size_t lanes)
+{
+    /** A message being hashed in one of the lanes. */
+    struct Lane {
+        //! Index of the message, or count if the lane is idle.
+        size_t msg;
+        //! Number of blocks of the message processed so far.
+        size_t done{0};
+        //! Number of blocks that can be read from the message itself.
+        size_t full_blocks{0};
+        //! Number of blocks in the padded tail.
+        size_t total_blocks{0};
+        //! The last bytes of the message followed by the padding.
+        unsigned char tail[128];
+
+        const unsigned char* Block(const unsigned char* data, size_t i) const
+        {
+            return i < full_blocks ? data + 64 * i : tail + 64 * (i - full_blocks);
+        }
+    };
+
+    if (count < 2 || lanes == 0) {
+        for (size_t i = 0; i < count; ++i) {
+            CSHA256().Write(in[i], lengths[i]).Finalize(out + 32 * i);
+        }
+        return;
+    }
+
+    static const unsigned char idle_block[64] = {};
+    Lane lane[16];
+    uint32_t states[16 * 8] = {};
+    const unsigned char* blocks[16];
+    size_t next = 0;
+    size_t active = 0;
+    for (size_t l = 0; l < lanes; ++l) lane[l].msg = count;
+
+    while (true) {
+        // Start the next messages in the idle lanes.
+        for (size_t l = 0; l < lanes && next < count; ++l) {
+            if (lane[l].msg != count) continue;
+            Lane& cur = lane[l];
+            const size_t len = lengths[next];
+            const size_t rem = len % 64;
+            cur.msg = next++;
+            cur.done = 0;
+            cur.full_blocks = len / 64;
+            cur.total_blocks = cur.full_blocks + (rem < 56 ? 1 : 2);
+            const size_t tail_len = 64 * (cur.total_blocks - cur.full_blocks);
+            if (rem) memcpy(cur.tail, in[cur.msg] + 64 * cur.full_blocks, rem);
+            memset(cur.tail + rem, 0, tail_len - rem);
+            cur.tail[rem] = 0x80;
+            WriteBE64(cur.tail + tail_len - 8, uint64_t{len} << 3);
+            sha256::Initialize(states + 8 * l);
+            ++active;
+        }
+        if (active == 0) break;
+
+        // Once too few lanes are left busy, finish them one at a time.
+        if (next == count && active * 2 <= lanes) {
+            for (size_t l = 0; l < lanes; ++l) {
+                Lane& cur = lane[l];
+                if (cur.msg == count) continue;
+                uint32_t* s = states + 8 * l;
+                if (cur.done < cur.full_blocks) {
+                    Transform(s, in[cur.msg] + 64 * cur.done, cur.full_blocks - cur.done);
+                    cur.done = cur.full_blocks;
+                }
+                Transform(s, cur.Block(in[cur.msg], cur.done), cur.total_blocks - cur.done);
+                for (int i = 0; i < 8; ++i) WriteBE32(out + 32 * cur.msg + 4 * i, s[i]);
+            }
+            break;
+        }
+
+        for (size_t l = 0; l < lanes; ++l) {
+            blocks[l] = lane[l].msg == count ? idle_block : lane[l].Block(in[lane[l].msg], lane[l].done);
+        }
+        transform_multi(states, blocks);
+        for (size_t l = 0; l < lanes; ++l) {
+            Lane& cur = lane[l];
+            if (cur.msg == count || ++cur.done < cur.total_blocks) continue;
+            for (int i = 0; i < 8; ++i) WriteBE32(out + 32 * cur.msg + 4 * i, states[8 * l + i]);
+            cur.msg = count;
+            --active;
+        }
+    }
+}
+
+void SHA256Multi(unsigned char* out, const unsigned char* const* in, const size_t* lengths, size_t count)
+{
+    SHA256MultiLanes(out, in, lengths, count, TransformMulti, TransformMultiLanes);
+}
+
+void SHA256MultiWithLanes(unsigned char* out, const unsigned char* const* in, const size_t* lengths, size_t count, size_t lanes)
+{
+    switch (lanes) {
+    case 2: return SHA256MultiLanes(out, in, lengths, count, TransformMultiWrapper<2>, 2);
+    case 4: return SHA256MultiLanes(out, in, lengths, count, TransformMultiWrapper<4>, 4);
+    case 8: return SHA256MultiLanes(out, in, lengths, count, TransformMultiWrapper<8>, 8);
+    case 16: return SHA256MultiLanes(out, in, lengths, count, TransformMultiWrapper<16>, 16);
+    }
+    assert(false);
+}
@@ -38,4 +38,19 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute the single SHA256's of multiple independent messages, processing
+ *  several of them at once in SIMD lanes when the CPU supports it.
+ *  output:  pointer to a count*32 byte output buffer
+ *  inputs:  pointers to the count messages
+ *  lengths: the lengths of the count messages
+ *  count:   the number of hashes to compute.
+ */
+void SHA256Multi(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
+/** SHA256Multi(), with the given number of lanes (2, 4, 8 or 16) computed by
+ *  the single-block transform one after the other. This runs the lane
+ *  scheduling on any CPU, for testing.
+ */
+void SHA256MultiWithLanes(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count, size_t lanes);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -477,6 +477,23 @@ public:
             }
         return false;
     }
+
+    /** get_live_elements returns a copy of every element that has not been
+     * marked for erasure, e.g. to save the cache and insert them again after
+     * a restart.
+     *
+     * get_live_elements is not threadsafe with a concurrent insert.
+     *
+     * @returns the elements that would not be overwritten by an insert
+     */
+    std::vector<Element> get_live_elements() const
+    {
+        std::vector<Element> elements;
+        for (uint32_t i = 0; i < size; ++i) {
+            if (!collection_flags.bit_is_set(i)) elements.push_back(table[i]);
+        }
+        return elements;
+    }
 };
 } // namespace CuckooCache
 
@@ -16,6 +16,8 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <memory>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
@@ -298,6 +300,27 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    //! A point-in-time state of the database, released once the last copy goes away.
+    using Snapshot = std::shared_ptr<const leveldb::Snapshot>;
+
+    Snapshot GetSnapshot() const
+    {
+        return Snapshot(pdb->GetSnapshot(), [db = pdb](const leveldb::Snapshot* snapshot) { db->ReleaseSnapshot(snapshot); });
+    }
+
+    /**
+     * Create an iterator over the database state pinned by `snapshot`. Several
+     * iterators created from the same snapshot see the same data, even if the
+     * database is written to in the meantime. The caller must keep the snapshot
+     * alive for as long as the iterator is used.
+     */
+    CDBIterator *NewIterator(const Snapshot& snapshot)
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot.get();
+        return new CDBIterator(*this, pdb->NewIterator(options));
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -66,6 +66,7 @@
 #include <validationinterface.h>
 #include <walletinitinterface.h>
 
+#include <algorithm>
 #include <functional>
 #include <set>
 #include <stdint.h>
@@ -170,6 +171,7 @@ void Interrupt(NodeContext& node)
     if (g_coin_stats_index) {
         g_coin_stats_index->Interrupt();
     }
+    if (node.chainman) node.chainman->InterruptBackgroundValidation();
 }
 
 void Shutdown(NodeContext& node)
@@ -207,6 +209,7 @@ void Shutdown(NodeContext& node)
     // CScheduler/checkqueue, scheduler and load block thread.
     if (node.scheduler) node.scheduler->stop();
     if (node.chainman && node.chainman->m_load_block.joinable()) node.chainman->m_load_block.join();
+    if (node.chainman) node.chainman->StopBackgroundValidation();
     StopScriptCheckWorkerThreads();
 
     // After the threads that potentially access these pointers have been stopped,
@@ -220,6 +223,14 @@ void Shutdown(NodeContext& node)
         DumpMempool(*node.mempool);
     }
 
+    // The caches were loaded before the chainstate manager was created, so
+    // don't overwrite the saved ones if we didn't get that far.
+    if (node.chainman && node.args->GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIG_CACHE)) {
+        DumpSignatureCache(node.args->GetDataDirNet() / "sigcache.dat");
+        LOCK(cs_main);
+        DumpScriptExecutionCache(node.args->GetDataDirNet() / "scriptcache.dat");
+    }
+
     // Drop transactions we were still watching, and record fee estimations.
     if (node.fee_estimator) node.fee_estimator->Flush();
 
@@ -281,6 +292,7 @@ void Shutdown(NodeContext& node)
     UnregisterAllValidationInterfaces();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
     init::UnsetGlobals();
+    node.block_template_cache.reset();
     node.mempool.reset();
     node.fee_estimator.reset();
     node.chainman.reset();
@@ -391,10 +403,16 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-mempoolclusters", strprintf("Maintain a feerate linearization of each cluster of related mempool transactions and use it for block template construction, eviction and replacement checks (default: %u)", DEFAULT_MEMPOOL_CLUSTERS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s, signet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex(), signetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     argsman.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-bgpar=<n>", strprintf("Set the number of script verification threads used to validate the chain history of a loaded UTXO snapshot in the background (1 to %d, default: %d)",
+        MAX_SCRIPTCHECK_THREADS, DEFAULT_BACKGROUND_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-bgdbcache=<n>", strprintf("Percentage of the database cache given to background validation of a loaded UTXO snapshot's chain history while the snapshot chainstate is syncing; the split is reversed once it has caught up (1 to 99, default: %d)",
+        DEFAULT_BACKGROUND_DBCACHE_PERCENT), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-persistsigcache", strprintf("Whether to save the signature cache and the script execution cache on shutdown and load them on restart (default: %u)", DEFAULT_PERSIST_SIG_CACHE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex, -coinstatsindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
@@ -1086,6 +1104,11 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    if (args.GetBoolArg("-persistsigcache", DEFAULT_PERSIST_SIG_CACHE)) {
+        LoadSignatureCache(args.GetDataDirNet() / "sigcache.dat");
+        LOCK(cs_main);
+        LoadScriptExecutionCache(args.GetDataDirNet() / "scriptcache.dat");
+    }
 
     int script_threads = args.GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
     if (script_threads <= 0) {
@@ -1172,7 +1195,8 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     assert(!node.mempool);
     int check_ratio = std::min<int>(std::max<int>(args.GetArg("-checkmempool", chainparams.DefaultConsistencyChecks() ? 1 : 0), 0), 1000000);
-    node.mempool = std::make_unique<CTxMemPool>(node.fee_estimator.get(), check_ratio);
+    const size_t change_log_size = CTxMemPool::ChangeLogSizeForLimit(args.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000);
+    node.mempool = std::make_unique<CTxMemPool>(node.fee_estimator.get(), check_ratio, args.GetBoolArg("-mempoolclusters", DEFAULT_MEMPOOL_CLUSTERS), change_log_size);
 
     assert(!node.chainman);
     node.chainman = std::make_unique<ChainstateManager>();
@@ -1183,6 +1207,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                                      *node.scheduler, chainman, *node.mempool, ignores_incoming_txs);
     RegisterValidationInterface(node.peerman.get());
 
+    assert(!node.block_template_cache);
+    node.block_template_cache = std::make_unique<BlockTemplateCache>(chainman, *node.mempool, chainparams);
+    RegisterValidationInterface(node.block_template_cache.get());
+
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
     for (const std::string& cmt : args.GetArgs("-uacomment")) {
@@ -1346,11 +1374,16 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
         do {
             const int64_t load_block_index_start_time = GetTimeMillis();
+            int64_t load_chainstate_start_time{0};
+            int64_t verify_start_time{0};
             try {
                 LOCK(cs_main);
                 chainman.InitializeChainstate(*Assert(node.mempool));
                 chainman.m_total_coinstip_cache = nCoinCacheUsage;
                 chainman.m_total_coinsdb_cache = nCoinDBCache;
+                chainman.m_background_cache_percent = args.GetArg("-bgdbcache", DEFAULT_BACKGROUND_DBCACHE_PERCENT);
+                // Background validation has its own threads, again counting the thread connecting the blocks
+                chainman.m_background_script_threads = std::clamp<int>(args.GetArg("-bgpar", DEFAULT_BACKGROUND_SCRIPTCHECK_THREADS) - 1, 0, MAX_SCRIPTCHECK_THREADS);
 
                 UnloadBlockIndex(node.mempool.get(), chainman);
 
@@ -1403,6 +1436,8 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
                 // At this point we're either in reindex or we've loaded a useful
                 // block tree into BlockIndex()!
+                load_chainstate_start_time = GetTimeMillis();
+                node.startup_times.block_index = load_chainstate_start_time - load_block_index_start_time;
 
                 bool failed_chainstate_init = false;
 
@@ -1469,6 +1504,8 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
             }
 
             bool failed_verification = false;
+            verify_start_time = GetTimeMillis();
+            node.startup_times.chainstate = verify_start_time - load_chainstate_start_time;
 
             try {
                 LOCK(cs_main);
@@ -1510,7 +1547,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
             if (!failed_verification) {
                 fLoaded = true;
+                node.startup_times.verify = GetTimeMillis() - verify_start_time;
                 LogPrintf(" block index %15dms\n", GetTimeMillis() - load_block_index_start_time);
+                LogPrintf("Startup: loaded block index in %dms, chainstate in %dms, verified blocks in %dms\n",
+                          node.startup_times.block_index, node.startup_times.chainstate, node.startup_times.verify);
             }
         } while(false);
 
@@ -1543,6 +1583,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     }
 
     // ********************************************************* Step 8: start indexers
+    const int64_t indexes_start_time = GetTimeMillis();
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         g_txindex = std::make_unique<TxIndex>(nTxIndexCache, false, fReindex);
         if (!g_txindex->Start(chainman.ActiveChainstate())) {
@@ -1564,12 +1605,17 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         }
     }
 
+    node.startup_times.indexes = GetTimeMillis() - indexes_start_time;
+
     // ********************************************************* Step 9: load wallet
+    const int64_t wallets_start_time = GetTimeMillis();
     for (const auto& client : node.chain_clients) {
         if (!client->load()) {
             return false;
         }
     }
+    node.startup_times.wallets = GetTimeMillis() - wallets_start_time;
+    LogPrintf("Startup: started indexes in %dms, loaded wallets in %dms\n", node.startup_times.indexes, node.startup_times.wallets);
 
     // ********************************************************* Step 10: data directory maintenance
 
@@ -8,6 +8,8 @@
 
 #include <clientversion.h>
 #include <compat/sanity.h>
+#include <crypto/chacha20.h>
+#include <crypto/poly1305.h>
 #include <crypto/sha256.h>
 #include <key.h>
 #include <logging.h>
@@ -27,6 +29,8 @@ void SetGlobals()
 {
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    LogPrintf("Using the '%s' ChaCha20 implementation\n", ChaCha20AutoDetect());
+    LogPrintf("Using the '%s' Poly1305 implementation\n", Poly1305AutoDetect());
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
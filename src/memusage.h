@@ -7,10 +7,13 @@
 
 #include <indirectmap.h>
 #include <prevector.h>
+#include <support/allocators/pool.h>
 
 #include <stdlib.h>
 
+#include <algorithm>
 #include <cassert>
+#include <deque>
 #include <map>
 #include <memory>
 #include <set>
@@ -89,6 +92,16 @@ static inline size_t DynamicUsage(const std::vector<X>& v)
     return MallocUsage(v.capacity() * sizeof(X));
 }
 
+template<typename X>
+static inline size_t DynamicUsage(const std::deque<X>& v)
+{
+    // Estimated for libstdc++, which stores the elements in blocks of 512
+    // bytes (or of one element, if larger), plus an array of block pointers.
+    const size_t block_elements = sizeof(X) < 512 ? 512 / sizeof(X) : 1;
+    const size_t blocks = v.size() / block_elements + 1;
+    return MallocUsage(block_elements * sizeof(X)) * blocks + MallocUsage(std::max<size_t>(blocks + 2, 8) * sizeof(void*));
+}
+
 template<unsigned int N, typename X, typename S, typename D>
 static inline size_t DynamicUsage(const prevector<N, X, S, D>& v)
 {
@@ -167,6 +180,27 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+template <class Key, class T, class Hash, class Pred, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const std::unordered_map<Key,
+                                                           T,
+                                                           Hash,
+                                                           Pred,
+                                                           PoolAllocator<std::pair<const Key, T>,
+                                                                         MAX_BLOCK_SIZE_BYTES,
+                                                                         ALIGN_BYTES>>& m)
+{
+    auto* pool_resource = m.get_allocator().resource();
+
+    // The allocated chunks are stored in a std::list. Size per node should
+    // therefore be 3 pointers: next, previous, and a pointer to the chunk.
+    size_t estimated_list_node_size = MallocUsage(sizeof(void*) * 3);
+    size_t usage_resource = estimated_list_node_size * pool_resource->NumAllocatedChunks();
+    // Blocks sitting in the freelists are reused before any new chunk is
+    // allocated, so erasing entries makes room for new ones: don't count them.
+    size_t usage_chunks = MallocUsage(pool_resource->ChunkSizeBytes()) * pool_resource->NumAllocatedChunks() - pool_resource->FreeListBytes();
+    return usage_resource + usage_chunks + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 }
 
 #endif // BITCOIN_MEMUSAGE_H
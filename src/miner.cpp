@@ -18,8 +18,10 @@
 #include <pow.h>
 #include <primitives/transaction.h>
 #include <timedata.h>
+#include <txcluster.h>
 #include <util/moneystr.h>
 #include <util/system.h>
+#include <util/time.h>
 
 #include <algorithm>
 #include <utility>
@@ -56,14 +58,19 @@ BlockAssembler::Options::Options() {
     nBlockMaxWeight = DEFAULT_BLOCK_MAX_WEIGHT;
 }
 
+static unsigned int ClampBlockMaxWeight(size_t nBlockMaxWeight)
+{
+    // Limit weight to between 4K and MAX_BLOCK_WEIGHT-4K for sanity:
+    return std::max<size_t>(4000, std::min<size_t>(MAX_BLOCK_WEIGHT - 4000, nBlockMaxWeight));
+}
+
 BlockAssembler::BlockAssembler(CChainState& chainstate, const CTxMemPool& mempool, const CChainParams& params, const Options& options)
     : chainparams(params),
       m_mempool(mempool),
       m_chainstate(chainstate)
 {
     blockMinFeeRate = options.blockMinFeeRate;
-    // Limit weight to between 4K and MAX_BLOCK_WEIGHT-4K for sanity:
-    nBlockMaxWeight = std::max<size_t>(4000, std::min<size_t>(MAX_BLOCK_WEIGHT - 4000, options.nBlockMaxWeight));
+    nBlockMaxWeight = ClampBlockMaxWeight(options.nBlockMaxWeight);
 }
 
 static BlockAssembler::Options DefaultOptions()
@@ -146,7 +153,11 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
-    addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+    if (m_mempool.HasClusters()) {
+        addChunkTxs(nPackagesSelected);
+    } else {
+        addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+    }
 
     int64_t nTime1 = GetTimeMicros();
 
@@ -434,6 +445,273 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     }
 }
 
+// With cluster tracking, the mempool keeps each cluster's linearization split
+// into chunks of non-increasing feerate, and every chunk includes all of its
+// in-mempool ancestors that are not in an earlier chunk of the cluster. Block
+// construction then reduces to merging the clusters' chunk sequences by
+// feerate, without computing any ancestor sets.
+void BlockAssembler::addChunkTxs(int& nPackagesSelected)
+{
+    const TxClusterSet& clusters = m_mempool.GetClusters();
+
+    // Heap of the next chunk to consider from each cluster, best feerate first.
+    using ChunkRef = std::pair<const TxCluster*, size_t>;
+    auto compare = [](const ChunkRef& a, const ChunkRef& b) {
+        const TxClusterChunk& chunk_a = a.first->m_chunks[a.second];
+        const TxClusterChunk& chunk_b = b.first->m_chunks[b.second];
+        const int cmp = CompareFeeFrac(chunk_a.fee, chunk_a.size, chunk_b.fee, chunk_b.size);
+        if (cmp != 0) return cmp < 0;
+        return a.first->m_id > b.first->m_id;
+    };
+    std::vector<ChunkRef> heap;
+    heap.reserve(clusters.Size());
+    for (const auto& [id, cluster] : clusters.GetClusters()) {
+        heap.emplace_back(cluster.get(), 0);
+    }
+    std::make_heap(heap.begin(), heap.end(), compare);
+
+    // Same early exit heuristic as addPackageTxs().
+    const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
+    int64_t nConsecutiveFailed = 0;
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), compare);
+        const auto [cluster, chunk_index] = heap.back();
+        heap.pop_back();
+        const TxClusterChunk& chunk = cluster->m_chunks[chunk_index];
+
+        if (chunk.fee < blockMinFeeRate.GetFee(chunk.size)) {
+            // Everything else we might consider has a lower fee rate
+            return;
+        }
+
+        CTxMemPool::setEntries package;
+        int64_t packageSigOpsCost = 0;
+        for (size_t i = cluster->ChunkBegin(chunk_index); i < chunk.end; ++i) {
+            package.insert(m_mempool.mapTx.iterator_to(*cluster->m_txs[i]));
+            packageSigOpsCost += cluster->m_txs[i]->GetSigOpCost();
+        }
+
+        // If a chunk can't be added, the rest of its cluster is skipped as
+        // well, since later chunks may spend from it.
+        if (!TestPackage(chunk.size, packageSigOpsCost)) {
+            ++nConsecutiveFailed;
+
+            if (nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES && nBlockWeight >
+                    nBlockMaxWeight - 4000) {
+                // Give up if we're close to full and haven't succeeded in a while
+                break;
+            }
+            continue;
+        }
+        if (!TestPackageTransactions(package)) {
+            continue;
+        }
+
+        // This chunk will make it in; reset the failed counter.
+        nConsecutiveFailed = 0;
+
+        // The linearization order is a valid block order.
+        for (size_t i = cluster->ChunkBegin(chunk_index); i < chunk.end; ++i) {
+            AddToBlock(m_mempool.mapTx.iterator_to(*cluster->m_txs[i]));
+        }
+        ++nPackagesSelected;
+
+        if (chunk_index + 1 < cluster->m_chunks.size()) {
+            heap.emplace_back(cluster, chunk_index + 1);
+            std::push_heap(heap.begin(), heap.end(), compare);
+        }
+    }
+}
+
+BlockTemplateCache::BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const CChainParams& params, const BlockAssembler::Options& options)
+    : m_chainman(chainman),
+      m_mempool(mempool),
+      m_chainparams(params),
+      m_options(options),
+      m_block_max_weight(ClampBlockMaxWeight(options.nBlockMaxWeight))
+{
+}
+
+BlockTemplateCache::BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const CChainParams& params)
+    : BlockTemplateCache(chainman, mempool, params, DefaultOptions()) {}
+
+void BlockTemplateCache::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence)
+{
+    LOCK(m_pending_mutex);
+    // Changes from before the last request are already reflected.
+    if (!m_active || mempool_sequence < m_template_sequence) return;
+    m_pending_sequence = mempool_sequence + 1;
+    if (m_pending_overflow) return;
+    if (m_pending_added.size() >= MAX_BLOCK_TEMPLATE_PENDING_TXS) {
+        m_pending_added.clear();
+        m_pending_overflow = true;
+        return;
+    }
+    m_pending_added.push_back(tx->GetHash());
+}
+
+void BlockTemplateCache::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
+{
+    LOCK(m_pending_mutex);
+    if (!m_active || mempool_sequence < m_template_sequence) return;
+    m_pending_sequence = mempool_sequence + 1;
+    ++m_pending_removed;
+}
+
+std::unique_ptr<CBlockTemplate> BlockTemplateCache::GetTemplate(const CScript& scriptPubKeyIn)
+{
+    LOCK2(cs_main, m_mempool.cs);
+    const uint64_t sequence{m_mempool.GetSequence()};
+    std::vector<uint256> added;
+    size_t removed;
+    bool overflow, missed;
+    {
+        LOCK(m_pending_mutex);
+        m_active = true;
+        added.swap(m_pending_added);
+        removed = std::exchange(m_pending_removed, 0);
+        overflow = std::exchange(m_pending_overflow, false);
+        // Notifications for the latest changes may still be queued.
+        missed = std::max(m_pending_sequence, m_template_sequence) < sequence;
+        m_template_sequence = sequence;
+    }
+    const unsigned int transactions_updated{m_mempool.GetTransactionsUpdated()};
+
+    if (!m_template || m_tip != m_chainman.ActiveChain().Tip() || m_script_pub_key != scriptPubKeyIn || overflow || missed) {
+        Rebuild(scriptPubKeyIn);
+    } else {
+        // Every notified addition and removal counts as one update; any
+        // other update (e.g. a fee delta) may change the best selection.
+        if (transactions_updated - m_transactions_updated != added.size() + removed) m_improvable = true;
+        bool changed = removed > 0 && DropRemovedTxs();
+        for (const uint256& txid : added) {
+            changed |= AppendTx(txid);
+        }
+        if (m_improvable && GetTime<std::chrono::seconds>() - m_last_rebuild >= BLOCK_TEMPLATE_REBUILD_INTERVAL) {
+            Rebuild(scriptPubKeyIn);
+        } else if (changed) {
+            UpdateCoinbase();
+        }
+    }
+    m_transactions_updated = transactions_updated;
+    return std::make_unique<CBlockTemplate>(*m_template);
+}
+
+void BlockTemplateCache::Rebuild(const CScript& scriptPubKeyIn)
+{
+    CChainState& chainstate = m_chainman.ActiveChainstate();
+    // Don't keep updating the old template if assembling fails.
+    m_template.reset();
+    m_template = BlockAssembler(chainstate, m_mempool, m_chainparams, m_options).CreateNewBlock(scriptPubKeyIn);
+    m_script_pub_key = scriptPubKeyIn;
+    m_tip = chainstate.m_chain.Tip();
+    m_last_rebuild = GetTime<std::chrono::seconds>();
+    m_improvable = false;
+
+    // Recover the assembler's accounting from the template.
+    const CBlock& block = m_template->block;
+    m_txids.clear();
+    m_block_weight = 4000;
+    m_block_sigops_cost = 400;
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        m_txids.insert(block.vtx[i]->GetHash());
+        m_block_weight += GetTransactionWeight(*block.vtx[i]);
+        m_block_sigops_cost += m_template->vTxSigOpsCost[i];
+    }
+    m_fees = -m_template->vTxFees[0];
+    m_lock_time_cutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                         ? m_tip->GetMedianTimePast()
+                         : block.GetBlockTime();
+    m_include_witness = IsWitnessEnabled(m_tip, m_chainparams.GetConsensus());
+}
+
+bool BlockTemplateCache::DropRemovedTxs()
+{
+    CBlock& block = m_template->block;
+    std::unordered_set<uint256, SaltedTxidHasher> dropped;
+    size_t kept = 1;
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        bool drop = !m_mempool.exists(tx.GetHash());
+        for (const CTxIn& txin : tx.vin) {
+            drop |= dropped.count(txin.prevout.hash) > 0;
+        }
+        if (drop) {
+            dropped.insert(tx.GetHash());
+            m_txids.erase(tx.GetHash());
+            m_block_weight -= GetTransactionWeight(tx);
+            m_block_sigops_cost -= m_template->vTxSigOpsCost[i];
+            m_fees -= m_template->vTxFees[i];
+            continue;
+        }
+        block.vtx[kept] = std::move(block.vtx[i]);
+        m_template->vTxFees[kept] = m_template->vTxFees[i];
+        m_template->vTxSigOpsCost[kept] = m_template->vTxSigOpsCost[i];
+        ++kept;
+    }
+    block.vtx.resize(kept);
+    m_template->vTxFees.resize(kept);
+    m_template->vTxSigOpsCost.resize(kept);
+    // The freed space may now fit packages that were left out.
+    if (!dropped.empty()) m_improvable = true;
+    return !dropped.empty();
+}
+
+bool BlockTemplateCache::AppendTx(const uint256& txid)
+{
+    if (m_txids.count(txid)) return false;
+    const std::optional<CTxMemPool::txiter> it = m_mempool.GetIter(txid);
+    if (!it) return false;
+    const CTxMemPoolEntry& entry = **it;
+
+    for (const CTxMemPoolEntry& parent : entry.GetMemPoolParentsConst()) {
+        if (!m_txids.count(parent.GetTx().GetHash())) {
+            // A rebuild may select it together with its missing ancestors.
+            if (entry.GetModFeesWithAncestors() >= m_options.blockMinFeeRate.GetFee(entry.GetSizeWithAncestors())) {
+                m_improvable = true;
+            }
+            return false;
+        }
+    }
+    if (entry.GetModifiedFee() < m_options.blockMinFeeRate.GetFee(entry.GetTxSize())) return false;
+    // Same limits as BlockAssembler::TestPackage()
+    if (m_block_weight + WITNESS_SCALE_FACTOR * entry.GetTxSize() >= m_block_max_weight ||
+        m_block_sigops_cost + entry.GetSigOpCost() >= MAX_BLOCK_SIGOPS_COST) {
+        m_improvable = true;
+        return false;
+    }
+    if (!IsFinalTx(entry.GetTx(), m_tip->nHeight + 1, m_lock_time_cutoff)) return false;
+    if (!m_include_witness && entry.GetTx().HasWitness()) return false;
+
+    m_template->block.vtx.emplace_back(entry.GetSharedTx());
+    m_template->vTxFees.push_back(entry.GetFee());
+    m_template->vTxSigOpsCost.push_back(entry.GetSigOpCost());
+    m_txids.insert(txid);
+    m_block_weight += entry.GetTxWeight();
+    m_block_sigops_cost += entry.GetSigOpCost();
+    m_fees += entry.GetFee();
+    return true;
+}
+
+void BlockTemplateCache::UpdateCoinbase()
+{
+    CBlock& block = m_template->block;
+    CMutableTransaction coinbaseTx{*block.vtx[0]};
+    const int commitpos = GetWitnessCommitmentIndex(block);
+    if (commitpos != NO_WITNESS_COMMITMENT) {
+        coinbaseTx.vout.erase(coinbaseTx.vout.begin() + commitpos);
+    }
+    coinbaseTx.vin[0].scriptWitness.SetNull();
+    coinbaseTx.vout[0].nValue = m_fees + GetBlockSubsidy(m_tip->nHeight + 1, m_chainparams.GetConsensus());
+    block.vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+    m_template->vchCoinbaseCommitment = GenerateCoinbaseCommitment(block, m_tip, m_chainparams.GetConsensus());
+    m_template->vTxFees[0] = -m_fees;
+
+    BlockAssembler::m_last_block_num_txs = block.vtx.size() - 1;
+    BlockAssembler::m_last_block_weight = m_block_weight;
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
@@ -7,12 +7,17 @@
 #define BITCOIN_MINER_H
 
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
+#include <util/hasher.h>
 #include <validation.h>
+#include <validationinterface.h>
 
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <stdint.h>
+#include <unordered_set>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -24,6 +29,12 @@ class CScript;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Minimum time between full rebuilds of a cached block template that is not
+ *  as good as a freshly assembled one would be */
+static constexpr std::chrono::seconds BLOCK_TEMPLATE_REBUILD_INTERVAL{5};
+/** Maximum number of mempool additions queued for a cached block template.
+ *  Beyond this the template is rebuilt on the next request instead. */
+static constexpr size_t MAX_BLOCK_TEMPLATE_PENDING_TXS{10000};
 
 struct CBlockTemplate
 {
@@ -176,6 +187,10 @@ private:
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
       * statistics from the package selection (for logging statistics). */
     void addPackageTxs(int& nPackagesSelected, int& nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
+    /** Add transactions by merging the chunks of the mempool's cluster
+      * linearizations in feerate order. Requires a mempool that tracks
+      * clusters. Increments nPackagesSelected for every chunk added. */
+    void addChunkTxs(int& nPackagesSelected) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
 
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
@@ -198,6 +213,88 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set& mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(m_mempool.cs);
 };
 
+/**
+ * Keeps the most recent block template and updates it as transactions enter
+ * and leave the mempool, so that template requests don't have to assemble
+ * and validate a block from scratch every time.
+ *
+ * Mempool changes arrive through the validation interface and are applied on
+ * the next request, provided the notifications for all of them were received
+ * by then (which the mempool sequence numbers tell). Transactions that left the mempool are dropped from the
+ * template together with their in-template descendants. New transactions are
+ * appended if their in-mempool parents are all in the template and they fit.
+ * Appended transactions were fully validated on mempool acceptance, so
+ * TestBlockValidity only runs when the template is assembled from scratch.
+ *
+ * That happens when the tip or the coinbase script changes, and when
+ * incremental updates left the template worse than a fresh one might be (a
+ * transaction did not fit or lacked its parents, or transactions were
+ * dropped, or the mempool changed in ways that are not notified, like
+ * prioritisetransaction), at most once per BLOCK_TEMPLATE_REBUILD_INTERVAL.
+ */
+class BlockTemplateCache final : public CValidationInterface
+{
+public:
+    explicit BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const CChainParams& params);
+    explicit BlockTemplateCache(ChainstateManager& chainman, const CTxMemPool& mempool, const CChainParams& params, const BlockAssembler::Options& options);
+
+    /** Return a copy of the current template for the active tip, with a
+     *  coinbase paying to scriptPubKeyIn */
+    std::unique_ptr<CBlockTemplate> GetTemplate(const CScript& scriptPubKeyIn) EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+protected:
+    void TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) override EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) override EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+
+private:
+    /** Assemble a new template from scratch */
+    void Rebuild(const CScript& scriptPubKeyIn) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool.cs);
+    /** Drop transactions that are no longer in the mempool, and their
+      * descendants. Returns whether any were dropped. */
+    bool DropRemovedTxs() EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool.cs);
+    /** Append a mempool transaction if it can go at the end of the template.
+      * Returns whether it was added. */
+    bool AppendTx(const uint256& txid) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool.cs);
+    /** Update the coinbase value and witness commitment after the template's
+      * transactions changed */
+    void UpdateCoinbase() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    ChainstateManager& m_chainman;
+    const CTxMemPool& m_mempool;
+    const CChainParams& m_chainparams;
+    const BlockAssembler::Options m_options;
+    const uint64_t m_block_max_weight;
+
+    Mutex m_pending_mutex;
+    //! Whether a template has been requested, before which no changes are queued
+    bool m_active GUARDED_BY(m_pending_mutex){false};
+    //! Mempool sequence number up to which the template reflects the mempool
+    uint64_t m_template_sequence GUARDED_BY(m_pending_mutex){0};
+    //! Mempool sequence number following the last change received
+    uint64_t m_pending_sequence GUARDED_BY(m_pending_mutex){0};
+    //! Transactions added to the mempool since the last request
+    std::vector<uint256> m_pending_added GUARDED_BY(m_pending_mutex);
+    //! Number of transactions that left the mempool since the last request
+    size_t m_pending_removed GUARDED_BY(m_pending_mutex){0};
+    //! Whether too many changes were queued to apply them one by one
+    bool m_pending_overflow GUARDED_BY(m_pending_mutex){false};
+
+    std::unique_ptr<CBlockTemplate> m_template GUARDED_BY(cs_main);
+    CScript m_script_pub_key GUARDED_BY(cs_main);
+    const CBlockIndex* m_tip GUARDED_BY(cs_main){nullptr};
+    std::chrono::seconds m_last_rebuild GUARDED_BY(cs_main){0};
+    //! CTxMemPool::GetTransactionsUpdated() as of the last request
+    unsigned int m_transactions_updated GUARDED_BY(cs_main){0};
+    //! Whether a rebuild might find a better template
+    bool m_improvable GUARDED_BY(cs_main){false};
+    std::unordered_set<uint256, SaltedTxidHasher> m_txids GUARDED_BY(cs_main);
+    uint64_t m_block_weight GUARDED_BY(cs_main){0};
+    int64_t m_block_sigops_cost GUARDED_BY(cs_main){0};
+    CAmount m_fees GUARDED_BY(cs_main){0};
+    int64_t m_lock_time_cutoff GUARDED_BY(cs_main){0};
+    bool m_include_witness GUARDED_BY(cs_main){false};
+};
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
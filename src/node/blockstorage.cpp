@@ -17,8 +17,17 @@
 #include <streams.h>
 #include <undo.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <optional>
+
+//! Maximum number of threads reading block files ahead of the one being
+//! imported during -reindex. The memory held by the blocks read ahead is
+//! bounded by g_external_block_budget.
+static constexpr int MAX_REINDEX_READ_THREADS{4};
+
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fHavePruned = false;
@@ -500,23 +509,54 @@ void ThreadImport(ChainstateManager& chainman, std::vector<fs::path> vImportFile
 
         // -reindex
         if (fReindex) {
-            int nFile = 0;
-            while (true) {
-                FlatFilePos pos(nFile, 0);
-                if (!fs::exists(GetBlockPosFilename(pos))) {
-                    break; // No block files left to reindex
+            int num_files = 0;
+            while (fs::exists(GetBlockPosFilename(FlatFilePos(num_files, 0)))) {
+                num_files++;
+            }
+            // Reading the block files and the context-free block checks run
+            // on several threads, ahead of the file being imported as far as
+            // g_external_block_budget allows. Blocks are imported one file
+            // after the other, in file order.
+            std::vector<std::optional<std::vector<ExternalBlock>>> files(num_files);
+            auto release_file = [&](int nFile) {
+                for (const ExternalBlock& block : *files[nFile]) {
+                    g_external_block_budget.Release(block.size);
+                }
+            };
+            auto read_file = [&](int nFile) {
+                FILE* file = OpenBlockFile(FlatFilePos(nFile, 0), true);
+                if (file) { // The error is logged in OpenBlockFile
+                    files[nFile] = ReadExternalBlockFile(file, nFile, Params());
                 }
-                FILE* file = OpenBlockFile(pos, true);
-                if (!file) {
-                    break; // This error is logged in OpenBlockFile
+                return true;
+            };
+            auto import_file = [&](int nFile) {
+                if (!files[nFile]) {
+                    g_external_block_budget.StopReadAhead();
+                    return false;
                 }
                 LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-                chainman.ActiveChainstate().LoadExternalBlockFile(file, &pos);
+                // The file being imported no longer counts as read ahead.
+                release_file(nFile);
+                chainman.ActiveChainstate().LoadExternalBlocks(*files[nFile]);
+                files[nFile].reset();
                 if (ShutdownRequested()) {
-                    LogPrintf("Shutdown requested. Exit %s\n", __func__);
-                    return;
+                    g_external_block_budget.StopReadAhead();
+                    return false;
                 }
-                nFile++;
+                g_external_block_budget.SetNextFile(nFile + 1);
+                return true;
+            };
+            const int num_threads = std::clamp(GetNumCores() - 1, 1, MAX_REINDEX_READ_THREADS);
+            g_external_block_budget.StartReadAhead(0);
+            util::ForEachShard(num_files, num_threads, "reindex", read_file, import_file);
+            g_external_block_budget.StopReadAhead();
+            for (int nFile = 0; nFile < num_files; ++nFile) {
+                if (files[nFile]) release_file(nFile);
+            }
+            if (ShutdownRequested()) {
+                LogPrintf("Shutdown requested. Exit %s\n", __func__);
+                return;
             }
             pblocktree->WriteReindexing(false);
             fReindex = false;
@@ -11,10 +11,14 @@
 #include <index/coinstatsindex.h>
 #include <serialize.h>
 #include <uint256.h>
+#include <txdb.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <map>
+#include <vector>
 
 // Database-independent metric indicating the UTXO set size
 uint64_t GetBogoSize(const CScript& script_pub_key)
@@ -47,7 +51,8 @@ CDataStream TxOutSer(const COutPoint& outpoint, const Coin& coin) {
 //! It is also possible, though very unlikely, that a change in this
 //! construction could cause a previously invalid (and potentially malicious)
 //! UTXO snapshot to be considered valid.
-static void ApplyHash(CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+template <typename Stream>
+static void ApplyHash(Stream& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
 {
     for (auto it = outputs.begin(); it != outputs.end(); ++it) {
         if (it == outputs.begin()) {
@@ -87,37 +92,36 @@ static void ApplyStats(CCoinsStats& stats, const uint256& hash, const std::map<u
     }
 }
 
-//! Calculate statistics about the unspent transaction output set
-template <typename T>
-static bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point, const CBlockIndex* pindex)
-{
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
-
-    if (!pindex) {
-        {
-            LOCK(cs_main);
-            pindex = blockman.LookupBlockIndex(view->GetBestBlock());
-        }
-    }
-    stats.nHeight = Assert(pindex)->nHeight;
-    stats.hashBlock = pindex->GetBlockHash();
+//! Maximum number of threads used to iterate over the coins database.
+static constexpr int MAX_COINS_SHARD_THREADS{8};
 
-    // Use CoinStatsIndex if it is requested and available and a hash_type of Muhash or None was requested
-    if ((stats.m_hash_type == CoinStatsHashType::MUHASH || stats.m_hash_type == CoinStatsHashType::NONE) && g_coin_stats_index && stats.index_requested) {
-        stats.index_used = true;
-        return g_coin_stats_index->LookUpStats(pindex, stats);
-    }
+int GetCoinsShardThreads()
+{
+    return std::clamp(GetNumCores() - 1, 1, MAX_COINS_SHARD_THREADS);
+}
 
-    PrepareHash(hash_obj, stats);
+bool ForEachCoinsShard(const CCoinsViewDB& db, const CDBWrapper::Snapshot& snapshot, int num_threads,
+                       const std::function<bool(int shard, CCoinsViewCursor& cursor)>& process_shard,
+                       const std::function<bool(int shard)>& consume_shard,
+                       const std::function<void()>& interruption_point)
+{
+    return util::ForEachShard(
+        CCoinsViewDB::SHARD_COUNT, num_threads, "coinshard",
+        [&](int shard) { return process_shard(shard, *db.Cursor(shard, snapshot)); },
+        consume_shard, interruption_point);
+}
 
+//! Add the coins from the cursor to the statistics and hash
+template <typename T>
+static bool ApplyCoins(CCoinsViewCursor& cursor, CCoinsStats& stats, T& hash_obj, const std::function<void()>& interruption_point)
+{
     uint256 prevkey;
     std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
-        interruption_point();
+    while (cursor.Valid()) {
+        if (interruption_point) interruption_point();
         COutPoint key;
         Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+        if (cursor.GetKey(key) && cursor.GetValue(coin)) {
             if (!outputs.empty() && key.hash != prevkey) {
                 ApplyStats(stats, prevkey, outputs);
                 ApplyHash(hash_obj, prevkey, outputs);
@@ -129,12 +133,94 @@ static bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats&
         } else {
             return error("%s: unable to read value", __func__);
         }
-        pcursor->Next();
+        cursor.Next();
     }
     if (!outputs.empty()) {
         ApplyStats(stats, prevkey, outputs);
         ApplyHash(hash_obj, prevkey, outputs);
     }
+    return true;
+}
+
+// Shards are hashed separately, then combined in key order. For the legacy
+// hash, which depends on the order of the coins, that means collecting the
+// serialized data of each shard to feed it to the hasher in order.
+static CDataStream MakeShardHash(const CHashWriter& ss) { return CDataStream(SER_GETHASH, PROTOCOL_VERSION); }
+static MuHash3072 MakeShardHash(const MuHash3072& muhash) { return {}; }
+static std::nullptr_t MakeShardHash(std::nullptr_t) { return nullptr; }
+
+static void CombineShardHash(CHashWriter& ss, CDataStream& shard_ss)
+{
+    ss.write((const char*)shard_ss.data(), shard_ss.size());
+    shard_ss = CDataStream(SER_GETHASH, PROTOCOL_VERSION);
+}
+static void CombineShardHash(MuHash3072& muhash, MuHash3072& shard_muhash) { muhash *= shard_muhash; }
+static void CombineShardHash(std::nullptr_t, std::nullptr_t) {}
+
+//! Add the coins of the database to the statistics and hash, in parallel shards
+template <typename T>
+static bool ApplyCoinsSharded(const CCoinsViewDB& db, const CDBWrapper::Snapshot& snapshot, CCoinsStats& stats, T& hash_obj, const std::function<void()>& interruption_point)
+{
+    using ShardHash = decltype(MakeShardHash(hash_obj));
+    std::vector<CCoinsStats> shard_stats(CCoinsViewDB::SHARD_COUNT, CCoinsStats{stats.m_hash_type});
+    std::vector<ShardHash> shard_hashes(CCoinsViewDB::SHARD_COUNT, MakeShardHash(hash_obj));
+
+    return ForEachCoinsShard(
+        db, snapshot, GetCoinsShardThreads(),
+        [&](int shard, CCoinsViewCursor& cursor) {
+            return ApplyCoins(cursor, shard_stats[shard], shard_hashes[shard], {});
+        },
+        [&](int shard) {
+            const CCoinsStats& part = shard_stats[shard];
+            stats.nTransactions += part.nTransactions;
+            stats.nTransactionOutputs += part.nTransactionOutputs;
+            stats.nTotalAmount += part.nTotalAmount;
+            stats.nBogoSize += part.nBogoSize;
+            stats.coins_count += part.coins_count;
+            CombineShardHash(hash_obj, shard_hashes[shard]);
+            return true;
+        },
+        interruption_point);
+}
+
+//! Calculate statistics about the unspent transaction output set
+template <typename T>
+static bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point, const CBlockIndex* pindex)
+{
+    // Iterate over the coins database in parallel key ranges if we can, all
+    // reading from the same snapshot of the database.
+    const CCoinsViewDB* db{dynamic_cast<const CCoinsViewDB*>(view)};
+    CDBWrapper::Snapshot snapshot;
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    if (db) {
+        snapshot = db->GetSnapshot();
+    } else {
+        pcursor = view->Cursor();
+        assert(pcursor);
+    }
+
+    if (!pindex) {
+        {
+            LOCK(cs_main);
+            pindex = blockman.LookupBlockIndex(view->GetBestBlock());
+        }
+    }
+    stats.nHeight = Assert(pindex)->nHeight;
+    stats.hashBlock = pindex->GetBlockHash();
+
+    // Use CoinStatsIndex if it is requested and available and a hash_type of Muhash or None was requested
+    if ((stats.m_hash_type == CoinStatsHashType::MUHASH || stats.m_hash_type == CoinStatsHashType::NONE) && g_coin_stats_index && stats.index_requested) {
+        stats.index_used = true;
+        return g_coin_stats_index->LookUpStats(pindex, stats);
+    }
+
+    PrepareHash(hash_obj, stats);
+
+    if (db) {
+        if (!ApplyCoinsSharded(*db, snapshot, stats, hash_obj, interruption_point)) return false;
+    } else {
+        if (!ApplyCoins(*pcursor, stats, hash_obj, interruption_point)) return false;
+    }
 
     FinalizeHash(hash_obj, stats);
 
@@ -9,6 +9,7 @@
 #include <amount.h>
 #include <chain.h>
 #include <coins.h>
+#include <dbwrapper.h>
 #include <streams.h>
 #include <uint256.h>
 
@@ -17,6 +18,7 @@
 
 class BlockManager;
 class CCoinsView;
+class CCoinsViewDB;
 
 enum class CoinStatsHashType {
     HASH_SERIALIZED,
@@ -61,6 +63,26 @@ struct CCoinsStats
 //! Calculate statistics about the unspent transaction output set
 bool GetUTXOStats(CCoinsView* view, BlockManager& blockman, CCoinsStats& stats, const std::function<void()>& interruption_point = {}, const CBlockIndex* pindex = nullptr);
 
+/**
+ * Iterate over a coins database in CCoinsViewDB::SHARD_COUNT key ranges, as of
+ * `snapshot`, using up to `num_threads` threads.
+ *
+ * process_shard is called concurrently for different shards, with a cursor
+ * over the coins of that shard. consume_shard is called on the calling thread
+ * for each shard in key order, once it has been processed, so that results
+ * combined there are deterministic. Only a few shards per thread are processed
+ * ahead of the one being consumed, to bound the memory used by their results.
+ *
+ * @returns false if process_shard or consume_shard returned false
+ */
+bool ForEachCoinsShard(const CCoinsViewDB& db, const CDBWrapper::Snapshot& snapshot, int num_threads,
+                       const std::function<bool(int shard, CCoinsViewCursor& cursor)>& process_shard,
+                       const std::function<bool(int shard)>& consume_shard,
+                       const std::function<void()>& interruption_point = {});
+
+//! Number of threads to iterate over the coins database with in ForEachCoinsShard().
+int GetCoinsShardThreads();
+
 uint64_t GetBogoSize(const CScript& script_pub_key);
 
 CDataStream TxOutSer(const COutPoint& outpoint, const Coin& coin);
@@ -7,6 +7,7 @@
 #include <addrman.h>
 #include <banman.h>
 #include <interfaces/chain.h>
+#include <miner.h>
 #include <net.h>
 #include <net_processing.h>
 #include <policy/fees.h>
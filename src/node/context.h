@@ -6,12 +6,14 @@
 #define BITCOIN_NODE_CONTEXT_H
 
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <vector>
 
 class ArgsManager;
 class BanMan;
+class BlockTemplateCache;
 class CAddrMan;
 class CBlockPolicyEstimator;
 class CConnman;
@@ -46,6 +48,7 @@ struct NodeContext {
     std::unique_ptr<PeerManager> peerman;
     std::unique_ptr<ChainstateManager> chainman;
     std::unique_ptr<BanMan> banman;
+    std::unique_ptr<BlockTemplateCache> block_template_cache;
     ArgsManager* args{nullptr}; // Currently a raw pointer because the memory is not managed by this struct
     std::unique_ptr<interfaces::Chain> chain;
     //! List of all chain clients (wallet processes or other client) connected to node.
@@ -56,6 +59,16 @@ struct NodeContext {
     std::unique_ptr<CScheduler> scheduler;
     std::function<void()> rpc_interruption_point = [] {};
 
+    //! Time taken by the steps of node startup, in milliseconds, see the
+    //! getstartupinfo RPC.
+    struct StartupTimes {
+        int64_t block_index{0};
+        int64_t chainstate{0};
+        int64_t verify{0};
+        int64_t indexes{0};
+        int64_t wallets{0};
+    } startup_times;
+
     //! Declare default constructor and destructor that are not inline, so code
     //! instantiating the NodeContext struct doesn't need to #include class
     //! definitions for all the unique_ptr members.
@@ -0,0 +1 @@
+#define BUILD_GIT_COMMIT "10cb71d7d735-dirty"
@@ -409,6 +409,36 @@ static bool rest_mempool_contents(const std::any& context, HTTPRequest* req, con
     }
 }
 
+static bool rest_mempool_changes(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req)) return false;
+    const CTxMemPool* mempool = GetMemPool(context, req);
+    if (!mempool) return false;
+    std::string sequence_str;
+    const RetFormat rf = ParseDataFormat(sequence_str, strURIPart);
+
+    uint64_t sequence;
+    if (!ParseUInt64(sequence_str, &sequence)) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid mempool sequence: " + SanitizeString(sequence_str));
+    }
+
+    switch (rf) {
+    case RetFormat::JSON: {
+        const std::optional<MempoolChanges> changes = mempool->GetChangesSince(sequence);
+        if (!changes) {
+            return RESTERR(req, HTTP_NOT_FOUND, "Mempool changes since this sequence are not available");
+        }
+        std::string strJSON = MempoolChangesToJSON(*changes).write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
 static bool rest_tx(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -717,6 +747,7 @@ static const struct {
       {"/rest/chaininfo", rest_chaininfo},
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
+      {"/rest/mempool/changes/", rest_mempool_changes},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
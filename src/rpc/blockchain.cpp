@@ -22,7 +22,6 @@
 #include <policy/feerate.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
-#include <policy/rbf.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -33,6 +32,7 @@
 #include <txmempool.h>
 #include <undo.h>
 #include <util/strencodings.h>
+#include <util/string.h>
 #include <util/system.h>
 #include <util/translation.h>
 #include <validation.h>
@@ -476,36 +476,31 @@ static std::vector<RPCResult> MempoolEntryDescription() { return {
     RPCResult{RPCResult::Type::BOOL, "unbroadcast", "Whether this transaction is currently unbroadcast (initial broadcast not yet acknowledged by any peers)"},
 };}
 
-static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPoolEntry& e) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+static void entryToJSON(UniValue& info, const MempoolEntrySnapshot& e, bool unbroadcast)
 {
-    AssertLockHeld(pool.cs);
-
     UniValue fees(UniValue::VOBJ);
-    fees.pushKV("base", ValueFromAmount(e.GetFee()));
-    fees.pushKV("modified", ValueFromAmount(e.GetModifiedFee()));
-    fees.pushKV("ancestor", ValueFromAmount(e.GetModFeesWithAncestors()));
-    fees.pushKV("descendant", ValueFromAmount(e.GetModFeesWithDescendants()));
+    fees.pushKV("base", ValueFromAmount(e.fee));
+    fees.pushKV("modified", ValueFromAmount(e.modified_fee));
+    fees.pushKV("ancestor", ValueFromAmount(e.mod_fees_with_ancestors));
+    fees.pushKV("descendant", ValueFromAmount(e.mod_fees_with_descendants));
     info.pushKV("fees", fees);
 
-    info.pushKV("vsize", (int)e.GetTxSize());
-    info.pushKV("weight", (int)e.GetTxWeight());
-    info.pushKV("fee", ValueFromAmount(e.GetFee()));
-    info.pushKV("modifiedfee", ValueFromAmount(e.GetModifiedFee()));
-    info.pushKV("time", count_seconds(e.GetTime()));
-    info.pushKV("height", (int)e.GetHeight());
-    info.pushKV("descendantcount", e.GetCountWithDescendants());
-    info.pushKV("descendantsize", e.GetSizeWithDescendants());
-    info.pushKV("descendantfees", e.GetModFeesWithDescendants());
-    info.pushKV("ancestorcount", e.GetCountWithAncestors());
-    info.pushKV("ancestorsize", e.GetSizeWithAncestors());
-    info.pushKV("ancestorfees", e.GetModFeesWithAncestors());
-    info.pushKV("wtxid", pool.vTxHashes[e.vTxHashesIdx].first.ToString());
-    const CTransaction& tx = e.GetTx();
+    info.pushKV("vsize", e.vsize);
+    info.pushKV("weight", e.weight);
+    info.pushKV("fee", ValueFromAmount(e.fee));
+    info.pushKV("modifiedfee", ValueFromAmount(e.modified_fee));
+    info.pushKV("time", count_seconds(e.time));
+    info.pushKV("height", (int)e.height);
+    info.pushKV("descendantcount", e.count_with_descendants);
+    info.pushKV("descendantsize", e.size_with_descendants);
+    info.pushKV("descendantfees", e.mod_fees_with_descendants);
+    info.pushKV("ancestorcount", e.count_with_ancestors);
+    info.pushKV("ancestorsize", e.size_with_ancestors);
+    info.pushKV("ancestorfees", e.mod_fees_with_ancestors);
+    info.pushKV("wtxid", e.wtxid.ToString());
     std::set<std::string> setDepends;
-    for (const CTxIn& txin : tx.vin)
-    {
-        if (pool.exists(txin.prevout.hash))
-            setDepends.insert(txin.prevout.hash.ToString());
+    for (const uint256& parent : e.parents) {
+        setDepends.insert(parent.ToString());
     }
 
     UniValue depends(UniValue::VARR);
@@ -517,25 +512,14 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
     info.pushKV("depends", depends);
 
     UniValue spent(UniValue::VARR);
-    const CTxMemPool::txiter& it = pool.mapTx.find(tx.GetHash());
-    const CTxMemPoolEntry::Children& children = it->GetMemPoolChildrenConst();
-    for (const CTxMemPoolEntry& child : children) {
-        spent.push_back(child.GetTx().GetHash().ToString());
+    for (const uint256& child : e.children) {
+        spent.push_back(child.ToString());
     }
 
     info.pushKV("spentby", spent);
 
-    // Add opt-in RBF status
-    bool rbfStatus = false;
-    RBFTransactionState rbfState = IsRBFOptIn(tx, pool);
-    if (rbfState == RBFTransactionState::UNKNOWN) {
-        throw JSONRPCError(RPC_MISC_ERROR, "Transaction is not in mempool");
-    } else if (rbfState == RBFTransactionState::REPLACEABLE_BIP125) {
-        rbfStatus = true;
-    }
-
-    info.pushKV("bip125-replaceable", rbfStatus);
-    info.pushKV("unbroadcast", pool.IsUnbroadcastTx(tx.GetHash()));
+    info.pushKV("bip125-replaceable", e.bip125_replaceable);
+    info.pushKV("unbroadcast", unbroadcast);
 }
 
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempool_sequence)
@@ -544,16 +528,18 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempoo
         if (include_mempool_sequence) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbose results cannot contain mempool sequence values.");
         }
-        LOCK(pool.cs);
+        // Serialize from a snapshot, so that the mempool lock is only held
+        // for taking it (if it is not already up to date).
+        const std::shared_ptr<const MempoolSnapshot> snapshot = pool.GetSnapshot();
+        const std::set<uint256> unbroadcast = pool.GetUnbroadcastTxs();
         UniValue o(UniValue::VOBJ);
-        for (const CTxMemPoolEntry& e : pool.mapTx) {
-            const uint256& hash = e.GetTx().GetHash();
+        for (const MempoolEntrySnapshot& e : snapshot->entries) {
             UniValue info(UniValue::VOBJ);
-            entryToJSON(pool, info, e);
+            entryToJSON(info, e, unbroadcast.count(e.txid) > 0);
             // Mempool has unique entries so there is no advantage in using
             // UniValue::pushKV, which checks if the key already exists in O(N).
             // UniValue::__pushKV is used instead which currently is O(1).
-            o.__pushKV(hash.ToString(), info);
+            o.__pushKV(e.txid.ToString(), info);
         }
         return o;
     } else {
@@ -660,35 +646,43 @@ static RPCHelpMan getmempoolancestors()
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
 
     const CTxMemPool& mempool = EnsureAnyMemPool(request.context);
-    LOCK(mempool.cs);
+    std::vector<MempoolEntrySnapshot> ancestors;
+    std::set<uint256> unbroadcast;
+    {
+        LOCK(mempool.cs);
 
-    CTxMemPool::txiter it = mempool.mapTx.find(hash);
-    if (it == mempool.mapTx.end()) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
-    }
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end()) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
+        }
 
-    CTxMemPool::setEntries setAncestors;
-    uint64_t noLimit = std::numeric_limits<uint64_t>::max();
-    std::string dummy;
-    mempool.CalculateMemPoolAncestors(*it, setAncestors, noLimit, noLimit, noLimit, noLimit, dummy, false);
+        CTxMemPool::setEntries setAncestors;
+        uint64_t noLimit = std::numeric_limits<uint64_t>::max();
+        std::string dummy;
+        mempool.CalculateMemPoolAncestors(*it, setAncestors, noLimit, noLimit, noLimit, noLimit, dummy, false);
 
-    if (!fVerbose) {
-        UniValue o(UniValue::VARR);
-        for (CTxMemPool::txiter ancestorIt : setAncestors) {
-            o.push_back(ancestorIt->GetTx().GetHash().ToString());
+        if (!fVerbose) {
+            UniValue o(UniValue::VARR);
+            for (CTxMemPool::txiter ancestorIt : setAncestors) {
+                o.push_back(ancestorIt->GetTx().GetHash().ToString());
+            }
+            return o;
         }
-        return o;
-    } else {
-        UniValue o(UniValue::VOBJ);
+        // Copy the entries, and serialize them without holding the lock.
+        ancestors.reserve(setAncestors.size());
         for (CTxMemPool::txiter ancestorIt : setAncestors) {
-            const CTxMemPoolEntry &e = *ancestorIt;
-            const uint256& _hash = e.GetTx().GetHash();
-            UniValue info(UniValue::VOBJ);
-            entryToJSON(mempool, info, e);
-            o.pushKV(_hash.ToString(), info);
+            ancestors.push_back(mempool.SnapshotEntry(*ancestorIt));
         }
-        return o;
+        unbroadcast = mempool.GetUnbroadcastTxs();
+    }
+
+    UniValue o(UniValue::VOBJ);
+    for (const MempoolEntrySnapshot& e : ancestors) {
+        UniValue info(UniValue::VOBJ);
+        entryToJSON(info, e, unbroadcast.count(e.txid) > 0);
+        o.pushKV(e.txid.ToString(), info);
     }
+    return o;
 },
     };
 }
@@ -724,36 +718,44 @@ static RPCHelpMan getmempooldescendants()
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
 
     const CTxMemPool& mempool = EnsureAnyMemPool(request.context);
-    LOCK(mempool.cs);
+    std::vector<MempoolEntrySnapshot> descendants;
+    std::set<uint256> unbroadcast;
+    {
+        LOCK(mempool.cs);
 
-    CTxMemPool::txiter it = mempool.mapTx.find(hash);
-    if (it == mempool.mapTx.end()) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
-    }
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end()) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
+        }
 
-    CTxMemPool::setEntries setDescendants;
-    mempool.CalculateDescendants(it, setDescendants);
-    // CTxMemPool::CalculateDescendants will include the given tx
-    setDescendants.erase(it);
+        CTxMemPool::setEntries setDescendants;
+        mempool.CalculateDescendants(it, setDescendants);
+        // CTxMemPool::CalculateDescendants will include the given tx
+        setDescendants.erase(it);
 
-    if (!fVerbose) {
-        UniValue o(UniValue::VARR);
-        for (CTxMemPool::txiter descendantIt : setDescendants) {
-            o.push_back(descendantIt->GetTx().GetHash().ToString());
-        }
+        if (!fVerbose) {
+            UniValue o(UniValue::VARR);
+            for (CTxMemPool::txiter descendantIt : setDescendants) {
+                o.push_back(descendantIt->GetTx().GetHash().ToString());
+            }
 
-        return o;
-    } else {
-        UniValue o(UniValue::VOBJ);
+            return o;
+        }
+        // Copy the entries, and serialize them without holding the lock.
+        descendants.reserve(setDescendants.size());
         for (CTxMemPool::txiter descendantIt : setDescendants) {
-            const CTxMemPoolEntry &e = *descendantIt;
-            const uint256& _hash = e.GetTx().GetHash();
-            UniValue info(UniValue::VOBJ);
-            entryToJSON(mempool, info, e);
-            o.pushKV(_hash.ToString(), info);
+            descendants.push_back(mempool.SnapshotEntry(*descendantIt));
         }
-        return o;
+        unbroadcast = mempool.GetUnbroadcastTxs();
     }
+
+    UniValue o(UniValue::VOBJ);
+    for (const MempoolEntrySnapshot& e : descendants) {
+        UniValue info(UniValue::VOBJ);
+        entryToJSON(info, e, unbroadcast.count(e.txid) > 0);
+        o.pushKV(e.txid.ToString(), info);
+    }
+    return o;
 },
     };
 }
@@ -776,16 +778,22 @@ static RPCHelpMan getmempoolentry()
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
 
     const CTxMemPool& mempool = EnsureAnyMemPool(request.context);
-    LOCK(mempool.cs);
+    MempoolEntrySnapshot entry;
+    bool unbroadcast;
+    {
+        LOCK(mempool.cs);
+
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end()) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
+        }
 
-    CTxMemPool::txiter it = mempool.mapTx.find(hash);
-    if (it == mempool.mapTx.end()) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction not in mempool");
+        entry = mempool.SnapshotEntry(*it);
+        unbroadcast = mempool.IsUnbroadcastTx(hash);
     }
 
-    const CTxMemPoolEntry &e = *it;
     UniValue info(UniValue::VOBJ);
-    entryToJSON(mempool, info, e);
+    entryToJSON(info, entry, unbroadcast);
     return info;
 },
     };
@@ -1574,10 +1582,10 @@ static RPCHelpMan getchaintips()
     std::set<const CBlockIndex*> setOrphans;
     std::set<const CBlockIndex*> setPrevs;
 
-    for (const std::pair<const uint256, CBlockIndex*>& item : chainman.BlockIndex()) {
-        if (!active_chain.Contains(item.second)) {
-            setOrphans.insert(item.second);
-            setPrevs.insert(item.second->pprev);
+    for (const std::pair<const uint256, CBlockIndex>& item : chainman.BlockIndex()) {
+        if (!active_chain.Contains(&item.second)) {
+            setOrphans.insert(&item.second);
+            setPrevs.insert(item.second.pprev);
         }
     }
 
@@ -1630,6 +1638,66 @@ static RPCHelpMan getchaintips()
     };
 }
 
+UniValue MempoolChangesToJSON(const MempoolChanges& changes)
+{
+    UniValue added(UniValue::VARR);
+    for (const uint256& txid : changes.added) {
+        added.push_back(txid.ToString());
+    }
+    UniValue removed(UniValue::VARR);
+    for (const uint256& txid : changes.removed) {
+        removed.push_back(txid.ToString());
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("mempool_sequence", changes.sequence);
+    ret.pushKV("added", added);
+    ret.pushKV("removed", removed);
+    return ret;
+}
+
+static RPCHelpMan getmempoolchanges()
+{
+    return RPCHelpMan{"getmempoolchanges",
+                "\nReturns the transactions added to and removed from the mempool since the given mempool sequence number.\n"
+                "\nStart from the mempool_sequence of getrawmempool(false, true) and pass each result's mempool_sequence\n"
+                "to the next call to keep a copy of the mempool's transaction ids in sync. Only the most recent\n"
+                + ToString(MAX_MEMPOOL_CHANGE_LOG_SIZE) + " changes are kept; older sequence numbers require a resync with getrawmempool.\n",
+                {
+                    {"mempool_sequence", RPCArg::Type::NUM, RPCArg::Optional::NO, "The mempool sequence number to return changes since"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence value after the returned changes"},
+                        {RPCResult::Type::ARR, "added", "Transactions added since the given sequence and still in the mempool, in the order they were added",
+                        {
+                            {RPCResult::Type::STR_HEX, "", "The transaction id"},
+                        }},
+                        {RPCResult::Type::ARR, "removed", "Transactions removed since the given sequence and not added again",
+                        {
+                            {RPCResult::Type::STR_HEX, "", "The transaction id"},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getmempoolchanges", "1000")
+            + HelpExampleRpc("getmempoolchanges", "1000")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const int64_t since = request.params[0].get_int64();
+    if (since < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative mempool sequence");
+    }
+
+    const std::optional<MempoolChanges> changes = EnsureAnyMemPool(request.context).GetChangesSince(since);
+    if (!changes) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Mempool changes since this sequence are not available, resync with getrawmempool");
+    }
+    return MempoolChangesToJSON(*changes);
+},
+    };
+}
+
 UniValue MempoolInfoToJSON(const CTxMemPool& pool)
 {
     // Make sure this call is atomic in the pool.
@@ -2564,9 +2632,84 @@ static RPCHelpMan dumptxoutset()
     };
 }
 
+static RPCHelpMan loadtxoutset()
+{
+    return RPCHelpMan{
+        "loadtxoutset",
+        "\nLoad a serialized UTXO set, as written by dumptxoutset, into a snapshot chainstate and make it the active chainstate.\n"
+        "The snapshot must be based on a block known to the headers chain for which an assumeutxo hash is configured.\n"
+        "Coins are deserialized on a separate thread while the coins cache is populated.\n",
+        {
+            {"path",
+                RPCArg::Type::STR,
+                RPCArg::Optional::NO,
+                /* default_val */ "",
+                "path to the snapshot file. If relative, will be prefixed by datadir."},
+        },
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::NUM, "coins_loaded", "the number of coins loaded from the snapshot"},
+                    {RPCResult::Type::STR_HEX, "tip_hash", "the hash of the base of the snapshot"},
+                    {RPCResult::Type::NUM, "base_height", "the height of the base of the snapshot"},
+                    {RPCResult::Type::STR, "path", "the absolute path that the snapshot was loaded from"},
+                    {RPCResult::Type::NUM, "load_time", "the time spent loading the coins and writing them to disk, in seconds"},
+                    {RPCResult::Type::NUM, "coins_per_second", "the load throughput"},
+                    {RPCResult::Type::NUM, "peak_cache_usage", "the highest memory usage of the coins cache during the load, in bytes"},
+                }
+        },
+        RPCExamples{
+            HelpExampleCli("loadtxoutset", "utxo.dat")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const fs::path path = fsbridge::AbsPathJoin(gArgs.GetDataDirNet(), request.params[0].get_str());
+
+    FILE* file{fsbridge::fopen(path, "rb")};
+    CAutoFile afile{file, SER_DISK, CLIENT_VERSION};
+    if (afile.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Couldn't open file " + path.string() + " for reading");
+    }
+
+    SnapshotMetadata metadata;
+    try {
+        afile >> metadata;
+    } catch (const std::ios_base::failure&) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Unable to read snapshot metadata from " + path.string());
+    }
+
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    if (!WITH_LOCK(::cs_main, return chainman.m_blockman.LookupBlockIndex(metadata.m_base_blockhash))) {
+        throw JSONRPCError(RPC_MISC_ERROR,
+            strprintf("The base block header (%s) must appear in the headers chain. Make sure all headers are syncing, and call this RPC again.",
+                metadata.m_base_blockhash.ToString()));
+    }
+
+    SnapshotLoadStats stats;
+    if (!chainman.ActivateSnapshot(afile, metadata, /* in_memory */ false, &stats)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to load UTXO snapshot " + path.string() + ", see debug log for details");
+    }
+    // Validate the chain history up to the snapshot base in the background.
+    chainman.StartBackgroundValidation();
+    const CBlockIndex* new_tip{WITH_LOCK(::cs_main, return chainman.ActiveTip())};
+
+    const double load_seconds{count_microseconds(stats.load_time) * 0.000001};
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("coins_loaded", stats.coins_loaded);
+    result.pushKV("tip_hash", new_tip->GetBlockHash().ToString());
+    result.pushKV("base_height", new_tip->nHeight);
+    result.pushKV("path", path.string());
+    result.pushKV("load_time", load_seconds);
+    result.pushKV("coins_per_second", load_seconds > 0 ? stats.coins_loaded / load_seconds : 0);
+    result.pushKV("peak_cache_usage", (uint64_t)stats.peak_cache_usage);
+    return result;
+},
+    };
+}
+
 UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFile& afile)
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor;
+    CDBWrapper::Snapshot db_snapshot;
     CCoinsStats stats{CoinStatsHashType::NONE};
     CBlockIndex* tip;
 
@@ -2576,9 +2719,8 @@ UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFil
         // based upon the coinsdb, and (iii) constructing a cursor to the
         // coinsdb for use below this block.
         //
-        // Cursors returned by leveldb iterate over snapshots, so the contents
-        // of the pcursor will not be affected by simultaneous writes during
-        // use below this block.
+        // The coins are read from a leveldb snapshot, so they will not be
+        // affected by simultaneous writes during use below this block.
         //
         // See discussion here:
         //   https://github.com/bitcoin/bitcoin/pull/15606#discussion_r274479369
@@ -2591,7 +2733,7 @@ UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFil
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
         }
 
-        pcursor = chainstate.CoinsDB().Cursor();
+        db_snapshot = chainstate.CoinsDB().GetSnapshot();
         tip = chainstate.m_blockman.LookupBlockIndex(stats.hashBlock);
         CHECK_NONFATAL(tip);
     }
@@ -2600,19 +2742,31 @@ UniValue CreateUTXOSnapshot(NodeContext& node, CChainState& chainstate, CAutoFil
 
     afile << metadata;
 
-    COutPoint key;
-    Coin coin;
-    unsigned int iter{0};
-
-    while (pcursor->Valid()) {
-        if (iter % 5000 == 0) node.rpc_interruption_point();
-        ++iter;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            afile << key;
-            afile << coin;
-        }
-
-        pcursor->Next();
+    // Serialize the coins of each key range in parallel, and write them to the
+    // file in key order.
+    std::vector<CDataStream> shard_data(CCoinsViewDB::SHARD_COUNT, CDataStream{afile.GetType(), afile.GetVersion()});
+    const bool read_ok = ForEachCoinsShard(
+        chainstate.CoinsDB(), db_snapshot, GetCoinsShardThreads(),
+        [&](int shard, CCoinsViewCursor& cursor) {
+            COutPoint key;
+            Coin coin;
+            while (cursor.Valid()) {
+                if (cursor.GetKey(key) && cursor.GetValue(coin)) {
+                    shard_data[shard] << key;
+                    shard_data[shard] << coin;
+                }
+                cursor.Next();
+            }
+            return true;
+        },
+        [&](int shard) {
+            afile.write((const char*)shard_data[shard].data(), shard_data[shard].size());
+            shard_data[shard] = CDataStream{afile.GetType(), afile.GetVersion()};
+            return true;
+        },
+        node.rpc_interruption_point);
+    if (!read_ok) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
     }
 
     afile.fclose();
@@ -2644,6 +2798,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         &getmempoolancestors,                },
     { "blockchain",         &getmempooldescendants,              },
     { "blockchain",         &getmempoolentry,                    },
+    { "blockchain",         &getmempoolchanges,                  },
     { "blockchain",         &getmempoolinfo,                     },
     { "blockchain",         &getrawmempool,                      },
     { "blockchain",         &gettxout,                           },
@@ -2664,6 +2819,7 @@ static const CRPCCommand commands[] =
     { "hidden",              &waitforblockheight,                },
     { "hidden",              &syncwithvalidationinterfacequeue,  },
     { "hidden",              &dumptxoutset,                      },
+    { "hidden",              &loadtxoutset,                      },
 };
 // clang-format on
     for (const auto& c : commands) {
@@ -23,6 +23,7 @@ class CChainState;
 class CTxMemPool;
 class ChainstateManager;
 class UniValue;
+struct MempoolChanges;
 struct NodeContext;
 
 static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
@@ -47,6 +48,9 @@ UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 /** Mempool to JSON */
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose = false, bool include_mempool_sequence = false);
 
+/** Mempool changes to JSON */
+UniValue MempoolChangesToJSON(const MempoolChanges& changes);
+
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex) LOCKS_EXCLUDED(cs_main);
 
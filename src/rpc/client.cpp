@@ -160,6 +160,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "setnetworkactive", 0, "state" },
     { "setwalletflag", 1, "value" },
     { "getmempoolancestors", 1, "verbose" },
+    { "getmempoolchanges", 0, "mempool_sequence" },
     { "getmempooldescendants", 1, "verbose" },
     { "bumpfee", 1, "options" },
     { "psbtbumpfee", 1, "options" },
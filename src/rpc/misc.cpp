@@ -19,10 +19,12 @@
 #include <rpc/util.h>
 #include <scheduler.h>
 #include <script/descriptor.h>
+#include <script/sigcache.h>
 #include <util/check.h>
 #include <util/message.h> // For MessageSign(), MessageVerify()
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <validation.h>
 
 #include <stdint.h>
 #include <tuple>
@@ -547,6 +549,84 @@ static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     }
 }
 
+static RPCHelpMan getstartupinfo()
+{
+    return RPCHelpMan{"getstartupinfo",
+                "Returns how long the steps of node startup took.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "blockindex", "Milliseconds spent loading the block index"},
+                        {RPCResult::Type::NUM, "chainstate", "Milliseconds spent loading the chainstate (coins database and chain tip)"},
+                        {RPCResult::Type::NUM, "verify", "Milliseconds spent verifying the latest blocks (-checkblocks)"},
+                        {RPCResult::Type::NUM, "indexes", "Milliseconds spent starting the optional indexes"},
+                        {RPCResult::Type::NUM, "wallets", "Milliseconds spent loading the wallets"},
+                        {RPCResult::Type::NUM, "total", "Sum of the above, in milliseconds"},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getstartupinfo", "")
+            + HelpExampleRpc("getstartupinfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const NodeContext::StartupTimes& times = EnsureAnyNodeContext(request.context).startup_times;
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("blockindex", times.block_index);
+    obj.pushKV("chainstate", times.chainstate);
+    obj.pushKV("verify", times.verify);
+    obj.pushKV("indexes", times.indexes);
+    obj.pushKV("wallets", times.wallets);
+    obj.pushKV("total", times.block_index + times.chainstate + times.verify + times.indexes + times.wallets);
+    return obj;
+},
+    };
+}
+
+static UniValue SigCacheCountersToJSON(const SigCacheCounters& counters)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("hits", counters.hits);
+    obj.pushKV("misses", counters.misses);
+    obj.pushKV("inserts", counters.inserts);
+    obj.pushKV("max_entries", counters.max_entries);
+    return obj;
+}
+
+static RPCHelpMan getsigcacheinfo()
+{
+    const std::vector<RPCResult> counters{
+        {RPCResult::Type::NUM, "hits", "Number of lookups that found their entry"},
+        {RPCResult::Type::NUM, "misses", "Number of lookups that did not find their entry"},
+        {RPCResult::Type::NUM, "inserts", "Number of entries added, including those that evicted older ones"},
+        {RPCResult::Type::NUM, "max_entries", "Number of entries the cache can hold"},
+    };
+    return RPCHelpMan{"getsigcacheinfo",
+                "Returns how the signature cache and the script execution cache were used since startup.\n"
+                "Both take half of -maxsigcachesize.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "signatures", "The signature cache", counters},
+                        {RPCResult::Type::OBJ, "scripts", "The script execution cache", counters},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getsigcacheinfo", "")
+            + HelpExampleRpc("getsigcacheinfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("signatures", SigCacheCountersToJSON(GetSignatureCacheCounters()));
+    obj.pushKV("scripts", SigCacheCountersToJSON(WITH_LOCK(cs_main, return GetScriptExecutionCacheCounters())));
+    return obj;
+},
+    };
+}
+
 static RPCHelpMan logging()
 {
     return RPCHelpMan{"logging",
@@ -753,6 +833,8 @@ static const CRPCCommand commands[] =
 { //  category              actor (function)
   //  --------------------- ------------------------
     { "control",            &getmemoryinfo,           },
+    { "control",            &getstartupinfo,          },
+    { "control",            &getsigcacheinfo,         },
     { "control",            &logging,                 },
     { "util",               &validateaddress,         },
     { "util",               &createmultisig,          },
@@ -53,7 +53,8 @@ bool CastToBool(const valtype& vch)
  */
 #define stacktop(i)  (stack.at(stack.size()+(i)))
 #define altstacktop(i)  (altstack.at(altstack.size()+(i)))
-static inline void popstack(std::vector<valtype>& stack)
+template <typename Stack>
+static inline void popstack(Stack& stack)
 {
     if (stack.empty())
         throw std::runtime_error("popstack(): stack empty");
@@ -428,7 +429,25 @@ static bool EvalChecksig(const valtype& sig, const valtype& pubkey, CScript::con
     assert(false);
 }
 
-bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
+namespace {
+/** Evaluation stacks of VerifyScript(), kept per thread so that the script
+ *  checks a thread runs (such as a CCheckQueue worker) reuse their buffers. */
+struct ScriptStackArena {
+    ScriptStack stack;
+    ScriptStack stack_copy;
+    ScriptStack altstack;
+    ScriptStack witness_stack;
+};
+
+ScriptStackArena& GetScriptStackArena()
+{
+    static thread_local ScriptStackArena arena;
+    return arena;
+}
+} // namespace
+
+template <typename Stack>
+static bool EvalScriptOnStacks(Stack& stack, Stack& altstack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
 {
     static const CScriptNum bnZero(0);
     static const CScriptNum bnOne(1);
@@ -447,7 +466,6 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     opcodetype opcode;
     valtype vchPushValue;
     ConditionStack vfExec;
-    std::vector<valtype> altstack;
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
     if ((sigversion == SigVersion::BASE || sigversion == SigVersion::WITNESS_V0) && script.size() > MAX_SCRIPT_SIZE) {
         return set_error(serror, SCRIPT_ERR_SCRIPT_SIZE);
@@ -820,8 +838,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x -- x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
-                    stack.push_back(vch);
+                    stack.push_back(stacktop(-1));
                 }
                 break;
 
@@ -1053,19 +1070,21 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     valtype& vch = stacktop(-1);
-                    valtype vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
+                    unsigned char vchHash[CSHA256::OUTPUT_SIZE];
+                    const size_t hash_size = (opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32;
                     if (opcode == OP_RIPEMD160)
-                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA1)
-                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA256)
-                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_HASH160)
-                        CHash160().Write(vch).Finalize(vchHash);
+                        CHash160().Write(vch).Finalize(Span<unsigned char>(vchHash, hash_size));
                     else if (opcode == OP_HASH256)
-                        CHash256().Write(vch).Finalize(vchHash);
+                        CHash256().Write(vch).Finalize(Span<unsigned char>(vchHash, hash_size));
+                    // Pushing right after the pop reuses the buffer of the hashed element.
                     popstack(stack);
-                    stack.push_back(vchHash);
+                    stack.emplace_back(vchHash, vchHash + hash_size);
                 }
                 break;
 
@@ -1258,12 +1277,31 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     return set_success(serror);
 }
 
+bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
+{
+    std::vector<valtype> altstack;
+    return EvalScriptOnStacks(stack, altstack, script, flags, checker, sigversion, execdata, serror);
+}
+
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
 {
     ScriptExecutionData execdata;
     return EvalScript(stack, script, flags, checker, sigversion, execdata, serror);
 }
 
+static bool EvalScript(ScriptStack& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
+{
+    ScriptStack& altstack = GetScriptStackArena().altstack;
+    altstack.clear();
+    return EvalScriptOnStacks(stack, altstack, script, flags, checker, sigversion, execdata, serror);
+}
+
+static bool EvalScript(ScriptStack& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    ScriptExecutionData execdata;
+    return EvalScript(stack, script, flags, checker, sigversion, execdata, serror);
+}
+
 namespace {
 
 /**
@@ -1809,8 +1847,6 @@ template class GenericTransactionSignatureChecker<CMutableTransaction>;
 
 static bool ExecuteWitnessScript(const Span<const valtype>& stack_span, const CScript& scriptPubKey, unsigned int flags, SigVersion sigversion, const BaseSignatureChecker& checker, ScriptExecutionData& execdata, ScriptError* serror)
 {
-    std::vector<valtype> stack{stack_span.begin(), stack_span.end()};
-
     if (sigversion == SigVersion::TAPSCRIPT) {
         // OP_SUCCESSx processing overrides everything, including stack element size limits
         CScript::const_iterator pc = scriptPubKey.begin();
@@ -1830,14 +1866,19 @@ static bool ExecuteWitnessScript(const Span<const valtype>& stack_span, const CS
         }
 
         // Tapscript enforces initial stack size limits (altstack is empty here)
-        if (stack.size() > MAX_STACK_SIZE) return set_error(serror, SCRIPT_ERR_STACK_SIZE);
+        if (stack_span.size() > MAX_STACK_SIZE) return set_error(serror, SCRIPT_ERR_STACK_SIZE);
     }
 
     // Disallow stack item size > MAX_SCRIPT_ELEMENT_SIZE in witness stack
-    for (const valtype& elem : stack) {
+    for (const valtype& elem : stack_span) {
         if (elem.size() > MAX_SCRIPT_ELEMENT_SIZE) return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
     }
 
+    // Only copy the witness into the reused buffers once it is known to fit
+    // the element size limit, so that they never hold on to larger items.
+    ScriptStack& stack = GetScriptStackArena().witness_stack;
+    stack.assign(stack_span.begin(), stack_span.end());
+
     // Run the script interpreter.
     if (!EvalScript(stack, scriptPubKey, flags, checker, sigversion, execdata, serror)) return false;
 
@@ -1966,7 +2007,103 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
     // There is intentionally no return statement here, to be able to use "control reaches end of non-void function" warnings to detect gaps in the logic above.
 }
 
+/** CastToBool() on a witness program embedded in a scriptPubKey, without copying it out. */
+static bool CastProgramToBool(Span<const unsigned char> program)
+{
+    for (size_t i = 0; i < program.size(); i++) {
+        if (program[i] != 0) {
+            // Can be negative zero
+            return !(i == program.size() - 1 && program[i] == 0x80);
+        }
+    }
+    return false;
+}
+
+std::optional<bool> VerifyScriptFastPath(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    // Leave the flag combinations VerifyScriptGeneric() asserts on to it.
+    if ((flags & SCRIPT_VERIFY_CLEANSTACK) && !(flags & SCRIPT_VERIFY_WITNESS)) return std::nullopt;
+    if ((flags & SCRIPT_VERIFY_WITNESS) && !(flags & SCRIPT_VERIFY_P2SH)) return std::nullopt;
+
+    const bool has_witness = witness != nullptr && !witness->IsNull();
+
+    if (scriptPubKey.size() == 25 && scriptPubKey[0] == OP_DUP && scriptPubKey[1] == OP_HASH160 && scriptPubKey[2] == 20 &&
+        scriptPubKey[23] == OP_EQUALVERIFY && scriptPubKey[24] == OP_CHECKSIG) {
+        // P2PKH: the scriptSig must be exactly <sig> <pubkey>, as minimal data pushes.
+        valtype sig, pubkey;
+        CScript::const_iterator pc = scriptSig.begin();
+        opcodetype opcode;
+        for (valtype* push : {&sig, &pubkey}) {
+            if (!scriptSig.GetOp(pc, opcode, *push) || opcode > OP_PUSHDATA4) return std::nullopt;
+            if (push->size() > MAX_SCRIPT_ELEMENT_SIZE || !CheckMinimalPush(*push, opcode)) return std::nullopt;
+        }
+        if (pc != scriptSig.end()) return std::nullopt;
+
+        set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
+        if (memcmp(Hash160(pubkey).begin(), scriptPubKey.data() + 3, 20)) {
+            return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+        }
+        bool success = false;
+        if (!EvalChecksigPreTapscript(sig, pubkey, scriptPubKey.begin(), scriptPubKey.end(), flags, checker, SigVersion::BASE, serror, success)) {
+            return false; // serror is set
+        }
+        if (!success) return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+        if ((flags & SCRIPT_VERIFY_WITNESS) && has_witness) return set_error(serror, SCRIPT_ERR_WITNESS_UNEXPECTED);
+        return set_success(serror);
+    }
+
+    if (!(flags & SCRIPT_VERIFY_WITNESS) || !scriptSig.empty() || !has_witness) return std::nullopt;
+    const std::vector<valtype>& stack = witness->stack;
+
+    if (scriptPubKey.size() == 2 + WITNESS_V0_KEYHASH_SIZE && scriptPubKey[0] == OP_0 && scriptPubKey[1] == WITNESS_V0_KEYHASH_SIZE) {
+        // P2WPKH: the witness must be exactly <sig> <pubkey>.
+        if (!CastProgramToBool(MakeSpan(scriptPubKey).subspan(2))) return std::nullopt;
+        if (stack.size() != 2 || stack[0].size() > MAX_SCRIPT_ELEMENT_SIZE || stack[1].size() > MAX_SCRIPT_ELEMENT_SIZE) return std::nullopt;
+
+        set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
+        if (memcmp(Hash160(stack[1]).begin(), scriptPubKey.data() + 2, WITNESS_V0_KEYHASH_SIZE)) {
+            return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+        }
+        CScript exec_script;
+        exec_script << OP_DUP << OP_HASH160;
+        exec_script.insert(exec_script.end(), scriptPubKey.begin() + 1, scriptPubKey.end());
+        exec_script << OP_EQUALVERIFY << OP_CHECKSIG;
+        bool success = false;
+        if (!EvalChecksigPreTapscript(stack[0], stack[1], exec_script.begin(), exec_script.end(), flags, checker, SigVersion::WITNESS_V0, serror, success)) {
+            return false; // serror is set
+        }
+        if (!success) return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+        return set_success(serror);
+    }
+
+    if ((flags & SCRIPT_VERIFY_TAPROOT) && scriptPubKey.size() == 2 + WITNESS_V1_TAPROOT_SIZE && scriptPubKey[0] == OP_1 && scriptPubKey[1] == WITNESS_V1_TAPROOT_SIZE) {
+        // Taproot key path without annex: the witness must be exactly <sig>.
+        const Span<const unsigned char> program = MakeSpan(scriptPubKey).subspan(2);
+        if (!CastProgramToBool(program)) return std::nullopt;
+        if (stack.size() != 1) return std::nullopt;
+
+        set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
+        ScriptExecutionData execdata;
+        execdata.m_annex_present = false;
+        execdata.m_annex_init = true;
+        if (!checker.CheckSchnorrSignature(stack[0], program, SigVersion::TAPROOT, execdata, serror)) {
+            return false; // serror is set
+        }
+        return set_success(serror);
+    }
+
+    return std::nullopt;
+}
+
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    if (const std::optional<bool> result = VerifyScriptFastPath(scriptSig, scriptPubKey, witness, flags, checker, serror)) {
+        return *result;
+    }
+    return VerifyScriptGeneric(scriptSig, scriptPubKey, witness, flags, checker, serror);
+}
+
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
 {
     static const CScriptWitness emptyWitness;
     if (witness == nullptr) {
@@ -1982,12 +2119,16 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
 
     // scriptSig and scriptPubKey must be evaluated sequentially on the same stack
     // rather than being simply concatenated (see CVE-2010-5141)
-    std::vector<std::vector<unsigned char> > stack, stackCopy;
+    ScriptStackArena& arena = GetScriptStackArena();
+    ScriptStack& stack = arena.stack;
+    ScriptStack& stackCopy = arena.stack_copy;
+    stack.clear();
+    stackCopy.clear();
     if (!EvalScript(stack, scriptSig, flags, checker, SigVersion::BASE, serror))
         // serror is set
         return false;
     if (flags & SCRIPT_VERIFY_P2SH)
-        stackCopy = stack;
+        stackCopy.assign(stack.begin(), stack.end());
     if (!EvalScript(stack, scriptPubKey, flags, checker, SigVersion::BASE, serror))
         // serror is set
         return false;
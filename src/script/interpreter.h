@@ -11,6 +11,10 @@
 #include <span.h>
 #include <primitives/transaction.h>
 
+#include <algorithm>
+#include <cassert>
+#include <optional>
+#include <stdexcept>
 #include <vector>
 #include <stdint.h>
 
@@ -323,9 +327,123 @@ uint256 ComputeTapleafHash(uint8_t leaf_version, const CScript& script);
  *  Requires control block to have valid length (33 + k*32, with k in {0,1,..,128}). */
 uint256 ComputeTaprootMerkleRoot(Span<const unsigned char> control, const uint256& tapleaf_hash);
 
+/**
+ * Script evaluation stack that keeps the buffers of popped elements, so that
+ * pushes onto a stack that has been used before do not allocate.
+ *
+ * Offers the part of the std::vector interface the script interpreter uses,
+ * with std::vector<unsigned char> elements like the stacks EvalScript() takes.
+ */
+class ScriptStack
+{
+public:
+    using value_type = std::vector<unsigned char>;
+    using iterator = std::vector<value_type>::iterator;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    //! Number of spare element buffers clear() keeps around.
+    static constexpr size_t MAX_SPARE_ELEMENTS = 64;
+
+private:
+    //! The elements [0, m_size) are on the stack, the rest are spare buffers.
+    std::vector<value_type> m_elements;
+    size_t m_size{0};
+
+public:
+    ScriptStack() = default;
+    ScriptStack(const ScriptStack&) = delete;
+    ScriptStack& operator=(const ScriptStack&) = delete;
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    iterator begin() { return m_elements.begin(); }
+    iterator end() { return m_elements.begin() + m_size; }
+    const_iterator begin() const { return m_elements.begin(); }
+    const_iterator end() const { return m_elements.begin() + m_size; }
+
+    value_type& at(size_t pos)
+    {
+        if (pos >= m_size) throw std::out_of_range("ScriptStack::at(): out of range");
+        return m_elements[pos];
+    }
+    value_type& back() { assert(m_size > 0); return m_elements[m_size - 1]; }
+    const value_type& back() const { assert(m_size > 0); return m_elements[m_size - 1]; }
+
+    template <typename InputIt>
+    void emplace_back(InputIt first, InputIt last)
+    {
+        if (m_size == m_elements.size()) m_elements.emplace_back();
+        m_elements[m_size++].assign(first, last);
+    }
+    void push_back(const value_type& element)
+    {
+        if (m_size == m_elements.size()) {
+            // May alias one of our elements, which std::vector handles.
+            m_elements.push_back(element);
+            ++m_size;
+        } else {
+            m_elements[m_size++].assign(element.begin(), element.end());
+        }
+    }
+    void pop_back() { assert(m_size > 0); --m_size; }
+
+    iterator erase(iterator first, iterator last)
+    {
+        std::rotate(first, last, end());
+        m_size -= last - first;
+        return first;
+    }
+    iterator erase(iterator pos) { return erase(pos, pos + 1); }
+    iterator insert(iterator pos, const value_type& element)
+    {
+        const auto offset = pos - begin();
+        push_back(element);
+        std::rotate(begin() + offset, end() - 1, end());
+        return begin() + offset;
+    }
+
+    void resize(size_t size)
+    {
+        while (m_size < size) push_back({});
+        m_size = size;
+    }
+    void clear()
+    {
+        m_size = 0;
+        if (m_elements.size() > MAX_SPARE_ELEMENTS) m_elements.resize(MAX_SPARE_ELEMENTS);
+        // Elements are normally limited to MAX_SCRIPT_ELEMENT_SIZE; do not keep
+        // the memory of any larger one around.
+        for (value_type& element : m_elements) {
+            if (element.capacity() > MAX_SCRIPT_ELEMENT_SIZE) value_type().swap(element);
+        }
+    }
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last)
+    {
+        clear();
+        for (; first != last; ++first) push_back(*first);
+    }
+
+    friend void swap(ScriptStack& a, ScriptStack& b) noexcept
+    {
+        std::swap(a.m_elements, b.m_elements);
+        std::swap(a.m_size, b.m_size);
+    }
+};
+
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* error = nullptr);
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* error = nullptr);
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
+/** VerifyScript() through the general script interpreter only. */
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
+/**
+ * Specialized verification of the common standard spends (P2PKH, P2WPKH and
+ * taproot key path without annex), skipping the script interpreter.
+ * Returns std::nullopt when the spend is not of a handled shape; otherwise the
+ * result and error are identical to those of VerifyScriptGeneric().
+ */
+std::optional<bool> VerifyScriptFastPath(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
 
 size_t CountWitnessSigOps(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags);
 
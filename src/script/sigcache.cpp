@@ -5,14 +5,19 @@
 
 #include <script/sigcache.h>
 
+#include <clientversion.h>
+#include <logging.h>
 #include <pubkey.h>
 #include <random.h>
+#include <streams.h>
 #include <uint256.h>
 #include <util/system.h>
 
 #include <cuckoocache.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <shared_mutex>
 #include <vector>
@@ -27,28 +32,64 @@ class CSignatureCache
 {
 private:
      //! Entries are SHA256(nonce || 'E' or 'S' || 31 zero bytes || signature hash || public key || signature):
+    uint256 m_nonce;
     CSHA256 m_salted_hasher_ecdsa;
     CSHA256 m_salted_hasher_schnorr;
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    std::shared_mutex cs_sigcache;
+
+    /**
+     * The entries are spread over several independent caches, so that
+     * inserting an entry only blocks the lookups of the same shard instead
+     * of those of all script check threads. Each shard starts on its own
+     * cache line, so that the locks and counters of neighbouring shards
+     * don't share one.
+     */
+    struct alignas(64) Shard {
+        map_type setValid;
+        std::shared_mutex cs_sigcache;
+        //! Counted per shard so that the threads don't all write to the same counters.
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> inserts{0};
+    };
+    std::array<Shard, SIGNATURE_CACHE_SHARDS> m_shards;
+    uint64_t m_max_entries{0};
+
+    Shard& GetShard(const uint256& entry)
+    {
+        // The shards use all the bits of the entry to place it, but they
+        // scale them to the table size keeping the most significant ones, so
+        // picking the shard from the lowest bits of the first word hardly
+        // makes the slots of the entries of a shard any less random.
+        return m_shards[entry.begin()[0] % SIGNATURE_CACHE_SHARDS];
+    }
 
 public:
     CSignatureCache()
     {
-        uint256 nonce = GetRandHash();
+        SetNonce(GetRandHash());
+    }
+
+    /** Salt the entries with nonce. Entries computed with another nonce can no longer be found. */
+    void SetNonce(const uint256& nonce)
+    {
         // We want the nonce to be 64 bytes long to force the hasher to process
         // this chunk, which makes later hash computations more efficient. We
         // just write our 32-byte entropy, and then pad with 'E' for ECDSA and
         // 'S' for Schnorr (followed by 0 bytes).
         static constexpr unsigned char PADDING_ECDSA[32] = {'E'};
         static constexpr unsigned char PADDING_SCHNORR[32] = {'S'};
+        m_nonce = nonce;
+        m_salted_hasher_ecdsa.Reset();
         m_salted_hasher_ecdsa.Write(nonce.begin(), 32);
         m_salted_hasher_ecdsa.Write(PADDING_ECDSA, 32);
+        m_salted_hasher_schnorr.Reset();
         m_salted_hasher_schnorr.Write(nonce.begin(), 32);
         m_salted_hasher_schnorr.Write(PADDING_SCHNORR, 32);
     }
 
+    const uint256& GetNonce() const { return m_nonce; }
+
     void
     ComputeEntryECDSA(uint256& entry, const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubkey) const
     {
@@ -66,18 +107,55 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        std::shared_lock<std::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        Shard& shard = GetShard(entry);
+        bool found;
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.cs_sigcache);
+            found = shard.setValid.contains(entry, erase);
+        }
+        (found ? shard.hits : shard.misses).fetch_add(1, std::memory_order_relaxed);
+        return found;
     }
 
     void Set(const uint256& entry)
     {
-        std::unique_lock<std::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+        Shard& shard = GetShard(entry);
+        std::unique_lock<std::shared_mutex> lock(shard.cs_sigcache);
+        shard.setValid.insert(entry);
+        shard.inserts.fetch_add(1, std::memory_order_relaxed);
     }
-    uint32_t setup_bytes(size_t n)
+    size_t setup_bytes(size_t n)
+    {
+        size_t elems = 0;
+        for (Shard& shard : m_shards) {
+            std::unique_lock<std::shared_mutex> lock(shard.cs_sigcache);
+            elems += shard.setValid.setup_bytes(n / SIGNATURE_CACHE_SHARDS);
+        }
+        m_max_entries = elems;
+        return elems;
+    }
+
+    std::vector<uint256> GetEntries()
     {
-        return setValid.setup_bytes(n);
+        std::vector<uint256> entries;
+        for (Shard& shard : m_shards) {
+            std::shared_lock<std::shared_mutex> lock(shard.cs_sigcache);
+            std::vector<uint256> shard_entries{shard.setValid.get_live_elements()};
+            entries.insert(entries.end(), shard_entries.begin(), shard_entries.end());
+        }
+        return entries;
+    }
+
+    SigCacheCounters GetCounters() const
+    {
+        SigCacheCounters counters;
+        for (const Shard& shard : m_shards) {
+            counters.hits += shard.hits.load(std::memory_order_relaxed);
+            counters.misses += shard.misses.load(std::memory_order_relaxed);
+            counters.inserts += shard.inserts.load(std::memory_order_relaxed);
+        }
+        counters.max_entries = m_max_entries;
+        return counters;
     }
 };
 
@@ -95,13 +173,96 @@ static CSignatureCache signatureCache;
 void InitSignatureCache()
 {
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
-    // setup_bytes creates the minimum possible cache (2 elements).
+    // setup_bytes creates the minimum possible cache (2 elements per shard).
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
     size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
     LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements\n",
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+static const uint64_t SALTED_CACHE_DUMP_VERSION = 1;
+
+bool DumpSaltedCache(const fs::path& path, const uint256& nonce, const std::vector<uint256>& entries)
+{
+    fs::path path_new{path};
+    path_new += ".new";
+    try {
+        CAutoFile file(fsbridge::fopen(path_new, "wb"), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull()) {
+            return false;
+        }
+        file << SALTED_CACHE_DUMP_VERSION;
+        file << nonce;
+        file << uint64_t{entries.size()};
+        for (const uint256& entry : entries) {
+            file << entry;
+        }
+        if (!FileCommit(file.Get())) {
+            throw std::runtime_error("FileCommit failed");
+        }
+        file.fclose();
+        if (!RenameOver(path_new, path)) {
+            throw std::runtime_error("Rename failed");
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to dump %s: %s. Continuing anyway.\n", path.filename().string(), e.what());
+        return false;
+    }
+    return true;
+}
+
+bool LoadSaltedCache(const fs::path& path, uint256& nonce, std::vector<uint256>& entries)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        return false;
+    }
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != SALTED_CACHE_DUMP_VERSION) {
+            return false;
+        }
+        file >> nonce;
+        uint64_t num;
+        file >> num;
+        entries.clear();
+        while (num--) {
+            file >> entries.emplace_back();
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize %s: %s. Continuing anyway.\n", path.filename().string(), e.what());
+        return false;
+    }
+    return true;
+}
+
+SigCacheCounters GetSignatureCacheCounters()
+{
+    return signatureCache.GetCounters();
+}
+
+bool DumpSignatureCache(const fs::path& path)
+{
+    const std::vector<uint256> entries{signatureCache.GetEntries()};
+    if (!DumpSaltedCache(path, signatureCache.GetNonce(), entries)) return false;
+    LogPrintf("Dumped %u signature cache entries\n", entries.size());
+    return true;
+}
+
+bool LoadSignatureCache(const fs::path& path)
+{
+    uint256 nonce;
+    std::vector<uint256> entries;
+    if (!LoadSaltedCache(path, nonce, entries)) return false;
+    signatureCache.SetNonce(nonce);
+    for (const uint256& entry : entries) {
+        signatureCache.Set(entry);
+    }
+    LogPrintf("Loaded %u signature cache entries from disk\n", entries.size());
+    return true;
+}
+
 bool CachingTransactionSignatureChecker::VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include <fs.h>
 #include <script/interpreter.h>
 #include <span.h>
 #include <util/hasher.h>
@@ -18,6 +19,10 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+/** Number of independently locked parts the signature cache is split into */
+static constexpr size_t SIGNATURE_CACHE_SHARDS{16};
+/** Default for -persistsigcache */
+static constexpr bool DEFAULT_PERSIST_SIG_CACHE{false};
 
 class CPubKey;
 
@@ -35,4 +40,36 @@ public:
 
 void InitSignatureCache();
 
+/** How often a signature or script execution cache was used, to help choose -maxsigcachesize. */
+struct SigCacheCounters {
+    //! Lookups that found the entry.
+    uint64_t hits{0};
+    //! Lookups that did not find the entry.
+    uint64_t misses{0};
+    //! Entries added, including those that replaced older ones.
+    uint64_t inserts{0};
+    //! Number of entries the cache can hold.
+    uint64_t max_entries{0};
+};
+
+SigCacheCounters GetSignatureCacheCounters();
+
+/** Save the salt and the entries of the signature cache to a file. */
+bool DumpSignatureCache(const fs::path& path);
+/**
+ * Replace the salt of the signature cache with the one saved by
+ * DumpSignatureCache, and insert the saved entries. Entries already in the
+ * cache are lost, so this should be called right after InitSignatureCache.
+ */
+bool LoadSignatureCache(const fs::path& path);
+
+/**
+ * Write the nonce a cache of salted hashes was set up with and its entries to
+ * a file, so that they stay valid after a restart. This is shared by the
+ * signature cache and the script execution cache.
+ */
+bool DumpSaltedCache(const fs::path& path, const uint256& nonce, const std::vector<uint256>& entries);
+/** Read a file written by DumpSaltedCache. */
+bool LoadSaltedCache(const fs::path& path, uint256& nonce, std::vector<uint256>& entries);
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -122,6 +122,28 @@ struct FrozenCleanupCheck {
     void swap(FrozenCleanupCheck& x){std::swap(should_freeze, x.should_freeze);};
 };
 
+struct StealCheck {
+    static constexpr size_t STEAL_COUNT = 100;
+    static std::atomic<size_t> n_calls;
+    static std::atomic<bool> blocker_started;
+    // A blocking check holds up the thread running it until all the others
+    // are done, which only happens if they get stolen from its deque.
+    bool blocks {false};
+    bool operator()()
+    {
+        if (!blocks) {
+            n_calls.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        blocker_started = true;
+        for (int i = 0; i < 1000 && n_calls < STEAL_COUNT; ++i) {
+            UninterruptibleSleep(std::chrono::milliseconds{10});
+        }
+        return n_calls == STEAL_COUNT;
+    }
+    void swap(StealCheck& x) { std::swap(blocks, x.blocks); };
+};
+
 // Static Allocations
 std::mutex FrozenCleanupCheck::m{};
 std::atomic<uint64_t> FrozenCleanupCheck::nFrozen{0};
@@ -130,6 +152,8 @@ Mutex UniqueCheck::m;
 std::unordered_multiset<size_t> UniqueCheck::results;
 std::atomic<size_t> FakeCheckCheckCompletion::n_calls{0};
 std::atomic<size_t> MemoryCheck::fake_allocated_memory{0};
+std::atomic<size_t> StealCheck::n_calls{0};
+std::atomic<bool> StealCheck::blocker_started{false};
 
 // Queue Typedefs
 typedef CCheckQueue<FakeCheckCheckCompletion> Correct_Queue;
@@ -138,6 +162,7 @@ typedef CCheckQueue<FailingCheck> Failing_Queue;
 typedef CCheckQueue<UniqueCheck> Unique_Queue;
 typedef CCheckQueue<MemoryCheck> Memory_Queue;
 typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
+typedef CCheckQueue<StealCheck> Steal_Queue;
 
 
 /** This test case checks that the CCheckQueue works properly
@@ -201,6 +226,47 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Random)
     Correct_Queue_range(range);
 }
 
+/** Test batches with fewer checks than there are participants
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Small)
+{
+    std::vector<size_t> range;
+    for (size_t i = 0; i < 20; ++i) {
+        range.push_back(2 + i % SCRIPT_CHECK_THREADS);
+    }
+    Correct_Queue_range(range);
+}
+
+/** Test that checks in the deque of a busy worker are stolen by the master
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Steal)
+{
+    auto queue = std::make_unique<Steal_Queue>(QUEUE_BATCH_SIZE);
+    queue->StartWorkerThreads(1);
+    StealCheck::n_calls = 0;
+    StealCheck::blocker_started = false;
+    {
+        CCheckQueueControl<StealCheck> control(queue.get());
+        {
+            // The first check lands in the deque of the only worker.
+            std::vector<StealCheck> vChecks(1);
+            vChecks[0].blocks = true;
+            control.Add(vChecks);
+        }
+        for (int i = 0; i < 1000 && !StealCheck::blocker_started; ++i) {
+            UninterruptibleSleep(std::chrono::milliseconds{10});
+        }
+        BOOST_REQUIRE(StealCheck::blocker_started);
+        {
+            // Half of these are placed in the deque of the blocked worker.
+            std::vector<StealCheck> vChecks(StealCheck::STEAL_COUNT);
+            control.Add(vChecks);
+        }
+        BOOST_REQUIRE(control.Wait());
+    }
+    BOOST_REQUIRE_EQUAL(StealCheck::n_calls, StealCheck::STEAL_COUNT);
+    queue->StopWorkerThreads();
+}
 
 /** Test that failing checks are caught */
 BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure)
@@ -252,6 +318,58 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
     fail_queue->StopWorkerThreads();
 }
 
+// Test that a failure in one deque is reported while the other deques still
+// hold work, and that this work is drained before the next block.
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Failure_With_Pending_Work)
+{
+    auto fail_queue = std::make_unique<Failing_Queue>(QUEUE_BATCH_SIZE);
+    fail_queue->StartWorkerThreads(SCRIPT_CHECK_THREADS);
+
+    for (size_t fail_at = 0; fail_at < 1000; fail_at += 111) {
+        {
+            CCheckQueueControl<FailingCheck> control(fail_queue.get());
+            for (size_t begin = 0; begin < 1000; begin += 100) {
+                std::vector<FailingCheck> vChecks;
+                for (size_t i = begin; i < begin + 100; ++i) {
+                    vChecks.emplace_back(i == fail_at);
+                }
+                control.Add(vChecks);
+            }
+            BOOST_REQUIRE(!control.Wait());
+        }
+        {
+            CCheckQueueControl<FailingCheck> control(fail_queue.get());
+            std::vector<FailingCheck> vChecks(100, false);
+            control.Add(vChecks);
+            BOOST_REQUIRE(control.Wait());
+        }
+    }
+    fail_queue->StopWorkerThreads();
+}
+
+// Test that the queue works again after its worker threads were stopped and
+// restarted, with a different number of them.
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Restart)
+{
+    auto queue = std::make_unique<Correct_Queue>(QUEUE_BATCH_SIZE);
+    for (const int threads : {SCRIPT_CHECK_THREADS, 1, 0, SCRIPT_CHECK_THREADS}) {
+        queue->StartWorkerThreads(threads);
+        BOOST_CHECK_EQUAL(queue->HasWorkerThreads(), threads > 0);
+        for (size_t round = 0; round < 10; ++round) {
+            FakeCheckCheckCompletion::n_calls = 0;
+            CCheckQueueControl<FakeCheckCheckCompletion> control(queue.get());
+            for (size_t i = 0; i < 10; ++i) {
+                std::vector<FakeCheckCheckCompletion> vChecks(100);
+                control.Add(vChecks);
+            }
+            BOOST_REQUIRE(control.Wait());
+            BOOST_REQUIRE_EQUAL(FakeCheckCheckCompletion::n_calls, 1000U);
+        }
+        queue->StopWorkerThreads();
+        BOOST_CHECK(!queue->HasWorkerThreads());
+    }
+}
+
 // Test that unique checks are actually all called individually, rather than
 // just one check being called repeatedly. Test that checks are not called
 // more than once as well
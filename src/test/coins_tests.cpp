@@ -5,6 +5,7 @@
 #include <attributes.h>
 #include <clientversion.h>
 #include <coins.h>
+#include <node/coinstats.h>
 #include <script/standard.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
@@ -12,6 +13,7 @@
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
+#include <validation.h>
 
 #include <map>
 #include <vector>
@@ -54,9 +56,9 @@ public:
 
     uint256 GetBestBlock() const override { return hashBestBlock_; }
 
-    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase = true) override
     {
-        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ) {
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it = erase ? mapCoins.erase(it) : std::next(it)) {
             if (it->second.flags & CCoinsCacheEntry::DIRTY) {
                 // Same optimization used in CCoinsViewDB is to only write dirty entries.
                 map_[it->first] = it->second.coin;
@@ -65,7 +67,6 @@ public:
                     map_.erase(it->first);
                 }
             }
-            mapCoins.erase(it++);
         }
         if (!hashBlock.IsNull())
             hashBestBlock_ = hashBlock;
@@ -496,6 +497,67 @@ BOOST_AUTO_TEST_CASE(updatecoins_simulation_test)
     g_mock_deterministic_tests = false;
 }
 
+BOOST_AUTO_TEST_CASE(coins_db_shards)
+{
+    CCoinsViewDB db{"test", /*nCacheSize*/ 1 << 23, /*fMemory*/ true, /*fWipe*/ false};
+    {
+        CCoinsViewCache cache{&db};
+        for (int i = 0; i < 2000; ++i) {
+            const uint256 txid{InsecureRand256()};
+            for (uint32_t n = 0; n < 1 + InsecureRandRange(3); ++n) {
+                Coin coin;
+                coin.out.nValue = InsecureRandRange(1000000);
+                coin.out.scriptPubKey.assign(InsecureRandRange(40), 0x51);
+                coin.nHeight = InsecureRandRange(1000);
+                cache.AddCoin(COutPoint{txid, n}, std::move(coin), /* possible_overwrite */ false);
+            }
+        }
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_REQUIRE(cache.Flush());
+    }
+
+    // Iterating over all shards in order visits the same coins as a single cursor.
+    std::vector<COutPoint> expected;
+    for (auto cursor = db.Cursor(); cursor->Valid(); cursor->Next()) {
+        COutPoint key;
+        BOOST_REQUIRE(cursor->GetKey(key));
+        expected.push_back(key);
+    }
+    std::vector<COutPoint> sharded;
+    const auto snapshot = db.GetSnapshot();
+    for (int shard = 0; shard < CCoinsViewDB::SHARD_COUNT; ++shard) {
+        for (auto cursor = db.Cursor(shard, snapshot); cursor->Valid(); cursor->Next()) {
+            COutPoint key;
+            BOOST_REQUIRE(cursor->GetKey(key));
+            BOOST_CHECK_EQUAL(*key.hash.begin(), shard);
+            sharded.push_back(key);
+        }
+    }
+    BOOST_CHECK(sharded == expected);
+
+    // Stats computed over the shards in parallel match the ones computed over a
+    // single cursor (which is what happens behind a view other than the database).
+    BlockManager blockman;
+    CBlockIndex index;
+    const uint256 best_block{db.GetBestBlock()};
+    index.phashBlock = &best_block;
+    CCoinsViewBacked backed{&db};
+    for (const auto hash_type : {CoinStatsHashType::HASH_SERIALIZED, CoinStatsHashType::MUHASH, CoinStatsHashType::NONE}) {
+        CCoinsStats sharded_stats{hash_type};
+        CCoinsStats serial_stats{hash_type};
+        sharded_stats.index_requested = serial_stats.index_requested = false;
+        BOOST_REQUIRE(GetUTXOStats(&db, blockman, sharded_stats, {}, &index));
+        BOOST_REQUIRE(GetUTXOStats(&backed, blockman, serial_stats, {}, &index));
+        BOOST_CHECK_EQUAL(sharded_stats.coins_count, expected.size());
+        BOOST_CHECK_EQUAL(sharded_stats.coins_count, serial_stats.coins_count);
+        BOOST_CHECK_EQUAL(sharded_stats.nTransactions, serial_stats.nTransactions);
+        BOOST_CHECK_EQUAL(sharded_stats.nTransactionOutputs, serial_stats.nTransactionOutputs);
+        BOOST_CHECK_EQUAL(sharded_stats.nTotalAmount, serial_stats.nTotalAmount);
+        BOOST_CHECK_EQUAL(sharded_stats.nBogoSize, serial_stats.nBogoSize);
+        BOOST_CHECK(sharded_stats.hashSerialized == serial_stats.hashSerialized);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(ccoins_serialization)
 {
     // Good example
@@ -609,7 +671,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
     InsertCoinsMapEntry(map, value, flags);
     BOOST_CHECK(view.BatchWrite(map, {}));
 }
@@ -793,6 +856,113 @@ BOOST_AUTO_TEST_CASE(ccoins_add)
     CheckAddCoin(VALUE2, VALUE3, VALUE3, DIRTY|FRESH, DIRTY|FRESH, true );
 }
 
+static void CheckAddPrefetchedCoin(CAmount cache_value, CAmount expected_value, char cache_flags, char expected_flags)
+{
+    SingleEntryCacheTest test(ABSENT, cache_value, cache_flags);
+    CTxOut output;
+    output.nValue = VALUE3;
+    const bool inserted = test.cache.AddPrefetchedCoin(OUTPOINT, Coin(std::move(output), 1, false));
+    test.cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(inserted, cache_flags == NO_ENTRY);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_add_prefetched)
+{
+    /* Check AddPrefetchedCoin behavior: a coin read from the base view is
+     * only inserted, clean, when the cache has no entry for it. Existing
+     * entries are always authoritative and left untouched.
+     *
+     *                     Cache   Result  Cache        Result
+     *                     Value   Value   Flags        Flags
+     */
+    CheckAddPrefetchedCoin(ABSENT, VALUE3, NO_ENTRY   , 0          );
+    CheckAddPrefetchedCoin(SPENT , SPENT , 0          , 0          );
+    CheckAddPrefetchedCoin(SPENT , SPENT , FRESH      , FRESH      );
+    CheckAddPrefetchedCoin(SPENT , SPENT , DIRTY      , DIRTY      );
+    CheckAddPrefetchedCoin(SPENT , SPENT , DIRTY|FRESH, DIRTY|FRESH);
+    CheckAddPrefetchedCoin(VALUE2, VALUE2, 0          , 0          );
+    CheckAddPrefetchedCoin(VALUE2, VALUE2, FRESH      , FRESH      );
+    CheckAddPrefetchedCoin(VALUE2, VALUE2, DIRTY      , DIRTY      );
+    CheckAddPrefetchedCoin(VALUE2, VALUE2, DIRTY|FRESH, DIRTY|FRESH);
+}
+
+static void CheckSyncCoins(CAmount base_value, CAmount cache_value, CAmount expected_base_value, CAmount expected_value, char cache_flags, char expected_flags)
+{
+    SingleEntryCacheTest test(base_value, cache_value, cache_flags);
+    BOOST_CHECK(test.cache.Sync());
+    test.cache.SelfTest();
+    test.base.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+    GetCoinsMapEntry(test.base.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_base_value);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_sync)
+{
+    /* Check Sync behavior: modified entries are written to the base view like
+     * with Flush, but unspent coins stay in the cache with their flags
+     * cleared, while spent ones are dropped.
+     *
+     *             Base    Cache   Result  Result  Cache        Result
+     *             Value   Value   Base    Value   Flags        Flags
+     */
+    CheckSyncCoins(ABSENT, ABSENT, ABSENT, ABSENT, NO_ENTRY   , NO_ENTRY   );
+    CheckSyncCoins(ABSENT, SPENT , ABSENT, ABSENT, 0          , NO_ENTRY   );
+    CheckSyncCoins(ABSENT, SPENT , ABSENT, ABSENT, FRESH      , NO_ENTRY   );
+    CheckSyncCoins(ABSENT, SPENT , SPENT , ABSENT, DIRTY      , NO_ENTRY   );
+    CheckSyncCoins(ABSENT, SPENT , ABSENT, ABSENT, DIRTY|FRESH, NO_ENTRY   );
+    CheckSyncCoins(ABSENT, VALUE2, ABSENT, VALUE2, 0          , 0          );
+    CheckSyncCoins(ABSENT, VALUE2, VALUE2, VALUE2, DIRTY      , 0          );
+    CheckSyncCoins(ABSENT, VALUE2, VALUE2, VALUE2, DIRTY|FRESH, 0          );
+    CheckSyncCoins(VALUE1, ABSENT, VALUE1, ABSENT, NO_ENTRY   , NO_ENTRY   );
+    CheckSyncCoins(VALUE1, SPENT , VALUE1, ABSENT, 0          , NO_ENTRY   );
+    CheckSyncCoins(VALUE1, SPENT , SPENT , ABSENT, DIRTY      , NO_ENTRY   );
+    CheckSyncCoins(VALUE1, VALUE2, VALUE1, VALUE2, 0          , 0          );
+    CheckSyncCoins(VALUE1, VALUE2, VALUE2, VALUE2, DIRTY      , 0          );
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_evict)
+{
+    CCoinsView root;
+    CCoinsViewCacheTest cache{&root};
+
+    // Fill the cache with coins carrying every combination of flags.
+    std::map<COutPoint, char> flags_by_outpoint;
+    for (uint32_t i = 0; i < 400; ++i) {
+        const COutPoint outpoint{InsecureRand256(), i};
+        const char flags = *(FLAGS.begin() + i % FLAGS.size());
+        CCoinsCacheEntry entry;
+        entry.flags = flags;
+        SetCoinsValue(VALUE1, entry.coin);
+        cache.usage() += entry.coin.DynamicMemoryUsage();
+        cache.map().emplace(outpoint, std::move(entry));
+        flags_by_outpoint.emplace(outpoint, flags);
+    }
+    cache.SelfTest();
+
+    // Nothing is evicted when the cache is already small enough.
+    BOOST_CHECK_EQUAL(cache.Evict(cache.DynamicMemoryUsage()), 0U);
+
+    // Evicting down to zero only removes the unmodified coins.
+    BOOST_CHECK_EQUAL(cache.Evict(0), 100U);
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 300U);
+    for (const auto& [outpoint, flags] : flags_by_outpoint) {
+        BOOST_CHECK_EQUAL(cache.HaveCoinInCache(outpoint), flags != 0);
+    }
+}
+
 void CheckWriteCoins(CAmount parent_value, CAmount child_value, CAmount expected_value, char parent_flags, char child_flags, char expected_flags)
 {
     SingleEntryCacheTest test(ABSENT, parent_value, parent_flags);
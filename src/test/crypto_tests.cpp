@@ -5,6 +5,7 @@
 #include <crypto/aes.h>
 #include <crypto/chacha20.h>
 #include <crypto/chacha_poly_aead.h>
+#include <crypto/common.h>
 #include <crypto/hkdf_sha256_32.h>
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
@@ -20,6 +21,8 @@
 #include <test/util/setup_common.h>
 #include <util/strencodings.h>
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -500,6 +503,44 @@ BOOST_AUTO_TEST_CASE(chacha20_testvector)
                  "fab78c9");
 }
 
+BOOST_AUTO_TEST_CASE(chacha20_multiblock)
+{
+    // Messages long enough for the multi-block implementations must give the
+    // same output as processing them one block at a time, also when the block
+    // counter carries into its upper word.
+    const std::vector<unsigned char> key = ParseHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+    for (const uint64_t seek : {uint64_t{0}, uint64_t{0xfffffff9}, uint64_t{0xfffffffffffffffc}}) {
+        for (const size_t size : {64 * 3, 64 * 4, 64 * 7 + 13, 64 * 8, 64 * 12, 64 * 29 + 1}) {
+            std::vector<unsigned char> message(size);
+            for (size_t i = 0; i < size; ++i) message[i] = i * 13 + 5;
+
+            ChaCha20 multi(key.data(), key.size()), single(key.data(), key.size());
+            multi.SetIV(0x4a000000UL);
+            single.SetIV(0x4a000000UL);
+            multi.Seek(seek);
+            single.Seek(seek);
+            std::vector<unsigned char> crypt_multi(size), crypt_single(size);
+            multi.Crypt(message.data(), crypt_multi.data(), size);
+            for (size_t pos = 0; pos < size; pos += 64) {
+                single.Crypt(message.data() + pos, crypt_single.data() + pos, std::min<size_t>(64, size - pos));
+            }
+            BOOST_CHECK(crypt_multi == crypt_single);
+
+            multi.Seek(seek);
+            single.Seek(seek);
+            std::vector<unsigned char> stream_multi(size), stream_single(size);
+            multi.Keystream(stream_multi.data(), size);
+            for (size_t pos = 0; pos < size; pos += 64) {
+                single.Keystream(stream_single.data() + pos, std::min<size_t>(64, size - pos));
+            }
+            BOOST_CHECK(stream_multi == stream_single);
+            for (size_t i = 0; i < size; ++i) {
+                BOOST_CHECK_EQUAL(stream_multi[i] ^ message[i], crypt_multi[i]);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(poly1305_testvector)
 {
     // RFC 7539, section 2.5.2.
@@ -570,6 +611,29 @@ BOOST_AUTO_TEST_CASE(poly1305_testvector)
                  "13000000000000000000000000000000");
 }
 
+BOOST_AUTO_TEST_CASE(poly1305_long_messages)
+{
+    // Messages of several blocks, which go through the multi-block
+    // implementations when available. Tags computed with an independent
+    // implementation.
+    const auto message = [](size_t size) {
+        std::vector<unsigned char> m(size);
+        for (size_t i = 0; i < size; ++i) m[i] = i * 7 + 3;
+        return HexStr(m);
+    };
+    const std::string key = "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f";
+    TestPoly1305(message(64), key, "55e564fff1b743fad219c5d22daede54");
+    TestPoly1305(message(127), key, "cb6138ad49af9b3dd61fa88f7e0e8b65");
+    TestPoly1305(message(256), key, "24a5358aa6d3841ad367a0deebfb0856");
+    TestPoly1305(message(1000), key, "b74ce66f76a2566fb0052967c146de6d");
+    TestPoly1305(message(4096), key, "179132a87f2e921753e2491699ae3330");
+
+    // All bits set in key and message, to exercise the carries.
+    const std::string key_ff(64, 'f');
+    TestPoly1305(std::string(2 * 64, 'f'), key_ff, "900fe32bc15fa8d7bca8efe4c7e37eb1");
+    TestPoly1305(std::string(2 * 1024, 'f'), key_ff, "25d4926a53bb480da228ec61e0a31a38");
+}
+
 BOOST_AUTO_TEST_CASE(hkdf_hmac_sha256_l32_tests)
 {
     // Use rfc5869 test vectors but truncated to 32 bytes (our implementation only support length 32)
@@ -753,6 +817,51 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256multi)
+{
+    // Messages of all lengths around the padding boundaries, in a random
+    // order so that lanes finish at different times.
+    for (int count = 0; count <= 40; ++count) {
+        std::vector<std::vector<unsigned char>> msgs(count);
+        std::vector<const unsigned char*> inputs;
+        std::vector<size_t> lengths;
+        for (auto& msg : msgs) {
+            msg.resize(InsecureRandRange(300));
+            for (auto& c : msg) c = InsecureRandBits(8);
+            inputs.push_back(msg.data());
+            lengths.push_back(msg.size());
+        }
+        std::vector<unsigned char> out1(32 * count), out2(32 * count);
+        for (int j = 0; j < count; ++j) {
+            CSHA256().Write(msgs[j].data(), msgs[j].size()).Finalize(out1.data() + 32 * j);
+        }
+        SHA256Multi(out2.data(), inputs.data(), lengths.data(), count);
+        BOOST_CHECK(out1 == out2);
+    }
+
+    // The lane scheduling, whatever the CPU supports, with messages of mixed
+    // lengths including empty ones without data.
+    for (size_t lanes : {2, 4, 8, 16}) {
+        for (int count = 0; count <= 40; ++count) {
+            std::vector<std::vector<unsigned char>> msgs(count);
+            std::vector<const unsigned char*> inputs;
+            std::vector<size_t> lengths;
+            for (auto& msg : msgs) {
+                msg.resize(InsecureRandBool() ? 0 : InsecureRandRange(300));
+                for (auto& c : msg) c = InsecureRandBits(8);
+                inputs.push_back(msg.empty() ? nullptr : msg.data());
+                lengths.push_back(msg.size());
+            }
+            std::vector<unsigned char> out1(32 * count), out2(32 * count);
+            for (int j = 0; j < count; ++j) {
+                CSHA256().Write(msgs[j].data(), msgs[j].size()).Finalize(out1.data() + 32 * j);
+            }
+            SHA256MultiWithLanes(out2.data(), inputs.data(), lengths.data(), count, lanes);
+            BOOST_CHECK(out1 == out2);
+        }
+    }
+}
+
 static void TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
@@ -947,4 +1056,41 @@ BOOST_AUTO_TEST_CASE(muhash_tests)
     BOOST_CHECK_EQUAL(HexStr(out4), "3a31e6903aff0de9f62f9a9f7f8b861de76ce2cda09822b90014319ae5dc2271");
 }
 
+BOOST_AUTO_TEST_CASE(num3072_arithmetic)
+{
+    // p - 1 = 2^3072 - 1103718 has all limbs at or near their maximum, which
+    // exercises every carry, and it squares to one.
+    unsigned char max_bytes[Num3072::BYTE_SIZE];
+    memset(max_bytes, 0xff, sizeof(max_bytes));
+    WriteLE32(max_bytes, 0xffffffff - 1103717);
+    const Num3072 minus_one{max_bytes};
+    Num3072 product = minus_one;
+    product.Multiply(minus_one);
+    BOOST_CHECK(product.IsOne());
+    Num3072 square = minus_one;
+    square.Square();
+    BOOST_CHECK(square.IsOne());
+
+    for (int iter = 0; iter < 10; ++iter) {
+        unsigned char bytes[Num3072::BYTE_SIZE];
+        const std::vector<unsigned char> random = g_insecure_rand_ctx.randbytes(sizeof(bytes));
+        std::copy(random.begin(), random.end(), bytes);
+        const Num3072 x{bytes};
+
+        Num3072 multiplied = x, squared = x;
+        multiplied.Multiply(x);
+        squared.Square();
+        BOOST_CHECK(std::equal(std::begin(multiplied.limbs), std::end(multiplied.limbs), std::begin(squared.limbs)));
+
+        Num3072 quotient = x;
+        quotient.Divide(x);
+        BOOST_CHECK(quotient.IsOne());
+
+        // Dividing by one is skipped, but must leave the value unchanged.
+        Num3072 unchanged = multiplied;
+        unchanged.Divide(Num3072{});
+        BOOST_CHECK(std::equal(std::begin(multiplied.limbs), std::end(multiplied.limbs), std::begin(unchanged.limbs)));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
 #include <deque>
 #include <mutex>
 #include <shared_mutex>
@@ -47,6 +48,31 @@ BOOST_AUTO_TEST_CASE(test_cuckoocache_no_fakes)
     }
 };
 
+/* Test that the live elements are the inserted ones that were not erased. */
+BOOST_AUTO_TEST_CASE(cuckoocache_live_elements)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    cc.setup_bytes(1 << 20);
+    // Stay well below the capacity so that nothing is evicted.
+    std::vector<uint256> hashes(1000);
+    for (auto& h : hashes) {
+        h = InsecureRand256();
+        cc.insert(h);
+    }
+    for (size_t i = 0; i < hashes.size(); i += 2) {
+        BOOST_CHECK(cc.contains(hashes[i], true));
+    }
+    std::vector<uint256> live{cc.get_live_elements()};
+    std::vector<uint256> expected;
+    for (size_t i = 1; i < hashes.size(); i += 2) {
+        expected.push_back(hashes[i]);
+    }
+    std::sort(live.begin(), live.end());
+    std::sort(expected.begin(), expected.end());
+    BOOST_CHECK(live == expected);
+}
+
 /** This helper returns the hit rate when megabytes*load worth of entries are
  * inserted into a megabytes sized cache
  */
@@ -0,0 +1,136 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <hash.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <test/fuzz/FuzzedDataProvider.h>
+#include <test/fuzz/fuzz.h>
+#include <test/fuzz/util.h>
+
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace {
+/**
+ * Signature checker whose verdicts are a deterministic function of its
+ * arguments, and which records every call made to it, so that the fast and
+ * the generic verification paths can be compared call for call.
+ */
+class RecordingSignatureChecker : public BaseSignatureChecker
+{
+    const uint256 m_salt;
+
+public:
+    mutable std::vector<uint256> m_calls;
+
+    explicit RecordingSignatureChecker(const uint256& salt) : m_salt{salt} {}
+
+    bool CheckECDSASignature(const std::vector<unsigned char>& sig, const std::vector<unsigned char>& pubkey, const CScript& script_code, SigVersion sigversion) const override
+    {
+        CHashWriter hasher{SER_GETHASH, 0};
+        hasher << m_salt << sig << pubkey << script_code << static_cast<int>(sigversion);
+        m_calls.push_back(hasher.GetHash());
+        return m_calls.back().GetUint64(0) & 1;
+    }
+
+    bool CheckSchnorrSignature(Span<const unsigned char> sig, Span<const unsigned char> pubkey, SigVersion sigversion, const ScriptExecutionData& execdata, ScriptError* serror) const override
+    {
+        CHashWriter hasher{SER_GETHASH, 0};
+        hasher << m_salt << sig << pubkey << static_cast<int>(sigversion) << execdata.m_annex_init << execdata.m_annex_present;
+        m_calls.push_back(hasher.GetHash());
+        if (sig.size() != 64 && sig.size() != 65) {
+            if (serror) *serror = SCRIPT_ERR_SCHNORR_SIG_SIZE;
+            return false;
+        }
+        if (!(m_calls.back().GetUint64(0) & 1)) {
+            if (serror) *serror = SCRIPT_ERR_SCHNORR_SIG;
+            return false;
+        }
+        return true;
+    }
+};
+
+std::vector<unsigned char> ConsumeProgram(FuzzedDataProvider& fuzzed_data_provider, const std::vector<unsigned char>& pubkey, size_t size)
+{
+    if (size == 20 && fuzzed_data_provider.ConsumeBool()) {
+        const uint160 hash{Hash160(pubkey)};
+        return {hash.begin(), hash.end()};
+    }
+    std::vector<unsigned char> program = fuzzed_data_provider.ConsumeBytes<unsigned char>(size);
+    program.resize(size);
+    return program;
+}
+} // namespace
+
+void initialize_script_fast_path()
+{
+}
+
+FUZZ_TARGET_INIT(script_fast_path, initialize_script_fast_path)
+{
+    FuzzedDataProvider fuzzed_data_provider(buffer.data(), buffer.size());
+
+    const std::vector<unsigned char> sig = ConsumeRandomLengthByteVector(fuzzed_data_provider, 80);
+    const std::vector<unsigned char> pubkey = ConsumeRandomLengthByteVector(fuzzed_data_provider, 70);
+
+    // Bias the spends towards the shapes the fast path handles.
+    CScript script_pubkey;
+    switch (fuzzed_data_provider.ConsumeIntegralInRange<int>(0, 3)) {
+    case 0:
+        script_pubkey << OP_DUP << OP_HASH160 << ConsumeProgram(fuzzed_data_provider, pubkey, 20) << OP_EQUALVERIFY << OP_CHECKSIG;
+        break;
+    case 1:
+        script_pubkey << OP_0 << ConsumeProgram(fuzzed_data_provider, pubkey, 20);
+        break;
+    case 2:
+        script_pubkey << OP_1 << ConsumeProgram(fuzzed_data_provider, pubkey, 32);
+        break;
+    case 3:
+        script_pubkey = ConsumeScript(fuzzed_data_provider);
+        break;
+    }
+
+    CScript script_sig;
+    if (fuzzed_data_provider.ConsumeBool()) {
+        script_sig << sig << pubkey;
+    } else {
+        script_sig = ConsumeScript(fuzzed_data_provider);
+    }
+
+    CScriptWitness witness;
+    switch (fuzzed_data_provider.ConsumeIntegralInRange<int>(0, 2)) {
+    case 0:
+        witness.stack = {sig, pubkey};
+        break;
+    case 1:
+        witness.stack = {sig};
+        break;
+    case 2:
+        witness = ConsumeScriptWitness(fuzzed_data_provider);
+        break;
+    }
+
+    const unsigned int flags = fuzzed_data_provider.ConsumeIntegral<unsigned int>();
+    const uint256 salt = ConsumeUInt256(fuzzed_data_provider);
+
+    const RecordingSignatureChecker fast_checker{salt};
+    ScriptError fast_error = SCRIPT_ERR_OK;
+    const std::optional<bool> fast = VerifyScriptFastPath(script_sig, script_pubkey, &witness, flags, fast_checker, &fast_error);
+    if (!fast) {
+        // Declining must leave no trace.
+        assert(fast_checker.m_calls.empty());
+        assert(fast_error == SCRIPT_ERR_OK);
+        return;
+    }
+
+    const RecordingSignatureChecker generic_checker{salt};
+    ScriptError generic_error;
+    const bool generic = VerifyScriptGeneric(script_sig, script_pubkey, &witness, flags, generic_checker, &generic_error);
+    assert(*fast == generic);
+    assert(fast_error == generic_error);
+    assert(fast_checker.m_calls == generic_checker.m_calls);
+}
@@ -426,6 +426,9 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     CTxMemPool pool;
     LOCK2(cs_main, pool.cs);
     TestMemPoolEntryHelper entry;
+    // The few removals in this test keep the change log in its first block,
+    // so its share of DynamicMemoryUsage() stays at the empty pool's usage.
+    const size_t change_log_usage = pool.DynamicMemoryUsage();
 
     CMutableTransaction tx1 = CMutableTransaction();
     tx1.vin.resize(1);
@@ -537,7 +540,7 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
         pool.addUnchecked(entry.Fee(1000LL).FromTx(tx5));
     pool.addUnchecked(entry.Fee(9000LL).FromTx(tx7));
 
-    pool.TrimToSize(pool.DynamicMemoryUsage() / 2); // should maximize mempool size by only removing 5/7
+    pool.TrimToSize(change_log_usage + (pool.DynamicMemoryUsage() - change_log_usage) / 2); // should maximize mempool size by only removing 5/7
     BOOST_CHECK(pool.exists(tx4.GetHash()));
     BOOST_CHECK(!pool.exists(tx5.GetHash()));
     BOOST_CHECK(pool.exists(tx6.GetHash()));
@@ -786,4 +789,173 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolSnapshotTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+
+    // [tx1] <- [tx2], where tx1 signals replaceability, and [tx3]
+    CMutableTransaction mtx1;
+    mtx1.vin.resize(1);
+    mtx1.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    mtx1.vin[0].nSequence = 0;
+    mtx1.vout.resize(1);
+    mtx1.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    mtx1.vout[0].nValue = 10 * COIN;
+    CTransactionRef tx1 = MakeTransactionRef(mtx1);
+    CTransactionRef tx2 = make_tx(/* output_values */ {9 * COIN}, /* inputs */ {tx1});
+    CTransactionRef tx3 = make_tx(/* output_values */ {10 * COIN});
+    {
+        LOCK2(cs_main, pool.cs);
+        pool.addUnchecked(entry.Fee(10000LL).FromTx(tx1));
+        pool.addUnchecked(entry.Fee(20000LL).FromTx(tx2));
+    }
+
+    std::shared_ptr<const MempoolSnapshot> snapshot = pool.GetSnapshot();
+    BOOST_REQUIRE_EQUAL(snapshot->entries.size(), 2U);
+    // Entries are in the order of the txid index, like getrawmempool reports them.
+    const size_t i1 = snapshot->entries[0].txid == tx1->GetHash() ? 0 : 1;
+    const size_t i2 = 1 - i1;
+    {
+        LOCK(pool.cs);
+        BOOST_CHECK(snapshot->entries[0].txid == pool.mapTx.begin()->GetTx().GetHash());
+    }
+    const MempoolEntrySnapshot& e1 = snapshot->entries[i1];
+    const MempoolEntrySnapshot& e2 = snapshot->entries[i2];
+    BOOST_CHECK(e1.txid == tx1->GetHash());
+    BOOST_CHECK(e1.wtxid == tx1->GetWitnessHash());
+    BOOST_CHECK_EQUAL(e1.fee, 10000);
+    BOOST_CHECK_EQUAL(e1.count_with_descendants, 2U);
+    BOOST_CHECK_EQUAL(e1.mod_fees_with_descendants, 30000);
+    BOOST_CHECK(e1.parents.empty());
+    BOOST_CHECK(e1.children == std::vector<uint256>{tx2->GetHash()});
+    BOOST_CHECK(e2.txid == tx2->GetHash());
+    BOOST_CHECK_EQUAL(e2.count_with_ancestors, 2U);
+    BOOST_CHECK(e2.parents == std::vector<uint256>{tx1->GetHash()});
+    BOOST_CHECK(e2.children.empty());
+    // tx2 is replaceable through its parent, as IsRBFOptIn() reports.
+    BOOST_CHECK(e1.bip125_replaceable);
+    BOOST_CHECK(e2.bip125_replaceable);
+    {
+        LOCK(pool.cs);
+        BOOST_CHECK(pool.SnapshotEntry(*pool.mapTx.find(tx2->GetHash())).bip125_replaceable);
+    }
+
+    // The snapshot is shared until the mempool changes, and is not affected
+    // by later changes.
+    BOOST_CHECK(pool.GetSnapshot() == snapshot);
+    pool.PrioritiseTransaction(tx2->GetHash(), 5000);
+    std::shared_ptr<const MempoolSnapshot> prioritised = pool.GetSnapshot();
+    BOOST_CHECK(prioritised != snapshot);
+    BOOST_CHECK_EQUAL(prioritised->entries[i2].modified_fee, 25000);
+    BOOST_CHECK_EQUAL(snapshot->entries[i2].modified_fee, 20000);
+
+    {
+        LOCK2(cs_main, pool.cs);
+        pool.addUnchecked(entry.Fee(10000LL).FromTx(tx3));
+        pool.removeRecursive(*tx1, MemPoolRemovalReason::REPLACED);
+    }
+    std::shared_ptr<const MempoolSnapshot> removed = pool.GetSnapshot();
+    BOOST_REQUIRE_EQUAL(removed->entries.size(), 1U);
+    BOOST_CHECK(removed->entries[0].txid == tx3->GetHash());
+    BOOST_CHECK(!removed->entries[0].bip125_replaceable);
+    BOOST_CHECK_GT(removed->sequence, snapshot->sequence);
+    BOOST_CHECK_EQUAL(prioritised->entries.size(), 2U);
+
+    // Repeated polls of an unchanged mempool return the same snapshot, also
+    // once the earlier callers are done with it.
+    std::weak_ptr<const MempoolSnapshot> polled = removed;
+    removed.reset();
+    BOOST_REQUIRE(!polled.expired());
+    BOOST_CHECK(pool.GetSnapshot() == polled.lock());
+    BOOST_CHECK(pool.GetSnapshot() == polled.lock());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolChangesTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+
+    // Add a transaction and log it, as AcceptToMemoryPool does.
+    auto add_tx = [&](const CTransactionRef& tx) {
+        LOCK2(cs_main, pool.cs);
+        pool.addUnchecked(entry.FromTx(tx));
+        pool.LogChange(tx->GetHash(), /* added */ true);
+    };
+    auto remove_tx = [&](const CTransactionRef& tx) {
+        LOCK2(cs_main, pool.cs);
+        pool.removeRecursive(*tx, MemPoolRemovalReason::CONFLICT);
+    };
+    auto sequence = [&] {
+        LOCK(pool.cs);
+        return pool.GetSequence();
+    };
+
+    CTransactionRef tx1 = make_tx(/* output_values */ {1 * COIN});
+    CTransactionRef tx2 = make_tx(/* output_values */ {2 * COIN});
+    CTransactionRef tx3 = make_tx(/* output_values */ {3 * COIN});
+    add_tx(tx1);
+    add_tx(tx2);
+    const uint64_t start = sequence();
+
+    // Nothing changed yet; the future is not covered.
+    std::optional<MempoolChanges> changes = pool.GetChangesSince(start);
+    BOOST_REQUIRE(changes);
+    BOOST_CHECK_EQUAL(changes->sequence, start);
+    BOOST_CHECK(changes->added.empty() && changes->removed.empty());
+    BOOST_CHECK(!pool.GetChangesSince(start + 1));
+
+    // tx3 is added and removed again, tx1 is removed, and tx2 is removed and
+    // added again (e.g. on a reorg).
+    add_tx(tx3);
+    remove_tx(tx3);
+    remove_tx(tx1);
+    remove_tx(tx2);
+    add_tx(tx2);
+    changes = pool.GetChangesSince(start);
+    BOOST_REQUIRE(changes);
+    BOOST_CHECK_EQUAL(changes->sequence, start + 5);
+    BOOST_CHECK_EQUAL(changes->sequence, sequence());
+    BOOST_CHECK(changes->added == std::vector<uint256>{tx2->GetHash()});
+    BOOST_CHECK(changes->removed == std::vector<uint256>{tx1->GetHash()});
+
+    // A later start only sees the later changes.
+    changes = pool.GetChangesSince(start + 3);
+    BOOST_REQUIRE(changes);
+    BOOST_CHECK(changes->added == std::vector<uint256>{tx2->GetHash()});
+    BOOST_CHECK(changes->removed.empty());
+
+    // Once the log is full, the oldest changes are dropped. The log counts
+    // towards the mempool's memory usage.
+    const size_t usage_before = pool.DynamicMemoryUsage();
+    for (size_t i = 0; i < MAX_MEMPOOL_CHANGE_LOG_SIZE; ++i) {
+        add_tx(tx3);
+        remove_tx(tx3);
+    }
+    BOOST_CHECK_GT(pool.DynamicMemoryUsage(), usage_before + MAX_MEMPOOL_CHANGE_LOG_SIZE * sizeof(uint256));
+    BOOST_CHECK(!pool.GetChangesSince(start));
+    changes = pool.GetChangesSince(sequence() - MAX_MEMPOOL_CHANGE_LOG_SIZE);
+    BOOST_REQUIRE(changes);
+    BOOST_CHECK(changes->added.empty() && changes->removed.empty());
+    BOOST_CHECK(!pool.GetChangesSince(sequence() - MAX_MEMPOOL_CHANGE_LOG_SIZE - 1));
+
+    // Clearing the mempool does not log removals, so it invalidates the log.
+    const uint64_t before_clear = sequence();
+    pool.clear();
+    BOOST_CHECK(!pool.GetChangesSince(before_clear - 1));
+    BOOST_CHECK(pool.GetChangesSince(before_clear));
+
+    // The log takes a bounded share of small mempools.
+    BOOST_CHECK_EQUAL(CTxMemPool::ChangeLogSizeForLimit(DEFAULT_MAX_MEMPOOL_SIZE * 1000000), MAX_MEMPOOL_CHANGE_LOG_SIZE);
+    const size_t small_log_size = CTxMemPool::ChangeLogSizeForLimit(5 * 1000000);
+    BOOST_CHECK_LT(small_log_size, MAX_MEMPOOL_CHANGE_LOG_SIZE);
+    CTxMemPool small_pool(/* estimator */ nullptr, /* check_ratio */ 0, /* track_clusters */ false, small_log_size);
+    const uint64_t small_start = WITH_LOCK(small_pool.cs, return small_pool.GetSequence());
+    for (size_t i = 0; i <= small_log_size; ++i) {
+        WITH_LOCK(small_pool.cs, small_pool.LogChange(tx1->GetHash(), /* added */ true));
+    }
+    BOOST_CHECK(!small_pool.GetChangesSince(small_start));
+    BOOST_CHECK(small_pool.GetChangesSince(small_start + 1));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
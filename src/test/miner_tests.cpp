@@ -16,6 +16,7 @@
 #include <util/system.h>
 #include <util/time.h>
 #include <validation.h>
+#include <validationinterface.h>
 
 #include <test/util/setup_common.h>
 
@@ -25,13 +26,14 @@
 
 namespace miner_tests {
 struct MinerTestingSetup : public TestingSetup {
-    void TestPackageSelection(const CChainParams& chainparams, const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_node.mempool->cs);
+    void TestPackageSelection(const CChainParams& chainparams, const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst, CTxMemPool& mempool) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, mempool.cs);
     bool TestSequenceLocks(const CTransaction& tx, int flags) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_node.mempool->cs)
     {
         CCoinsViewMemPool view_mempool(&m_node.chainman->ActiveChainstate().CoinsTip(), *m_node.mempool);
         return CheckSequenceLocks(m_node.chainman->ActiveChain().Tip(), view_mempool, tx, flags);
     }
     BlockAssembler AssemblerForTest(const CChainParams& params);
+    BlockAssembler AssemblerForTest(const CChainParams& params, const CTxMemPool& mempool);
 };
 } // namespace miner_tests
 
@@ -40,12 +42,17 @@ BOOST_FIXTURE_TEST_SUITE(miner_tests, MinerTestingSetup)
 static CFeeRate blockMinFeeRate = CFeeRate(DEFAULT_BLOCK_MIN_TX_FEE);
 
 BlockAssembler MinerTestingSetup::AssemblerForTest(const CChainParams& params)
+{
+    return AssemblerForTest(params, *m_node.mempool);
+}
+
+BlockAssembler MinerTestingSetup::AssemblerForTest(const CChainParams& params, const CTxMemPool& mempool)
 {
     BlockAssembler::Options options;
 
     options.nBlockMaxWeight = MAX_BLOCK_WEIGHT;
     options.blockMinFeeRate = blockMinFeeRate;
-    return BlockAssembler(m_node.chainman->ActiveChainstate(), *m_node.mempool, params, options);
+    return BlockAssembler(m_node.chainman->ActiveChainstate(), mempool, params, options);
 }
 
 constexpr static struct {
@@ -93,7 +100,7 @@ static CBlockIndex CreateBlockIndex(int nHeight, CBlockIndex* active_chain_tip)
 // Test suite for ancestor feerate transaction selection.
 // Implemented as an additional function, rather than a separate test case,
 // to allow reusing the blockchain created in CreateNewBlock_validity.
-void MinerTestingSetup::TestPackageSelection(const CChainParams& chainparams, const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst)
+void MinerTestingSetup::TestPackageSelection(const CChainParams& chainparams, const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst, CTxMemPool& mempool)
 {
     // Test the ancestor feerate transaction selection.
     TestMemPoolEntryHelper entry;
@@ -109,21 +116,21 @@ void MinerTestingSetup::TestPackageSelection(const CChainParams& chainparams, co
     tx.vout[0].nValue = 5000000000LL - 1000;
     // This tx has a low fee: 1000 satoshis
     uint256 hashParentTx = tx.GetHash(); // save this txid for later use
-    m_node.mempool->addUnchecked(entry.Fee(1000).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
+    mempool.addUnchecked(entry.Fee(1000).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
 
     // This tx has a medium fee: 10000 satoshis
     tx.vin[0].prevout.hash = txFirst[1]->GetHash();
     tx.vout[0].nValue = 5000000000LL - 10000;
     uint256 hashMediumFeeTx = tx.GetHash();
-    m_node.mempool->addUnchecked(entry.Fee(10000).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
+    mempool.addUnchecked(entry.Fee(10000).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
 
     // This tx has a high fee, but depends on the first transaction
     tx.vin[0].prevout.hash = hashParentTx;
     tx.vout[0].nValue = 5000000000LL - 1000 - 50000; // 50k satoshi fee
     uint256 hashHighFeeTx = tx.GetHash();
-    m_node.mempool->addUnchecked(entry.Fee(50000).Time(GetTime()).SpendsCoinbase(false).FromTx(tx));
+    mempool.addUnchecked(entry.Fee(50000).Time(GetTime()).SpendsCoinbase(false).FromTx(tx));
 
-    std::unique_ptr<CBlockTemplate> pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    std::unique_ptr<CBlockTemplate> pblocktemplate = AssemblerForTest(chainparams, mempool).CreateNewBlock(scriptPubKey);
     BOOST_REQUIRE_EQUAL(pblocktemplate->block.vtx.size(), 4U);
     BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == hashParentTx);
     BOOST_CHECK(pblocktemplate->block.vtx[2]->GetHash() == hashHighFeeTx);
@@ -133,7 +140,7 @@ void MinerTestingSetup::TestPackageSelection(const CChainParams& chainparams, co
     tx.vin[0].prevout.hash = hashHighFeeTx;
     tx.vout[0].nValue = 5000000000LL - 1000 - 50000; // 0 fee
     uint256 hashFreeTx = tx.GetHash();
-    m_node.mempool->addUnchecked(entry.Fee(0).FromTx(tx));
+    mempool.addUnchecked(entry.Fee(0).FromTx(tx));
     size_t freeTxSize = ::GetSerializeSize(tx, PROTOCOL_VERSION);
 
     // Calculate a fee on child transaction that will put the package just
@@ -143,8 +150,8 @@ void MinerTestingSetup::TestPackageSelection(const CChainParams& chainparams, co
     tx.vin[0].prevout.hash = hashFreeTx;
     tx.vout[0].nValue = 5000000000LL - 1000 - 50000 - feeToUse;
     uint256 hashLowFeeTx = tx.GetHash();
-    m_node.mempool->addUnchecked(entry.Fee(feeToUse).FromTx(tx));
-    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    mempool.addUnchecked(entry.Fee(feeToUse).FromTx(tx));
+    pblocktemplate = AssemblerForTest(chainparams, mempool).CreateNewBlock(scriptPubKey);
     // Verify that the free tx and the low fee tx didn't get selected
     for (size_t i=0; i<pblocktemplate->block.vtx.size(); ++i) {
         BOOST_CHECK(pblocktemplate->block.vtx[i]->GetHash() != hashFreeTx);
@@ -154,11 +161,11 @@ void MinerTestingSetup::TestPackageSelection(const CChainParams& chainparams, co
     // Test that packages above the min relay fee do get included, even if one
     // of the transactions is below the min relay fee
     // Remove the low fee transaction and replace with a higher fee transaction
-    m_node.mempool->removeRecursive(CTransaction(tx), MemPoolRemovalReason::REPLACED);
+    mempool.removeRecursive(CTransaction(tx), MemPoolRemovalReason::REPLACED);
     tx.vout[0].nValue -= 2; // Now we should be just over the min relay fee
     hashLowFeeTx = tx.GetHash();
-    m_node.mempool->addUnchecked(entry.Fee(feeToUse+2).FromTx(tx));
-    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    mempool.addUnchecked(entry.Fee(feeToUse+2).FromTx(tx));
+    pblocktemplate = AssemblerForTest(chainparams, mempool).CreateNewBlock(scriptPubKey);
     BOOST_REQUIRE_EQUAL(pblocktemplate->block.vtx.size(), 6U);
     BOOST_CHECK(pblocktemplate->block.vtx[4]->GetHash() == hashFreeTx);
     BOOST_CHECK(pblocktemplate->block.vtx[5]->GetHash() == hashLowFeeTx);
@@ -171,7 +178,7 @@ void MinerTestingSetup::TestPackageSelection(const CChainParams& chainparams, co
     tx.vout[0].nValue = 5000000000LL - 100000000;
     tx.vout[1].nValue = 100000000; // 1BTC output
     uint256 hashFreeTx2 = tx.GetHash();
-    m_node.mempool->addUnchecked(entry.Fee(0).SpendsCoinbase(true).FromTx(tx));
+    mempool.addUnchecked(entry.Fee(0).SpendsCoinbase(true).FromTx(tx));
 
     // This tx can't be mined by itself
     tx.vin[0].prevout.hash = hashFreeTx2;
@@ -179,8 +186,8 @@ void MinerTestingSetup::TestPackageSelection(const CChainParams& chainparams, co
     feeToUse = blockMinFeeRate.GetFee(freeTxSize);
     tx.vout[0].nValue = 5000000000LL - 100000000 - feeToUse;
     uint256 hashLowFeeTx2 = tx.GetHash();
-    m_node.mempool->addUnchecked(entry.Fee(feeToUse).SpendsCoinbase(false).FromTx(tx));
-    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    mempool.addUnchecked(entry.Fee(feeToUse).SpendsCoinbase(false).FromTx(tx));
+    pblocktemplate = AssemblerForTest(chainparams, mempool).CreateNewBlock(scriptPubKey);
 
     // Verify that this tx isn't selected.
     for (size_t i=0; i<pblocktemplate->block.vtx.size(); ++i) {
@@ -192,8 +199,8 @@ void MinerTestingSetup::TestPackageSelection(const CChainParams& chainparams, co
     // as well.
     tx.vin[0].prevout.n = 1;
     tx.vout[0].nValue = 100000000 - 10000; // 10k satoshi fee
-    m_node.mempool->addUnchecked(entry.Fee(10000).FromTx(tx));
-    pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+    mempool.addUnchecked(entry.Fee(10000).FromTx(tx));
+    pblocktemplate = AssemblerForTest(chainparams, mempool).CreateNewBlock(scriptPubKey);
     BOOST_REQUIRE_EQUAL(pblocktemplate->block.vtx.size(), 9U);
     BOOST_CHECK(pblocktemplate->block.vtx[8]->GetHash() == hashLowFeeTx2);
 }
@@ -522,9 +529,96 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     SetMockTime(0);
     m_node.mempool->clear();
 
-    TestPackageSelection(chainparams, scriptPubKey, txFirst);
+    TestPackageSelection(chainparams, scriptPubKey, txFirst, *m_node.mempool);
+
+    // Repeat with a mempool that tracks clusters, which assembles the block
+    // from the chunks of the cluster linearizations instead.
+    CTxMemPool cluster_mempool(/* estimator */ nullptr, /* check_ratio */ 0, /* track_clusters */ true);
+    {
+        LOCK(cluster_mempool.cs);
+        TestPackageSelection(chainparams, scriptPubKey, txFirst, cluster_mempool);
+    }
 
     fCheckpointsEnabled = true;
 }
 
+static void CheckTemplateValidity(CChainState& chainstate, const CBlockTemplate& block_template)
+{
+    LOCK(cs_main);
+    BlockValidationState state;
+    BOOST_CHECK(TestBlockValidity(state, Params(), chainstate, block_template.block, chainstate.m_chain.Tip(), false, false));
+}
+
+BOOST_FIXTURE_TEST_CASE(block_template_cache, TestChain100Setup)
+{
+    // Make the first two coinbase outputs spendable.
+    mineBlocks(2);
+    CChainState& chainstate = m_node.chainman->ActiveChainstate();
+    BlockTemplateCache cache(*m_node.chainman, *m_node.mempool, Params());
+    RegisterValidationInterface(&cache);
+    SetMockTime(GetTime());
+
+    const CScript script_pub_key = CScript() << OP_TRUE;
+    const CScript p2pk = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const CAmount subsidy = GetBlockSubsidy(WITH_LOCK(cs_main, return chainstate.m_chain.Height()) + 1, Params().GetConsensus());
+
+    std::unique_ptr<CBlockTemplate> block_template = cache.GetTemplate(script_pub_key);
+    BOOST_CHECK_EQUAL(block_template->block.vtx.size(), 1U);
+
+    // New transactions are appended once their notifications arrived, and
+    // the coinbase collects their fees.
+    const CMutableTransaction parent = CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 1, coinbaseKey, p2pk, 49 * COIN);
+    const CMutableTransaction child = CreateValidMempoolTransaction(MakeTransactionRef(parent), 0, 101, coinbaseKey, p2pk, 48 * COIN);
+    SyncWithValidationInterfaceQueue();
+    block_template = cache.GetTemplate(script_pub_key);
+    BOOST_REQUIRE_EQUAL(block_template->block.vtx.size(), 3U);
+    BOOST_CHECK(block_template->block.vtx[1]->GetHash() == parent.GetHash());
+    BOOST_CHECK(block_template->block.vtx[2]->GetHash() == child.GetHash());
+    BOOST_CHECK_EQUAL(block_template->block.vtx[0]->GetValueOut(), subsidy + 2 * COIN);
+    BOOST_CHECK_EQUAL(block_template->vTxFees[0], -2 * COIN);
+    CheckTemplateValidity(chainstate, *block_template);
+
+    // A fee delta is not notified, so it only takes effect when the template
+    // is rebuilt, which happens at most once per rebuild interval.
+    m_node.mempool->PrioritiseTransaction(child.GetHash(), -1 * COIN);
+    block_template = cache.GetTemplate(script_pub_key);
+    BOOST_CHECK_EQUAL(block_template->block.vtx.size(), 3U);
+    SetMockTime(GetTime<std::chrono::seconds>() + BLOCK_TEMPLATE_REBUILD_INTERVAL);
+    block_template = cache.GetTemplate(script_pub_key);
+    BOOST_REQUIRE_EQUAL(block_template->block.vtx.size(), 2U);
+    BOOST_CHECK(block_template->block.vtx[1]->GetHash() == parent.GetHash());
+    m_node.mempool->PrioritiseTransaction(child.GetHash(), 1 * COIN);
+
+    // Removed transactions are dropped along with their descendants.
+    {
+        LOCK2(cs_main, m_node.mempool->cs);
+        m_node.mempool->removeRecursive(CTransaction(parent), MemPoolRemovalReason::CONFLICT);
+    }
+    SyncWithValidationInterfaceQueue();
+    block_template = cache.GetTemplate(script_pub_key);
+    BOOST_CHECK_EQUAL(block_template->block.vtx.size(), 1U);
+    BOOST_CHECK_EQUAL(block_template->block.vtx[0]->GetValueOut(), subsidy);
+    CheckTemplateValidity(chainstate, *block_template);
+
+    // Changes whose notifications are still queued are picked up by
+    // rebuilding the template.
+    const CMutableTransaction tx = CreateValidMempoolTransaction(m_coinbase_txns[1], 0, 2, coinbaseKey, p2pk, 49 * COIN);
+    block_template = cache.GetTemplate(script_pub_key);
+    BOOST_REQUIRE_EQUAL(block_template->block.vtx.size(), 2U);
+    BOOST_CHECK(block_template->block.vtx[1]->GetHash() == tx.GetHash());
+    CheckTemplateValidity(chainstate, *block_template);
+
+    // A new tip gives a new template.
+    SetMockTime(GetTime<std::chrono::seconds>() + std::chrono::seconds{1});
+    CreateAndProcessBlock({}, p2pk);
+    block_template = cache.GetTemplate(script_pub_key);
+    BOOST_CHECK(block_template->block.hashPrevBlock == WITH_LOCK(cs_main, return chainstate.m_chain.Tip()->GetBlockHash()));
+    BOOST_CHECK_EQUAL(block_template->block.vtx.size(), 2U);
+    CheckTemplateValidity(chainstate, *block_template);
+
+    SyncWithValidationInterfaceQueue();
+    UnregisterValidationInterface(&cache);
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,217 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <memusage.h>
+#include <span.h>
+#include <support/allocators/pool.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Helper to get access to private parts of PoolResource. Used in unit tests.
+ */
+class PoolResourceTester
+{
+public:
+    /**
+     * Counts the number of free blocks per freelist.
+     */
+    template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+    static std::vector<std::size_t> FreeListSizes(const PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& resource)
+    {
+        std::vector<std::size_t> sizes;
+        for (const auto* ptr : resource.m_free_lists) {
+            std::size_t size = 0;
+            while (ptr != nullptr) {
+                ++size;
+                ptr = ptr->m_next;
+            }
+            sizes.push_back(size);
+        }
+        return sizes;
+    }
+
+    /**
+     * How many bytes are still available in the current chunk.
+     */
+    template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+    static std::size_t AvailableMemoryFromChunk(const PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& resource)
+    {
+        return resource.m_available_memory_end - resource.m_available_memory_it;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    auto resource = PoolResource<8, 8>(1024);
+    BOOST_TEST(1 == resource.NumAllocatedChunks());
+
+    // first chunk is already allocated
+    size_t expected_bytes_available = resource.ChunkSizeBytes();
+    BOOST_TEST(expected_bytes_available == PoolResourceTester::AvailableMemoryFromChunk(resource));
+
+    // chunk is used, no more allocation
+    void* block = resource.Allocate(8, 8);
+    expected_bytes_available -= 8;
+    BOOST_TEST(expected_bytes_available == PoolResourceTester::AvailableMemoryFromChunk(resource));
+
+    BOOST_TEST(0 == PoolResourceTester::FreeListSizes(resource)[1]);
+    resource.Deallocate(block, 8, 8);
+    BOOST_TEST(1 == PoolResourceTester::FreeListSizes(resource)[1]);
+
+    // alignment is too small, but the best fitting freelist is used. Nothing is allocated.
+    void* b = resource.Allocate(8, 1);
+    BOOST_TEST(b == block); // we got the same block of memory as before
+    BOOST_TEST(0 == PoolResourceTester::FreeListSizes(resource)[1]);
+    resource.Deallocate(b, 8, 1);
+    BOOST_TEST(1 == PoolResourceTester::FreeListSizes(resource)[1]);
+
+    // alignment too large, will be served by operator new() and not touch the pool
+    b = resource.Allocate(8, 16);
+    BOOST_TEST(b != block);
+    BOOST_TEST(1 == PoolResourceTester::FreeListSizes(resource)[1]);
+    resource.Deallocate(b, 8, 16);
+
+    // size too large, will be served by operator new()
+    b = resource.Allocate(16, 8);
+    BOOST_TEST(b != block);
+    BOOST_TEST(expected_bytes_available == PoolResourceTester::AvailableMemoryFromChunk(resource));
+    resource.Deallocate(b, 16, 8);
+
+    // zero sized allocations use the pool, rounded up to the smallest block size
+    b = resource.Allocate(0, 1);
+    BOOST_TEST(b == block);
+    resource.Deallocate(b, 0, 1);
+    BOOST_TEST(1 == PoolResourceTester::FreeListSizes(resource)[1]);
+}
+
+// Allocates from 0 to n bytes where n > chunk size, so at least one new chunk is needed.
+// The leftover memory of the previous chunk ends up in a freelist.
+BOOST_AUTO_TEST_CASE(allocate_any_byte)
+{
+    auto resource = PoolResource<128, 8>(1024);
+
+    uint8_t num_allocs = 200;
+
+    auto data = std::vector<Span<uint8_t>>();
+
+    // allocate an increasing number of bytes
+    for (uint8_t num_bytes = 0; num_bytes < num_allocs; ++num_bytes) {
+        uint8_t* bytes = new (resource.Allocate(num_bytes, 1)) uint8_t[num_bytes];
+        BOOST_TEST(bytes != nullptr);
+        data.emplace_back(bytes, num_bytes);
+
+        // set each byte to num_bytes
+        std::fill(bytes, bytes + num_bytes, num_bytes);
+    }
+
+    // now that we got all allocated, test if all still have the correct values, and give everything back to the allocator
+    uint8_t val = 0;
+    for (auto const& span : data) {
+        for (auto x : span) {
+            BOOST_TEST(val == x);
+        }
+        std::destroy(span.data(), span.data() + span.size());
+        resource.Deallocate(span.data(), span.size(), 1);
+        ++val;
+    }
+
+    // The 129 allocations served by the pool take 8712 bytes when rounded up
+    // to the alignment, which doesn't fit in fewer than 9 chunks of 1024 bytes.
+    BOOST_TEST(9 == resource.NumAllocatedChunks());
+}
+
+BOOST_AUTO_TEST_CASE(memusage_test)
+{
+    auto std_map = std::unordered_map<int, int>{};
+
+    using Map = std::unordered_map<int,
+                                   int,
+                                   std::hash<int>,
+                                   std::equal_to<int>,
+                                   PoolAllocator<std::pair<const int, int>,
+                                                 sizeof(std::pair<const int, int>) + sizeof(void*) * 4>>;
+    auto resource = Map::allocator_type::ResourceType(1024);
+    auto resource_map = Map{0, std::hash<int>{}, std::equal_to<int>{}, &resource};
+
+    // can't have the same resource usage
+    BOOST_TEST(memusage::DynamicUsage(std_map) != memusage::DynamicUsage(resource_map));
+
+    for (size_t i = 0; i < 10000; ++i) {
+        std_map[i];
+        resource_map[i];
+    }
+
+    // Eventually the resource_map should have a much lower memory usage because it has less malloc overhead
+    BOOST_TEST(memusage::DynamicUsage(resource_map) <= memusage::DynamicUsage(std_map) * 90 / 100);
+}
+
+BOOST_AUTO_TEST_CASE(coins_map_memusage)
+{
+    // A pool-allocated CCoinsMap must account for less memory per coin than
+    // the same entries allocated one node at a time.
+    using StdCoinsMap = std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher>;
+    StdCoinsMap std_map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap coins_map{0, SaltedOutpointHasher{}, CCoinsMap::key_equal{}, &resource};
+
+    for (uint32_t i = 0; i < 100000; ++i) {
+        const COutPoint outpoint{InsecureRand256(), i};
+        std_map.emplace(outpoint, CCoinsCacheEntry{});
+        coins_map.emplace(outpoint, CCoinsCacheEntry{});
+    }
+    BOOST_TEST(memusage::DynamicUsage(coins_map) < memusage::DynamicUsage(std_map));
+
+    // Erased nodes are reused rather than returned to the system, and are not
+    // accounted for as used memory while they wait in the freelists.
+    const size_t chunks = resource.NumAllocatedChunks();
+    const size_t usage = memusage::DynamicUsage(coins_map);
+    coins_map.clear();
+    BOOST_TEST(resource.FreeListBytes() > 0);
+    BOOST_TEST(memusage::DynamicUsage(coins_map) < usage);
+    for (uint32_t i = 0; i < 100000; ++i) {
+        coins_map.emplace(COutPoint{InsecureRand256(), i}, CCoinsCacheEntry{});
+    }
+    BOOST_TEST(resource.NumAllocatedChunks() == chunks);
+}
+
+BOOST_AUTO_TEST_CASE(block_map_memusage)
+{
+    // Storing the block index entries in pool-allocated map nodes must take
+    // less memory than a map of pointers to individually allocated entries.
+    using StdBlockMap = std::unordered_map<uint256, CBlockIndex*, BlockHasher>;
+    StdBlockMap std_map;
+    BlockMapMemoryResource resource;
+    BlockMap block_map{0, BlockHasher{}, BlockMap::key_equal{}, &resource};
+
+    std::vector<std::unique_ptr<CBlockIndex>> entries;
+    for (uint32_t i = 0; i < 100000; ++i) {
+        const uint256 hash{InsecureRand256()};
+        entries.push_back(std::make_unique<CBlockIndex>());
+        std_map.emplace(hash, entries.back().get());
+        auto [it, inserted] = block_map.emplace(std::piecewise_construct, std::forward_as_tuple(hash), std::forward_as_tuple());
+        BOOST_CHECK(inserted);
+        it->second.phashBlock = &it->first;
+    }
+    const size_t std_usage = memusage::DynamicUsage(std_map) + entries.size() * memusage::MallocUsage(sizeof(CBlockIndex));
+    BOOST_TEST(memusage::DynamicUsage(block_map) < std_usage);
+
+    // Entries do not move when the map rehashes.
+    for (const auto& [hash, index] : block_map) {
+        BOOST_CHECK(index.phashBlock == &hash);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
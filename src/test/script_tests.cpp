@@ -23,6 +23,7 @@
 #include <script/bitcoinconsensus.h>
 #endif
 
+#include <algorithm>
 #include <stdint.h>
 #include <string>
 #include <vector>
@@ -137,6 +138,10 @@ void DoTest(const CScript& scriptPubKey, const CScript& scriptSig, const CScript
     BOOST_CHECK_MESSAGE(VerifyScript(scriptSig, scriptPubKey, &scriptWitness, flags, MutableTransactionSignatureChecker(&tx, 0, txCredit.vout[0].nValue, MissingDataBehavior::ASSERT_FAIL), &err) == expect, message);
     BOOST_CHECK_MESSAGE(err == scriptError, FormatScriptError(err) + " where " + FormatScriptError((ScriptError_t)scriptError) + " expected: " + message);
 
+    // Verify that the generic interpreter agrees with the standard spend fast path.
+    BOOST_CHECK_MESSAGE(VerifyScriptGeneric(scriptSig, scriptPubKey, &scriptWitness, flags, MutableTransactionSignatureChecker(&tx, 0, txCredit.vout[0].nValue, MissingDataBehavior::ASSERT_FAIL), &err) == expect, message + " (generic)");
+    BOOST_CHECK_MESSAGE(err == scriptError, FormatScriptError(err) + " where " + FormatScriptError((ScriptError_t)scriptError) + " expected: " + message + " (generic)");
+
     // Verify that removing flags from a passing test or adding flags to a failing test does not change the result.
     for (int i = 0; i < 16; ++i) {
         int extra_flags = InsecureRandBits(16);
@@ -1469,6 +1474,54 @@ BOOST_AUTO_TEST_CASE(script_HasValidOps)
     BOOST_CHECK(!script.HasValidOps());
 }
 
+BOOST_AUTO_TEST_CASE(script_stack)
+{
+    // ScriptStack must behave like the std::vector it stands in for.
+    using Element = ScriptStack::value_type;
+    ScriptStack stack;
+    std::vector<Element> model;
+    const auto check = [&] { BOOST_CHECK(std::equal(stack.begin(), stack.end(), model.begin(), model.end())); };
+    for (unsigned char i = 0; i < 8; ++i) {
+        stack.push_back(Element(i + 1, i));
+        model.push_back(Element(i + 1, i));
+    }
+    check();
+    stack.erase(stack.end() - 6, stack.end() - 4);
+    model.erase(model.end() - 6, model.end() - 4);
+    check();
+    stack.erase(stack.end() - 2);
+    model.erase(model.end() - 2);
+    check();
+    stack.insert(stack.end() - 2, Element{0xab});
+    model.insert(model.end() - 2, Element{0xab});
+    check();
+    stack.push_back(stack.back());
+    model.push_back(model.back());
+    check();
+    stack.resize(1);
+    model.resize(1);
+    check();
+    BOOST_CHECK_THROW(stack.at(1), std::out_of_range);
+
+    // Popped elements keep their buffer for the next push.
+    stack.push_back(Element(72, 0x30));
+    const unsigned char* buffer = stack.back().data();
+    stack.pop_back();
+    stack.push_back(Element(33, 0x02));
+    BOOST_CHECK(stack.back().data() == buffer);
+    stack.clear();
+    BOOST_CHECK(stack.empty());
+    stack.push_back(Element(20, 0x14));
+    stack.push_back(Element(72, 0x30));
+    BOOST_CHECK(stack.back().data() == buffer);
+
+    // Buffers larger than any script element are released on clear().
+    stack.push_back(Element(MAX_SCRIPT_ELEMENT_SIZE + 1, 0x01));
+    stack.clear();
+    for (int i = 0; i < 3; ++i) stack.push_back(Element(1, 0x01));
+    for (const Element& element : stack) BOOST_CHECK_LE(element.capacity(), MAX_SCRIPT_ELEMENT_SIZE);
+}
+
 static CMutableTransaction TxFromHex(const std::string& str)
 {
     CMutableTransaction tx;
@@ -0,0 +1,235 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <amount.h>
+#include <policy/feerate.h>
+#include <policy/policy.h>
+#include <txcluster.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(txcluster_tests, TestingSetup)
+
+namespace {
+
+/** Create a transaction spending the given outpoints, or a unique null input
+ *  if there are none. */
+CTransactionRef MakeTx(const std::vector<COutPoint>& inputs, size_t num_outputs = 1)
+{
+    static int nonce{0};
+    CMutableTransaction tx;
+    if (inputs.empty()) {
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << ++nonce;
+    }
+    for (const COutPoint& input : inputs) {
+        tx.vin.emplace_back(input);
+        tx.vin.back().scriptSig = CScript() << ++nonce;
+    }
+    tx.vout.resize(num_outputs);
+    for (CTxOut& out : tx.vout) {
+        out.scriptPubKey = CScript() << OP_TRUE;
+        out.nValue = COIN;
+    }
+    return MakeTransactionRef(tx);
+}
+
+CFeeRate OwnFeeRate(const CTxMemPool& pool, const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    auto it = pool.mapTx.find(tx->GetHash());
+    return CFeeRate(it->GetModifiedFee(), it->GetTxSize());
+}
+
+CFeeRate MiningScore(const CTxMemPool& pool, const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    return pool.GetMiningScore(*pool.mapTx.find(tx->GetHash()));
+}
+
+const TxCluster& ClusterOf(const CTxMemPool& pool, const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    return *pool.GetClusters().GetCluster(*pool.mapTx.find(tx->GetHash()));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(fee_frac_comparison)
+{
+    BOOST_CHECK_EQUAL(CompareFeeFrac(1, 1, 1, 1), 0);
+    BOOST_CHECK_EQUAL(CompareFeeFrac(2, 4, 1, 2), 0);
+    BOOST_CHECK(CompareFeeFrac(1, 2, 1, 3) > 0);
+    BOOST_CHECK(CompareFeeFrac(1, 3, 1, 2) < 0);
+    BOOST_CHECK(CompareFeeFrac(-1, 2, 0, 1) < 0);
+    BOOST_CHECK(CompareFeeFrac(-1, 3, -1, 2) > 0);
+    // Products well beyond 64 bits.
+    BOOST_CHECK(CompareFeeFrac(MAX_MONEY, 4000000000, MAX_MONEY - 1, 4000000000) > 0);
+    BOOST_CHECK(CompareFeeFrac(MAX_MONEY, 4000000000, MAX_MONEY, 3999999999) < 0);
+    BOOST_CHECK(CompareFeeFrac(-MAX_MONEY, 4000000000, -MAX_MONEY, 3999999999) > 0);
+    BOOST_CHECK_EQUAL(CompareFeeFrac(MAX_MONEY, 4000000000, MAX_MONEY, 4000000000), 0);
+}
+
+BOOST_AUTO_TEST_CASE(cluster_tracking)
+{
+    CTxMemPool pool(/* estimator */ nullptr, /* check_ratio */ 0, /* track_clusters */ true);
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+    const TxClusterSet& clusters = pool.GetClusters();
+
+    const CTransactionRef tx_a = MakeTx({}, 2);
+    const CTransactionRef tx_b = MakeTx({});
+    pool.addUnchecked(entry.Fee(1000).FromTx(tx_a));
+    pool.addUnchecked(entry.Fee(10000).FromTx(tx_b));
+    clusters.Check(pool.size());
+    BOOST_CHECK_EQUAL(clusters.Size(), 2U);
+    BOOST_CHECK(MiningScore(pool, tx_a) == OwnFeeRate(pool, tx_a));
+
+    // A high fee child pays for its parent: both are in one chunk.
+    const CTransactionRef tx_c = MakeTx({COutPoint(tx_a->GetHash(), 0)});
+    pool.addUnchecked(entry.Fee(50000).FromTx(tx_c));
+    clusters.Check(pool.size());
+    BOOST_CHECK_EQUAL(clusters.Size(), 2U);
+    const CFeeRate package_rate(51000, GetVirtualTransactionSize(*tx_a) + GetVirtualTransactionSize(*tx_c));
+    BOOST_CHECK(MiningScore(pool, tx_a) == package_rate);
+    BOOST_CHECK(MiningScore(pool, tx_c) == package_rate);
+    BOOST_CHECK(pool.GetClusters().GetWorstCluster() == &ClusterOf(pool, tx_b));
+
+    // A zero fee child of both clusters merges them, and ends up on its own
+    // in the last chunk.
+    const CTransactionRef tx_d = MakeTx({COutPoint(tx_a->GetHash(), 1), COutPoint(tx_b->GetHash(), 0)});
+    pool.addUnchecked(entry.Fee(0).FromTx(tx_d));
+    clusters.Check(pool.size());
+    BOOST_CHECK_EQUAL(clusters.Size(), 1U);
+    BOOST_CHECK(MiningScore(pool, tx_d) == CFeeRate(0));
+    BOOST_CHECK(&ClusterOf(pool, tx_d) == &ClusterOf(pool, tx_b));
+    BOOST_CHECK_EQUAL(ClusterOf(pool, tx_d).m_txs.back()->GetTx().GetHash(), tx_d->GetHash());
+
+    // Prioritising it moves it forward, together with its ancestors.
+    pool.PrioritiseTransaction(tx_d->GetHash(), 10 * COIN);
+    clusters.Check(pool.size());
+    BOOST_CHECK(MiningScore(pool, tx_d) > package_rate);
+    BOOST_CHECK(MiningScore(pool, tx_b) == MiningScore(pool, tx_d));
+    pool.PrioritiseTransaction(tx_d->GetHash(), -10 * COIN);
+    clusters.Check(pool.size());
+    BOOST_CHECK(MiningScore(pool, tx_d) == CFeeRate(0));
+
+    // Removing the transaction joining both sides splits the cluster again.
+    pool.removeRecursive(*tx_d, MemPoolRemovalReason::REPLACED);
+    clusters.Check(pool.size());
+    BOOST_CHECK_EQUAL(clusters.Size(), 2U);
+    BOOST_CHECK(&ClusterOf(pool, tx_a) != &ClusterOf(pool, tx_b));
+
+    // Confirming the parent leaves its child in a cluster of its own.
+    pool.removeForBlock({tx_a}, 1);
+    clusters.Check(pool.size());
+    BOOST_CHECK_EQUAL(clusters.Size(), 2U);
+    BOOST_CHECK(MiningScore(pool, tx_c) == OwnFeeRate(pool, tx_c));
+    BOOST_CHECK_EQUAL(ClusterOf(pool, tx_c).m_txs.size(), 1U);
+
+    pool.clear();
+    BOOST_CHECK_EQUAL(clusters.Size(), 0U);
+    BOOST_CHECK(clusters.GetWorstCluster() == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(cluster_linearization)
+{
+    CTxMemPool pool(/* estimator */ nullptr, /* check_ratio */ 0, /* track_clusters */ true);
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+    const TxClusterSet& clusters = pool.GetClusters();
+
+    // Children arriving in increasing feerate order would all be merged into
+    // a single chunk by appending them; relinearizing orders them by feerate.
+    const CTransactionRef parent = MakeTx({}, 3);
+    const CTransactionRef low = MakeTx({COutPoint(parent->GetHash(), 0)});
+    const CTransactionRef medium = MakeTx({COutPoint(parent->GetHash(), 1)});
+    const CTransactionRef high = MakeTx({COutPoint(parent->GetHash(), 2)});
+    pool.addUnchecked(entry.Fee(0).FromTx(parent));
+    pool.addUnchecked(entry.Fee(1000).FromTx(low));
+    pool.addUnchecked(entry.Fee(5000).FromTx(medium));
+    pool.addUnchecked(entry.Fee(100000).FromTx(high));
+    clusters.Check(pool.size());
+
+    const TxCluster& cluster = ClusterOf(pool, parent);
+    BOOST_REQUIRE_EQUAL(cluster.m_txs.size(), 4U);
+    BOOST_CHECK_EQUAL(cluster.m_txs[0]->GetTx().GetHash(), parent->GetHash());
+    BOOST_CHECK_EQUAL(cluster.m_txs[1]->GetTx().GetHash(), high->GetHash());
+    BOOST_CHECK_EQUAL(cluster.m_txs[2]->GetTx().GetHash(), medium->GetHash());
+    BOOST_CHECK_EQUAL(cluster.m_txs[3]->GetTx().GetHash(), low->GetHash());
+    BOOST_CHECK_EQUAL(cluster.m_chunks.size(), 3U);
+    BOOST_CHECK(MiningScore(pool, medium) == OwnFeeRate(pool, medium));
+
+    // A cluster too large to relinearize keeps a valid chunking.
+    const CTransactionRef fanout = MakeTx({}, MAX_CLUSTER_RELINEARIZE_SIZE + 16);
+    pool.addUnchecked(entry.Fee(0).FromTx(fanout));
+    for (size_t i = 0; i < fanout->vout.size(); ++i) {
+        pool.addUnchecked(entry.Fee(1000 * ((i * 7) % 13)).FromTx(MakeTx({COutPoint(fanout->GetHash(), i)})));
+    }
+    clusters.Check(pool.size());
+    BOOST_CHECK_EQUAL(ClusterOf(pool, fanout).m_txs.size(), fanout->vout.size() + 1);
+
+    // A dependency found on reorg merges clusters and puts the parent first.
+    const CTransactionRef reorged = MakeTx({});
+    const CTransactionRef child = MakeTx({COutPoint(reorged->GetHash(), 0)});
+    pool.addUnchecked(entry.Fee(50000).FromTx(child));
+    pool.addUnchecked(entry.Fee(0).FromTx(reorged));
+    BOOST_CHECK(&ClusterOf(pool, reorged) != &ClusterOf(pool, child));
+    pool.UpdateTransactionsFromBlock({reorged->GetHash()});
+    clusters.Check(pool.size());
+    BOOST_CHECK(&ClusterOf(pool, reorged) == &ClusterOf(pool, child));
+    BOOST_CHECK_EQUAL(ClusterOf(pool, child).m_txs.front()->GetTx().GetHash(), reorged->GetHash());
+    BOOST_CHECK(MiningScore(pool, reorged) == MiningScore(pool, child));
+}
+
+BOOST_AUTO_TEST_CASE(cluster_trim_to_size)
+{
+    CTxMemPool pool(/* estimator */ nullptr, /* check_ratio */ 0, /* track_clusters */ true);
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    const CTransactionRef tx1 = MakeTx({});
+    const CTransactionRef tx2 = MakeTx({});
+    pool.addUnchecked(entry.Fee(10000).FromTx(tx1));
+    pool.addUnchecked(entry.Fee(5000).FromTx(tx2));
+
+    pool.TrimToSize(pool.DynamicMemoryUsage()); // should do nothing
+    BOOST_CHECK(pool.exists(tx1->GetHash()));
+    BOOST_CHECK(pool.exists(tx2->GetHash()));
+
+    pool.TrimToSize(pool.DynamicMemoryUsage() * 3 / 4); // should remove the lower-feerate transaction
+    BOOST_CHECK(pool.exists(tx1->GetHash()));
+    BOOST_CHECK(!pool.exists(tx2->GetHash()));
+    pool.GetClusters().Check(pool.size());
+
+    pool.addUnchecked(entry.Fee(5000).FromTx(tx2));
+    const CTransactionRef tx3 = MakeTx({COutPoint(tx2->GetHash(), 0)});
+    pool.addUnchecked(entry.Fee(20000).FromTx(tx3));
+
+    pool.TrimToSize(pool.DynamicMemoryUsage() * 3 / 4); // tx3 should pay for tx2 (CPFP)
+    BOOST_CHECK(!pool.exists(tx1->GetHash()));
+    BOOST_CHECK(pool.exists(tx2->GetHash()));
+    BOOST_CHECK(pool.exists(tx3->GetHash()));
+
+    // The last chunk of a cluster is evicted first, so a low feerate child
+    // goes before its parent.
+    const CTransactionRef tx4 = MakeTx({COutPoint(tx3->GetHash(), 0)});
+    pool.addUnchecked(entry.Fee(0).FromTx(tx4));
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!pool.exists(tx4->GetHash()));
+    BOOST_CHECK(pool.exists(tx3->GetHash()));
+    pool.GetClusters().Check(pool.size());
+
+    pool.TrimToSize(GetVirtualTransactionSize(*tx1)); // nothing fits
+    BOOST_CHECK_EQUAL(pool.size(), 0U);
+    BOOST_CHECK_EQUAL(pool.GetClusters().Size(), 0U);
+
+    const CFeeRate max_fee_rate_removed(25000, GetVirtualTransactionSize(*tx2) + GetVirtualTransactionSize(*tx3));
+    BOOST_CHECK_EQUAL(pool.GetMinFee(1).GetFeePerK(), max_fee_rate_removed.GetFeePerK() + 1000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,13 +2,18 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <clientversion.h>
 #include <consensus/validation.h>
+#include <fs.h>
 #include <key_io.h>
 #include <policy/packages.h>
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
 #include <script/standard.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
 #include <validation.h>
 
@@ -145,4 +150,175 @@ BOOST_FIXTURE_TEST_CASE(package_tests, TestChain100Setup)
     // Check that mempool size hasn't changed.
     BOOST_CHECK_EQUAL(m_node.mempool->size(), initialPoolSize);
 }
+
+BOOST_FIXTURE_TEST_CASE(load_mempool, TestChain100Setup)
+{
+    // Make the first two coinbase outputs spendable.
+    mineBlocks(2);
+    CChainState& chainstate = m_node.chainman->ActiveChainstate();
+    CTxMemPool& mempool = *m_node.mempool;
+    const CScript p2pk = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const CTransactionRef parent = MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 1, coinbaseKey, p2pk, 49 * COIN, /* submit */ false));
+    const CTransactionRef child = MakeTransactionRef(CreateValidMempoolTransaction(parent, 0, 101, coinbaseKey, p2pk, 48 * COIN, /* submit */ false));
+    const CTransactionRef expired = MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[1], 0, 2, coinbaseKey, p2pk, 49 * COIN, /* submit */ false));
+
+    // Write a mempool.dat in which the child comes before its parent.
+    const fs::path path = m_path_root / "mempool.dat";
+    const int64_t now = GetTime();
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        file << uint64_t{1} << uint64_t{3};
+        file << *child << now << int64_t{1000};
+        file << *parent << now << int64_t{0};
+        file << *expired << int64_t{0} << int64_t{0};
+        file << std::map<uint256, CAmount>{} << std::set<uint256>{parent->GetHash()};
+    }
+
+    BOOST_CHECK(LoadMempool(mempool, chainstate, [&](const fs::path&, const char* mode) { return fsbridge::fopen(path, mode); }));
+    LOCK(mempool.cs);
+    BOOST_CHECK_EQUAL(mempool.size(), 2U);
+    BOOST_CHECK(mempool.exists(parent->GetHash()));
+    BOOST_CHECK(!mempool.exists(expired->GetHash()));
+    const auto child_it = mempool.mapTx.find(child->GetHash());
+    BOOST_REQUIRE(child_it != mempool.mapTx.end());
+    BOOST_CHECK_EQUAL(child_it->GetModifiedFee(), child_it->GetFee() + 1000);
+    BOOST_CHECK(mempool.IsUnbroadcastTx(parent->GetHash()));
+}
+
+BOOST_FIXTURE_TEST_CASE(load_mempool_truncated, TestChain100Setup)
+{
+    // Make the first coinbase output spendable.
+    mineBlocks(1);
+    CChainState& chainstate = m_node.chainman->ActiveChainstate();
+    CTxMemPool& mempool = *m_node.mempool;
+    const CScript p2pk = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const CTransactionRef parent = MakeTransactionRef(CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 1, coinbaseKey, p2pk, 49 * COIN, /* submit */ false));
+    const CTransactionRef child = MakeTransactionRef(CreateValidMempoolTransaction(parent, 0, 101, coinbaseKey, p2pk, 48 * COIN, /* submit */ false));
+
+    // Cut the file off in the middle of the child.
+    const int64_t now = GetTime();
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << uint64_t{1} << uint64_t{2};
+    stream << *parent << now << int64_t{500};
+    const size_t parent_end = stream.size();
+    stream << *child << now << int64_t{1000};
+    stream << std::map<uint256, CAmount>{} << std::set<uint256>{};
+    const fs::path path = m_path_root / "mempool.dat";
+    {
+        FILE* file = fsbridge::fopen(path, "wb");
+        BOOST_REQUIRE_EQUAL(fwrite(stream.data(), 1, parent_end + 20, file), parent_end + 20);
+        fclose(file);
+    }
+
+    // The load fails, but keeps the transaction read before the error, along
+    // with its fee delta.
+    BOOST_CHECK(!LoadMempool(mempool, chainstate, [&](const fs::path&, const char* mode) { return fsbridge::fopen(path, mode); }));
+    LOCK(mempool.cs);
+    BOOST_CHECK_EQUAL(mempool.size(), 1U);
+    BOOST_CHECK(!mempool.exists(child->GetHash()));
+    const auto parent_it = mempool.mapTx.find(parent->GetHash());
+    BOOST_REQUIRE(parent_it != mempool.mapTx.end());
+    BOOST_CHECK_EQUAL(parent_it->GetModifiedFee(), parent_it->GetFee() + 500);
+    CAmount child_delta{0};
+    mempool.ApplyDelta(child->GetHash(), child_delta);
+    BOOST_CHECK_EQUAL(child_delta, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(parallel_script_checks, TestChain100Setup)
+{
+    // Make the first two coinbase outputs spendable.
+    mineBlocks(2);
+    CChainState& chainstate = m_node.chainman->ActiveChainstate();
+    CTxMemPool& mempool = *m_node.mempool;
+    FillableSigningProvider keystore;
+    keystore.AddKey(coinbaseKey);
+    const CScript p2wpkh = GetScriptForDestination(WitnessV0KeyHash(coinbaseKey.GetPubKey()));
+    // More inputs than MIN_PARALLEL_MEMPOOL_SCRIPT_CHECKS, so that the scripts
+    // are verified on the script check threads.
+    constexpr uint32_t num_inputs{8};
+
+    // Spend the first num_spent outputs of parent to num_outputs P2WPKH outputs.
+    auto spend = [&](const CTransactionRef& parent, uint32_t num_spent, uint32_t num_outputs) {
+        CMutableTransaction mtx;
+        std::map<COutPoint, Coin> coins;
+        CAmount total{0};
+        for (uint32_t n = 0; n < num_spent; ++n) {
+            mtx.vin.emplace_back(COutPoint(parent->GetHash(), n));
+            coins.emplace(COutPoint(parent->GetHash(), n), Coin(parent->vout[n], 1, parent->IsCoinBase()));
+            total += parent->vout[n].nValue;
+        }
+        mtx.vout.assign(num_outputs, CTxOut((total - 100000) / num_outputs, p2wpkh));
+        std::map<int, std::string> input_errors;
+        BOOST_REQUIRE(SignTransaction(mtx, &keystore, coins, SIGHASH_ALL, input_errors));
+        return mtx;
+    };
+    // Test-accept a transaction, and check that verifying its scripts on the
+    // calling thread only gives the same result.
+    auto test_accept = [&](const CMutableTransaction& mtx) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+        const CTransactionRef tx = MakeTransactionRef(mtx);
+        const MempoolAcceptResult result = AcceptToMemoryPool(chainstate, mempool, tx, /* bypass_limits */ false, /* test_accept */ true);
+        g_parallel_script_checks = false;
+        const MempoolAcceptResult serial = AcceptToMemoryPool(chainstate, mempool, tx, /* bypass_limits */ false, /* test_accept */ true);
+        g_parallel_script_checks = true;
+        BOOST_CHECK(result.m_result_type == serial.m_result_type);
+        BOOST_CHECK(result.m_state.GetResult() == serial.m_state.GetResult());
+        BOOST_CHECK_EQUAL(result.m_state.GetRejectReason(), serial.m_state.GetRejectReason());
+        return result;
+    };
+
+    const CTransactionRef split = MakeTransactionRef(spend(m_coinbase_txns[0], 1, num_inputs));
+    const CMutableTransaction valid = spend(split, num_inputs, 1);
+    // Invalidate the signature of one input, keeping the others valid.
+    CMutableTransaction bad_signature = valid;
+    bad_signature.vin[num_inputs / 2].scriptWitness.stack[0][10] ^= 1;
+    CMutableTransaction stripped = valid;
+    for (CTxIn& txin : stripped.vin) txin.scriptWitness.SetNull();
+
+    LOCK(cs_main);
+    BOOST_REQUIRE(AcceptToMemoryPool(chainstate, mempool, split, /* bypass_limits */ false).m_result_type == MempoolAcceptResult::ResultType::VALID);
+
+    BOOST_CHECK(test_accept(valid).m_result_type == MempoolAcceptResult::ResultType::VALID);
+
+    // The failure is found through the queue, and the reject reason through
+    // the serial checks. Witness failures pass the mandatory flags, which do
+    // not include SCRIPT_VERIFY_WITNESS, so they are not standard.
+    const MempoolAcceptResult bad_result = test_accept(bad_signature);
+    BOOST_CHECK(bad_result.m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK(bad_result.m_state.GetResult() == TxValidationResult::TX_NOT_STANDARD);
+    BOOST_CHECK(bad_result.m_state.GetRejectReason().rfind("non-mandatory-script-verify-flag", 0) == 0);
+
+    // Without the witness, the scripts only pass without the witness flags,
+    // which the fallback checks to report the transaction as stripped.
+    const MempoolAcceptResult stripped_result = test_accept(stripped);
+    BOOST_CHECK(stripped_result.m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK(stripped_result.m_state.GetResult() == TxValidationResult::TX_WITNESS_STRIPPED);
+
+    // Packages queue the scripts of all their transactions at once.
+    const CTransactionRef package_parent = MakeTransactionRef(spend(m_coinbase_txns[1], 1, num_inputs));
+    const CTransactionRef package_child = MakeTransactionRef(spend(package_parent, num_inputs, 1));
+    CMutableTransaction bad_child_mtx{*package_child};
+    bad_child_mtx.vin[0].scriptWitness.stack[0][10] ^= 1;
+    const CTransactionRef bad_child = MakeTransactionRef(bad_child_mtx);
+
+    const PackageMempoolAcceptResult package_result = ProcessNewPackage(chainstate, mempool, {package_parent, package_child}, /* test_accept */ true);
+    BOOST_CHECK(package_result.m_state.IsValid());
+    BOOST_CHECK_EQUAL(package_result.m_tx_results.size(), 2U);
+    for (const auto& [wtxid, result] : package_result.m_tx_results) {
+        BOOST_CHECK(result.m_result_type == MempoolAcceptResult::ResultType::VALID);
+    }
+
+    // If any script fails, the transactions are checked one at a time to
+    // find which one failed and why.
+    const PackageMempoolAcceptResult bad_package_result = ProcessNewPackage(chainstate, mempool, {package_parent, bad_child}, /* test_accept */ true);
+    BOOST_CHECK(bad_package_result.m_state.GetResult() == PackageValidationResult::PCKG_TX);
+    BOOST_CHECK(bad_package_result.m_tx_results.at(package_parent->GetWitnessHash()).m_result_type == MempoolAcceptResult::ResultType::VALID);
+    const MempoolAcceptResult& bad_child_result = bad_package_result.m_tx_results.at(bad_child->GetWitnessHash());
+    BOOST_CHECK(bad_child_result.m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK(bad_child_result.m_state.GetResult() == TxValidationResult::TX_NOT_STANDARD);
+    BOOST_CHECK_EQUAL(bad_child_result.m_state.GetRejectReason(), bad_result.m_state.GetRejectReason());
+
+    // Nothing was added by test-accepting.
+    BOOST_CHECK_EQUAL(mempool.size(), 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -374,4 +374,58 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(script_execution_cache_persist, TestChain100Setup)
+{
+    // Spend a mature coinbase output.
+    CMutableTransaction spend_tx;
+    spend_tx.nVersion = 1;
+    spend_tx.vin.resize(1);
+    spend_tx.vin[0].prevout = COutPoint(m_coinbase_txns[0]->GetHash(), 0);
+    spend_tx.vout.resize(1);
+    spend_tx.vout[0].nValue = 11 * CENT;
+    spend_tx.vout[0].scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    {
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(m_coinbase_txns[0]->vout[0].scriptPubKey, spend_tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spend_tx.vin[0].scriptSig << vchSig;
+    }
+    const CTransaction tx{spend_tx};
+    const fs::path path{m_path_root / "scriptcache.dat"};
+    const unsigned int flags{SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG};
+
+    LOCK(cs_main);
+    CCoinsViewCache& coins_tip = m_node.chainman->ActiveChainstate().CoinsTip();
+    // Number of script checks left to run, i.e. 0 if the cache has the transaction.
+    const auto count_checks = [&] {
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        std::vector<CScriptCheck> scriptchecks;
+        BOOST_CHECK(CheckInputScripts(tx, state, &coins_tip, flags, true, true, txdata, &scriptchecks));
+        return scriptchecks.size();
+    };
+
+    InitScriptExecutionCache();
+    {
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        BOOST_CHECK(CheckInputScripts(tx, state, &coins_tip, flags, true, true, txdata, nullptr));
+    }
+    BOOST_CHECK_EQUAL(count_checks(), 0U);
+    BOOST_CHECK(DumpScriptExecutionCache(path));
+
+    // After a restart the cache is salted differently, so the entry is lost...
+    InitScriptExecutionCache();
+    BOOST_CHECK_EQUAL(count_checks(), 1U);
+
+    // ...unless the saved salt and entries are loaded.
+    BOOST_CHECK(LoadScriptExecutionCache(path));
+    BOOST_CHECK_EQUAL(count_checks(), 0U);
+
+    // A file that can't be read leaves the cache alone.
+    BOOST_CHECK(!LoadScriptExecutionCache(m_path_root / "missing.dat"));
+    BOOST_CHECK_EQUAL(count_checks(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
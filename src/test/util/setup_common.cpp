@@ -10,6 +10,8 @@
 #include <consensus/consensus.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
+#include <crypto/chacha20.h>
+#include <crypto/poly1305.h>
 #include <crypto/sha256.h>
 #include <init.h>
 #include <interfaces/chain.h>
@@ -108,6 +110,8 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName, const std::ve
     AppInitParameterInteraction(*m_node.args);
     LogInstance().StartLogging();
     SHA256AutoDetect();
+    ChaCha20AutoDetect();
+    Poly1305AutoDetect();
     ECC_Start();
     SetupEnvironment();
     SetupNetworking();
@@ -144,7 +148,7 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     pblocktree.reset(new CBlockTreeDB(1 << 20, true));
 
     m_node.fee_estimator = std::make_unique<CBlockPolicyEstimator>();
-    m_node.mempool = std::make_unique<CTxMemPool>(m_node.fee_estimator.get(), 1);
+    m_node.mempool = std::make_unique<CTxMemPool>(m_node.fee_estimator.get(), 1, m_node.args->GetBoolArg("-mempoolclusters", DEFAULT_MEMPOOL_CLUSTERS));
 
     m_node.chainman = std::make_unique<ChainstateManager>();
 
@@ -2,12 +2,15 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 //
+#include <chainparams.h>
 #include <random.h>
 #include <uint256.h>
 #include <consensus/validation.h>
+#include <miner.h>
 #include <sync.h>
 #include <test/util/setup_common.h>
 #include <validation.h>
+#include <validationinterface.h>
 
 #include <vector>
 
@@ -72,4 +75,70 @@ BOOST_AUTO_TEST_CASE(validation_chainstate_resize_caches)
     WITH_LOCK(::cs_main, manager.Unload());
 }
 
+//! Test that a background chainstate without script check worker threads
+//! still verifies the scripts of the blocks it connects.
+//!
+BOOST_FIXTURE_TEST_CASE(validation_chainstate_background_script_checks, TestChain100Setup)
+{
+    CChainState& chainstate = m_node.chainman->ActiveChainstate();
+    const CScript script_pub_key = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    auto test_block_validity = [&](const CMutableTransaction& tx, BlockValidationState& state) {
+        LOCK(cs_main);
+        CTxMemPool empty_pool;
+        CBlock block = BlockAssembler(chainstate, empty_pool, Params()).CreateNewBlock(script_pub_key)->block;
+        block.vtx.push_back(MakeTransactionRef(tx));
+        RegenerateCommitments(block, *m_node.chainman);
+        return TestBlockValidity(state, Params(), chainstate, block, chainstate.m_chain.Tip(), /* fCheckPOW */ false, /* fCheckMerkleRoot */ true);
+    };
+
+    const CMutableTransaction valid = CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 0, coinbaseKey, script_pub_key, 49 * COIN, /* submit */ false);
+    // Invalidate the signature: the script sig is a push of the DER encoded
+    // signature, whose R value starts at offset 5.
+    CMutableTransaction bad_signature = valid;
+    bad_signature.vin[0].scriptSig[10] ^= 1;
+
+    // The background script check queue has no worker threads in this test.
+    WITH_LOCK(cs_main, chainstate.m_validates_in_background = true);
+    BOOST_REQUIRE(g_parallel_script_checks);
+
+    BlockValidationState state;
+    BOOST_CHECK(test_block_validity(valid, state));
+    BOOST_CHECK(state.IsValid());
+
+    state = BlockValidationState();
+    BOOST_CHECK(!test_block_validity(bad_signature, state));
+    BOOST_CHECK(state.GetResult() == BlockValidationResult::BLOCK_CONSENSUS);
+    BOOST_CHECK(state.GetRejectReason().rfind("mandatory-script-verify-flag-failed", 0) == 0);
+
+    WITH_LOCK(cs_main, chainstate.m_validates_in_background = false);
+}
+
+//! Test that the blocks connected by a background chainstate do not update
+//! the node's best block or its mempool.
+//!
+BOOST_FIXTURE_TEST_CASE(validation_chainstate_background_tip, TestChain100Setup)
+{
+    CChainState& chainstate = m_node.chainman->ActiveChainstate();
+    const CScript script_pub_key = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // Keep a transaction in the mempool that the block confirms.
+    const CMutableTransaction tx = CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 0, coinbaseKey, script_pub_key, 49 * COIN, /* submit */ true);
+    BOOST_REQUIRE(m_node.mempool->exists(tx.GetHash()));
+
+    const uint256 best_block = WITH_LOCK(g_best_block_mutex, return g_best_block);
+    const unsigned int transactions_updated = m_node.mempool->GetTransactionsUpdated();
+
+    WITH_LOCK(cs_main, chainstate.m_validates_in_background = true);
+    const CBlock block = CreateAndProcessBlock({tx}, script_pub_key);
+    SyncWithValidationInterfaceQueue();
+
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return chainstate.m_chain.Tip()->GetBlockHash()), block.GetHash());
+    BOOST_CHECK_EQUAL(WITH_LOCK(g_best_block_mutex, return g_best_block), best_block);
+    BOOST_CHECK_EQUAL(m_node.mempool->GetTransactionsUpdated(), transactions_updated);
+    BOOST_CHECK(m_node.mempool->exists(tx.GetHash()));
+
+    WITH_LOCK(cs_main, chainstate.m_validates_in_background = false);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -166,13 +166,22 @@ BOOST_AUTO_TEST_CASE(chainstatemanager_rebalance_caches)
     BOOST_CHECK_CLOSE(c1.m_coinsdb_cache_size_bytes, max_cache * 0.05, 1);
     BOOST_CHECK_CLOSE(c2.m_coinstip_cache_size_bytes, max_cache * 0.95, 1);
     BOOST_CHECK_CLOSE(c2.m_coinsdb_cache_size_bytes, max_cache * 0.95, 1);
+
+    // The share of the background chainstate is configurable.
+    manager.m_background_cache_percent = 20;
+    WITH_LOCK(::cs_main, manager.MaybeRebalanceCaches());
+
+    BOOST_CHECK_CLOSE(c1.m_coinstip_cache_size_bytes, max_cache * 0.20, 1);
+    BOOST_CHECK_CLOSE(c1.m_coinsdb_cache_size_bytes, max_cache * 0.20, 1);
+    BOOST_CHECK_CLOSE(c2.m_coinstip_cache_size_bytes, max_cache * 0.80, 1);
+    BOOST_CHECK_CLOSE(c2.m_coinsdb_cache_size_bytes, max_cache * 0.80, 1);
 }
 
 auto NoMalleation = [](CAutoFile& file, SnapshotMetadata& meta){};
 
 template<typename F = decltype(NoMalleation)>
 static bool
-CreateAndActivateUTXOSnapshot(NodeContext& node, const fs::path root, F malleation = NoMalleation)
+CreateAndActivateUTXOSnapshot(NodeContext& node, const fs::path root, F malleation = NoMalleation, SnapshotLoadStats* stats = nullptr)
 {
     // Write out a snapshot to the test's tempdir.
     //
@@ -195,7 +204,7 @@ CreateAndActivateUTXOSnapshot(NodeContext& node, const fs::path root, F malleati
 
     malleation(auto_infile, metadata);
 
-    return node.chainman->ActivateSnapshot(auto_infile, metadata, /*in_memory*/ true);
+    return node.chainman->ActivateSnapshot(auto_infile, metadata, /*in_memory*/ true, stats);
 }
 
 //! Test basic snapshot activation.
@@ -268,7 +277,10 @@ BOOST_FIXTURE_TEST_CASE(chainstatemanager_activate_snapshot, TestChain100Setup)
             metadata.m_base_blockhash = uint256::ONE;
     }));
 
-    BOOST_REQUIRE(CreateAndActivateUTXOSnapshot(m_node, m_path_root));
+    SnapshotLoadStats load_stats;
+    BOOST_REQUIRE(CreateAndActivateUTXOSnapshot(m_node, m_path_root, NoMalleation, &load_stats));
+    BOOST_CHECK_EQUAL(load_stats.coins_loaded, initial_total_coins);
+    BOOST_CHECK(load_stats.peak_cache_usage > 0);
 
     // Ensure our active chain is the snapshot chainstate.
     BOOST_CHECK(!chainman.ActiveChainstate().m_from_snapshot_blockhash->IsNull());
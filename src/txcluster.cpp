@@ -0,0 +1,531 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <txcluster.h>
+
+#include <memusage.h>
+#include <txmempool.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+
+namespace {
+
+/** Multiply a signed 64-bit value by a value in [0, 2^32), returning the
+ *  96-bit product as (high 64 bits, low 32 bits), which compares correctly as
+ *  a pair. */
+std::pair<int64_t, uint32_t> MulFrac(int64_t a, int64_t b)
+{
+    const int64_t high = (a >> 32) * b;
+    const uint64_t low = uint64_t{uint32_t(a)} * uint64_t(b);
+    return {high + int64_t(low >> 32), uint32_t(low)};
+}
+
+/** Extend the chunking of a prefix of txs to all of txs. */
+void ExtendChunks(std::vector<TxClusterChunk>& chunks, const std::vector<const CTxMemPoolEntry*>& txs)
+{
+    for (size_t i = chunks.empty() ? 0 : chunks.back().end; i < txs.size(); ++i) {
+        TxClusterChunk chunk{txs[i]->GetModifiedFee(), int64_t(txs[i]->GetTxSize()), i + 1};
+        // Absorb preceding chunks with a lower feerate, keeping the chunk
+        // feerates non-increasing.
+        while (!chunks.empty() && CompareFeeFrac(chunk.fee, chunk.size, chunks.back().fee, chunks.back().size) > 0) {
+            chunk.fee += chunks.back().fee;
+            chunk.size += chunks.back().size;
+            chunks.pop_back();
+        }
+        chunks.push_back(chunk);
+    }
+}
+
+/** Whether the feerate diagram of chunking a is nowhere below that of chunking
+ *  b. Both must cover the same transactions. As diagram a is concave, it is
+ *  enough to compare at the vertices of diagram b. */
+bool DiagramAtLeast(const std::vector<TxClusterChunk>& a, const std::vector<TxClusterChunk>& b)
+{
+    size_t a_pos{0};
+    CAmount a_fee{0}, b_fee{0};
+    int64_t a_size{0}, b_size{0};
+    for (const TxClusterChunk& chunk : b) {
+        b_fee += chunk.fee;
+        b_size += chunk.size;
+        while (a_pos < a.size() && a_size + a[a_pos].size < b_size) {
+            a_fee += a[a_pos].fee;
+            a_size += a[a_pos].size;
+            ++a_pos;
+        }
+        assert(a_pos < a.size());
+        // The point (b_size, b_fee) must not lie above the segment of a
+        // starting at (a_size, a_fee).
+        if (CompareFeeFrac(b_fee - a_fee, b_size - a_size, a[a_pos].fee, a[a_pos].size) > 0) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int CompareFeeFrac(CAmount fee_a, int64_t size_a, CAmount fee_b, int64_t size_b)
+{
+    const auto lhs = MulFrac(fee_a, size_b);
+    const auto rhs = MulFrac(fee_b, size_a);
+    return lhs < rhs ? -1 : (rhs < lhs ? 1 : 0);
+}
+
+bool TxClusterSet::WorstChunkCompare::operator()(const TxCluster* a, const TxCluster* b) const
+{
+    const TxClusterChunk& chunk_a = a->m_chunks.back();
+    const TxClusterChunk& chunk_b = b->m_chunks.back();
+    const int cmp = CompareFeeFrac(chunk_a.fee, chunk_a.size, chunk_b.fee, chunk_b.size);
+    if (cmp != 0) return cmp < 0;
+    return a->m_id < b->m_id;
+}
+
+TxClusterSet::TxPosition& TxClusterSet::PositionOf(const CTxMemPoolEntry& entry)
+{
+    auto it = m_positions.find(&entry);
+    assert(it != m_positions.end());
+    return it->second;
+}
+
+const TxClusterSet::TxPosition& TxClusterSet::PositionOf(const CTxMemPoolEntry& entry) const
+{
+    auto it = m_positions.find(&entry);
+    assert(it != m_positions.end());
+    return it->second;
+}
+
+void TxClusterSet::Reindex(TxCluster& cluster, size_t begin)
+{
+    for (size_t i = begin; i < cluster.m_txs.size(); ++i) {
+        m_positions[cluster.m_txs[i]] = {&cluster, i};
+    }
+}
+
+void TxClusterSet::SortTopologically(TxCluster& cluster)
+{
+    const size_t n = cluster.m_txs.size();
+    std::vector<bool> done(n, false);
+    std::vector<size_t> stack;
+    std::vector<const CTxMemPoolEntry*> order;
+    order.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        stack.push_back(i);
+        while (!stack.empty()) {
+            const size_t pos = stack.back();
+            if (done[pos]) {
+                stack.pop_back();
+                continue;
+            }
+            bool ready{true};
+            for (const CTxMemPoolEntry& parent : cluster.m_txs[pos]->GetMemPoolParentsConst()) {
+                const size_t parent_index = PositionOf(parent).index;
+                if (!done[parent_index]) {
+                    stack.push_back(parent_index);
+                    ready = false;
+                }
+            }
+            if (ready) {
+                done[pos] = true;
+                order.push_back(cluster.m_txs[pos]);
+                stack.pop_back();
+            }
+        }
+    }
+    cluster.m_txs = std::move(order);
+    Reindex(cluster);
+}
+
+size_t TxClusterSet::ClusterUsage(const TxCluster& cluster)
+{
+    return memusage::MallocUsage(sizeof(TxCluster)) +
+           memusage::MallocUsage(sizeof(memusage::stl_tree_node<std::pair<const uint64_t, std::unique_ptr<TxCluster>>>)) +
+           memusage::MallocUsage(sizeof(memusage::stl_tree_node<const TxCluster*>)) +
+           memusage::DynamicUsage(cluster.m_txs) + memusage::DynamicUsage(cluster.m_chunks);
+}
+
+TxCluster* TxClusterSet::NewCluster()
+{
+    auto cluster = std::make_unique<TxCluster>(m_next_id++);
+    TxCluster* ret = cluster.get();
+    m_clusters.emplace(ret->m_id, std::move(cluster));
+    ret->m_dirty = true;
+    m_dirty.push_back(ret);
+    return ret;
+}
+
+void TxClusterSet::DeleteCluster(TxCluster* cluster)
+{
+    if (cluster->m_dirty) {
+        m_dirty.erase(std::find(m_dirty.begin(), m_dirty.end(), cluster));
+    } else {
+        m_by_worst_chunk.erase(cluster);
+        m_cached_usage -= ClusterUsage(*cluster);
+    }
+    m_clusters.erase(cluster->m_id);
+}
+
+void TxClusterSet::MarkDirty(TxCluster* cluster)
+{
+    if (cluster->m_dirty) return;
+    m_by_worst_chunk.erase(cluster);
+    m_cached_usage -= ClusterUsage(*cluster);
+    cluster->m_dirty = true;
+    m_dirty.push_back(cluster);
+}
+
+void TxClusterSet::Merge(TxCluster* into, TxCluster* from)
+{
+    std::vector<const CTxMemPoolEntry*> txs;
+    txs.reserve(into->m_txs.size() + from->m_txs.size());
+    size_t unchanged;
+    if (!into->m_dirty && !from->m_dirty) {
+        // Interleave the chunks of both linearizations by feerate. The
+        // clusters are independent, so any such interleaving is topological
+        // and its diagram is at least as good as either input's.
+        size_t i{0}, j{0};
+        unchanged = into->m_txs.size();
+        while (i < into->m_chunks.size() || j < from->m_chunks.size()) {
+            const bool take_into = j == from->m_chunks.size() ||
+                (i < into->m_chunks.size() && CompareFeeFrac(into->m_chunks[i].fee, into->m_chunks[i].size, from->m_chunks[j].fee, from->m_chunks[j].size) >= 0);
+            if (!take_into) unchanged = std::min(unchanged, txs.size());
+            const TxCluster* source = take_into ? into : from;
+            const size_t chunk = take_into ? i++ : j++;
+            txs.insert(txs.end(), source->m_txs.begin() + source->ChunkBegin(chunk), source->m_txs.begin() + source->m_chunks[chunk].end);
+        }
+    } else {
+        // Holes only occur after the unchanged prefix.
+        unchanged = into->m_unchanged;
+        for (const TxCluster* source : {into, from}) {
+            std::copy_if(source->m_txs.begin(), source->m_txs.end(), std::back_inserter(txs), [](const CTxMemPoolEntry* tx) { return tx != nullptr; });
+        }
+    }
+    MarkDirty(into);
+    into->m_split |= from->m_split;
+    into->m_reorder |= from->m_reorder;
+    into->m_unchanged = unchanged;
+    into->m_txs = std::move(txs);
+    Reindex(*into, unchanged);
+    DeleteCluster(from);
+}
+
+void TxClusterSet::AddTx(const CTxMemPoolEntry& entry)
+{
+    assert(m_positions.count(&entry) == 0);
+    TxCluster* cluster{nullptr};
+    for (const CTxMemPoolEntry& parent : entry.GetMemPoolParentsConst()) {
+        TxCluster* parent_cluster = PositionOf(parent).cluster;
+        if (cluster == nullptr) {
+            cluster = parent_cluster;
+        } else if (cluster != parent_cluster) {
+            if (parent_cluster->m_txs.size() > cluster->m_txs.size()) std::swap(cluster, parent_cluster);
+            Merge(cluster, parent_cluster);
+        }
+    }
+    if (cluster == nullptr) cluster = NewCluster();
+    MarkDirty(cluster);
+    m_positions.emplace(&entry, TxPosition{cluster, cluster->m_txs.size()});
+    cluster->m_txs.push_back(&entry);
+}
+
+void TxClusterSet::AddDependency(const CTxMemPoolEntry& parent, const CTxMemPoolEntry& child)
+{
+    TxCluster* cluster = PositionOf(parent).cluster;
+    TxCluster* other = PositionOf(child).cluster;
+    if (cluster != other) {
+        if (other->m_txs.size() > cluster->m_txs.size()) std::swap(cluster, other);
+        Merge(cluster, other);
+    }
+    MarkDirty(cluster);
+    if (PositionOf(parent).index > PositionOf(child).index) cluster->m_reorder = true;
+}
+
+void TxClusterSet::RemoveTxs(const std::vector<const CTxMemPoolEntry*>& entries)
+{
+    for (const CTxMemPoolEntry* entry : entries) {
+        const auto it = m_positions.find(entry);
+        assert(it != m_positions.end());
+        const auto [cluster, index] = it->second;
+        assert(cluster->m_txs[index] == entry);
+        MarkDirty(cluster);
+        cluster->m_txs[index] = nullptr;
+        cluster->m_removed = true;
+        cluster->m_unchanged = std::min(cluster->m_unchanged, index);
+        m_positions.erase(it);
+    }
+    // Removing a set of transactions can only disconnect a cluster if they
+    // were linked to at least two of its remaining transactions. That is
+    // rarely the case when evicting a final chunk or mining a first one, so
+    // most removals don't need to search for connected components.
+    std::vector<std::pair<TxCluster*, const CTxMemPoolEntry*>> boundary;
+    for (const CTxMemPoolEntry* entry : entries) {
+        for (const auto* links : {&entry->GetMemPoolParentsConst(), &entry->GetMemPoolChildrenConst()}) {
+            for (const CTxMemPoolEntry& linked : *links) {
+                const auto it = m_positions.find(&linked);
+                if (it != m_positions.end()) boundary.emplace_back(it->second.cluster, &linked);
+            }
+        }
+    }
+    std::sort(boundary.begin(), boundary.end());
+    boundary.erase(std::unique(boundary.begin(), boundary.end()), boundary.end());
+    for (size_t i = 1; i < boundary.size(); ++i) {
+        if (boundary[i].first == boundary[i - 1].first) boundary[i].first->m_split = true;
+    }
+}
+
+void TxClusterSet::FeeChanged(const CTxMemPoolEntry& entry)
+{
+    const TxPosition& position = PositionOf(entry);
+    MarkDirty(position.cluster);
+    position.cluster->m_unchanged = std::min(position.cluster->m_unchanged, position.index);
+}
+
+void TxClusterSet::Split(TxCluster* cluster)
+{
+    const size_t n = cluster->m_txs.size();
+    std::vector<size_t> component(n, n);
+    std::vector<size_t> todo;
+    size_t components{0};
+    for (size_t i = 0; i < n; ++i) {
+        if (component[i] != n) continue;
+        component[i] = components;
+        todo.push_back(i);
+        while (!todo.empty()) {
+            const CTxMemPoolEntry* tx = cluster->m_txs[todo.back()];
+            todo.pop_back();
+            for (const auto* links : {&tx->GetMemPoolParentsConst(), &tx->GetMemPoolChildrenConst()}) {
+                for (const CTxMemPoolEntry& linked : *links) {
+                    const size_t linked_index = PositionOf(linked).index;
+                    if (component[linked_index] == n) {
+                        component[linked_index] = components;
+                        todo.push_back(linked_index);
+                    }
+                }
+            }
+        }
+        ++components;
+    }
+    if (components == 1) return;
+
+    // The first component stays in this cluster; the others move to new
+    // clusters, keeping their relative order.
+    size_t unchanged{0};
+    while (component[unchanged] == 0) ++unchanged;
+    cluster->m_unchanged = std::min(cluster->m_unchanged, unchanged);
+    std::vector<TxCluster*> clusters{cluster};
+    for (size_t c = 1; c < components; ++c) {
+        clusters.push_back(NewCluster());
+        clusters.back()->m_reorder = cluster->m_reorder;
+    }
+    std::vector<const CTxMemPoolEntry*> txs = std::move(cluster->m_txs);
+    cluster->m_txs.clear();
+    for (size_t i = 0; i < n; ++i) {
+        clusters[component[i]]->m_txs.push_back(txs[i]);
+    }
+    Reindex(*cluster, cluster->m_unchanged);
+    for (size_t c = 1; c < components; ++c) {
+        Reindex(*clusters[c]);
+    }
+}
+
+void TxClusterSet::Rechunk(TxCluster& cluster)
+{
+    // Chunks that end within the unchanged prefix were formed from that
+    // prefix alone, so chunking can resume after the last of them.
+    std::vector<TxClusterChunk>& chunks = cluster.m_chunks;
+    while (!chunks.empty() && chunks.back().end > cluster.m_unchanged) chunks.pop_back();
+    ExtendChunks(chunks, cluster.m_txs);
+}
+
+void TxClusterSet::Relinearize(TxCluster& cluster)
+{
+    const size_t n = cluster.m_txs.size();
+    const bool changed{cluster.m_unchanged < n};
+    Rechunk(cluster);
+    if (changed && n > 1 && n <= MAX_CLUSTER_RELINEARIZE_SIZE) {
+        // Repeatedly pick the remaining transaction whose remaining ancestors
+        // have the highest combined feerate, and append those ancestors.
+        std::vector<uint64_t> ancestors(n), descendants(n, 0);
+        std::vector<CAmount> fee(n), anc_fee(n, 0);
+        std::vector<int64_t> size(n), anc_size(n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            fee[i] = cluster.m_txs[i]->GetModifiedFee();
+            size[i] = cluster.m_txs[i]->GetTxSize();
+            ancestors[i] = uint64_t{1} << i;
+            for (const CTxMemPoolEntry& parent : cluster.m_txs[i]->GetMemPoolParentsConst()) {
+                ancestors[i] |= ancestors[PositionOf(parent).index];
+            }
+            for (size_t j = 0; j < n; ++j) {
+                if ((ancestors[i] >> j) & 1) {
+                    descendants[j] |= uint64_t{1} << i;
+                    anc_fee[i] += fee[j];
+                    anc_size[i] += size[j];
+                }
+            }
+        }
+        std::vector<const CTxMemPoolEntry*> txs;
+        txs.reserve(n);
+        uint64_t remaining = n == 64 ? ~uint64_t{0} : (uint64_t{1} << n) - 1;
+        while (remaining) {
+            size_t best{n};
+            for (size_t i = 0; i < n; ++i) {
+                if (!((remaining >> i) & 1)) continue;
+                if (best == n) {
+                    best = i;
+                    continue;
+                }
+                const int cmp = CompareFeeFrac(anc_fee[i], anc_size[i], anc_fee[best], anc_size[best]);
+                if (cmp > 0 || (cmp == 0 && anc_size[i] < anc_size[best])) best = i;
+            }
+            const uint64_t selected = ancestors[best] & remaining;
+            for (size_t t = 0; t < n; ++t) {
+                if (!((selected >> t) & 1)) continue;
+                txs.push_back(cluster.m_txs[t]);
+                for (size_t d = 0; d < n; ++d) {
+                    if ((descendants[t] & remaining) >> d & 1) {
+                        anc_fee[d] -= fee[t];
+                        anc_size[d] -= size[t];
+                    }
+                }
+            }
+            remaining &= ~selected;
+        }
+        std::vector<TxClusterChunk> new_chunks;
+        ExtendChunks(new_chunks, txs);
+        if (DiagramAtLeast(new_chunks, cluster.m_chunks) && !DiagramAtLeast(cluster.m_chunks, new_chunks)) {
+            cluster.m_txs = std::move(txs);
+            cluster.m_chunks = std::move(new_chunks);
+            Reindex(cluster);
+        }
+    }
+}
+
+void TxClusterSet::Update()
+{
+    while (!m_dirty.empty()) {
+        TxCluster* cluster = m_dirty.back();
+        m_dirty.pop_back();
+        if (cluster->m_removed) {
+            // Holes only occur after the unchanged prefix.
+            const auto first_changed = cluster->m_txs.begin() + cluster->m_unchanged;
+            cluster->m_txs.erase(std::remove(first_changed, cluster->m_txs.end(), nullptr), cluster->m_txs.end());
+            if (cluster->m_txs.empty()) {
+                m_clusters.erase(cluster->m_id);
+                continue;
+            }
+            Reindex(*cluster, cluster->m_unchanged);
+        }
+        if (cluster->m_split) Split(cluster);
+        if (cluster->m_reorder) {
+            SortTopologically(*cluster);
+            cluster->m_unchanged = 0;
+        }
+        Relinearize(*cluster);
+        cluster->m_dirty = cluster->m_removed = cluster->m_split = cluster->m_reorder = false;
+        cluster->m_unchanged = cluster->m_txs.size();
+        m_by_worst_chunk.insert(cluster);
+        m_cached_usage += ClusterUsage(*cluster);
+    }
+}
+
+void TxClusterSet::Clear()
+{
+    m_clusters.clear();
+    m_positions.clear();
+    m_by_worst_chunk.clear();
+    m_dirty.clear();
+    m_cached_usage = 0;
+}
+
+const TxClusterChunk& TxClusterSet::GetChunk(const CTxMemPoolEntry& entry) const
+{
+    const auto [cluster, index] = PositionOf(entry);
+    assert(!cluster->m_dirty);
+    auto it = std::upper_bound(cluster->m_chunks.begin(), cluster->m_chunks.end(), index,
+        [](size_t index, const TxClusterChunk& chunk) { return index < chunk.end; });
+    assert(it != cluster->m_chunks.end());
+    return *it;
+}
+
+const TxCluster* TxClusterSet::GetCluster(const CTxMemPoolEntry& entry) const
+{
+    const auto it = m_positions.find(&entry);
+    return it == m_positions.end() ? nullptr : it->second.cluster;
+}
+
+size_t TxClusterSet::DynamicMemoryUsage() const
+{
+    return m_cached_usage + memusage::DynamicUsage(m_positions);
+}
+
+const TxCluster* TxClusterSet::GetWorstCluster() const
+{
+    assert(m_dirty.empty());
+    return m_by_worst_chunk.empty() ? nullptr : *m_by_worst_chunk.begin();
+}
+
+void TxClusterSet::Check(size_t tx_count) const
+{
+    assert(m_dirty.empty());
+    assert(m_by_worst_chunk.size() == m_clusters.size());
+    size_t check_count{0};
+    size_t check_usage{0};
+    for (const auto& [id, cluster] : m_clusters) {
+        assert(cluster->m_id == id && !cluster->m_dirty);
+        assert(!cluster->m_txs.empty());
+        assert(m_by_worst_chunk.count(cluster.get()));
+        check_count += cluster->m_txs.size();
+        check_usage += ClusterUsage(*cluster);
+        for (size_t i = 0; i < cluster->m_txs.size(); ++i) {
+            const CTxMemPoolEntry* tx = cluster->m_txs[i];
+            assert(PositionOf(*tx).cluster == cluster.get() && PositionOf(*tx).index == i);
+            for (const CTxMemPoolEntry& parent : tx->GetMemPoolParentsConst()) {
+                assert(PositionOf(parent).cluster == cluster.get() && PositionOf(parent).index < i);
+            }
+            for (const CTxMemPoolEntry& child : tx->GetMemPoolChildrenConst()) {
+                assert(PositionOf(child).cluster == cluster.get() && PositionOf(child).index > i);
+            }
+        }
+        // The chunks must partition the linearization with non-increasing
+        // feerates.
+        size_t begin{0};
+        for (size_t c = 0; c < cluster->m_chunks.size(); ++c) {
+            const TxClusterChunk& chunk = cluster->m_chunks[c];
+            assert(chunk.end > begin);
+            CAmount fee{0};
+            int64_t size{0};
+            for (size_t i = begin; i < chunk.end; ++i) {
+                fee += cluster->m_txs[i]->GetModifiedFee();
+                size += cluster->m_txs[i]->GetTxSize();
+            }
+            assert(fee == chunk.fee && size == chunk.size);
+            if (c > 0) assert(CompareFeeFrac(chunk.fee, chunk.size, cluster->m_chunks[c - 1].fee, cluster->m_chunks[c - 1].size) <= 0);
+            begin = chunk.end;
+        }
+        assert(begin == cluster->m_txs.size());
+        // Clusters must be connected.
+        std::vector<bool> seen(cluster->m_txs.size(), false);
+        std::vector<const CTxMemPoolEntry*> todo{cluster->m_txs.front()};
+        seen[0] = true;
+        size_t reached{1};
+        while (!todo.empty()) {
+            const CTxMemPoolEntry* tx = todo.back();
+            todo.pop_back();
+            for (const auto* links : {&tx->GetMemPoolParentsConst(), &tx->GetMemPoolChildrenConst()}) {
+                for (const CTxMemPoolEntry& linked : *links) {
+                    const size_t linked_index = PositionOf(linked).index;
+                    if (!seen[linked_index]) {
+                        seen[linked_index] = true;
+                        ++reached;
+                        todo.push_back(&linked);
+                    }
+                }
+            }
+        }
+        assert(reached == cluster->m_txs.size());
+    }
+    assert(check_count == tx_count);
+    assert(m_positions.size() == tx_count);
+    assert(check_usage == m_cached_usage);
+}
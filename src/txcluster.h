@@ -0,0 +1,167 @@
+// Copyright (c) 2021 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXCLUSTER_H
+#define BITCOIN_TXCLUSTER_H
+
+#include <amount.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class CTxMemPoolEntry;
+
+/** Default for -mempoolclusters, whether the mempool maintains cluster linearizations */
+static constexpr bool DEFAULT_MEMPOOL_CLUSTERS{false};
+
+/** Clusters up to this many transactions get their linearization recomputed
+ *  with an ancestor-set search whenever they change. Larger clusters only
+ *  have the changed part of their existing linearization re-chunked. */
+static constexpr size_t MAX_CLUSTER_RELINEARIZE_SIZE{64};
+
+/** Compare the feerates fee_a/size_a and fee_b/size_b without division or
+ *  overflow. Returns a negative value, zero or a positive value if the first
+ *  feerate is lower than, equal to or higher than the second. */
+int CompareFeeFrac(CAmount fee_a, int64_t size_a, CAmount fee_b, int64_t size_b);
+
+/** A run of consecutive transactions in a cluster's linearization that is
+ *  mined (and evicted) as a unit. The chunks of a linearization have
+ *  monotonically non-increasing feerates. */
+struct TxClusterChunk {
+    CAmount fee{0};    //!< Sum of the modified fees of the chunk's transactions
+    int64_t size{0};   //!< Sum of the virtual sizes of the chunk's transactions
+    size_t end{0};     //!< One past the linearization index of the chunk's last transaction
+};
+
+/** A maximal set of mempool transactions connected through spending
+ *  relations, together with a topologically valid ordering ("linearization")
+ *  of its transactions and the chunking of that ordering. */
+class TxCluster
+{
+public:
+    explicit TxCluster(uint64_t id) : m_id(id) {}
+
+    //! Unique and increasing identifier, used to break ties deterministically
+    const uint64_t m_id;
+    //! Transactions in linearization order; parents always precede children
+    std::vector<const CTxMemPoolEntry*> m_txs;
+    //! Chunking of m_txs, in order
+    std::vector<TxClusterChunk> m_chunks;
+
+    //! Start index in m_txs of the given chunk
+    size_t ChunkBegin(size_t chunk) const { return chunk == 0 ? 0 : m_chunks[chunk - 1].end; }
+
+private:
+    friend class TxClusterSet;
+
+    //! Whether the cluster was modified since its last Update()
+    bool m_dirty{false};
+    //! Whether m_txs has holes left by removed transactions
+    bool m_removed{false};
+    //! Whether removals may have disconnected the cluster
+    bool m_split{false};
+    //! Whether dependencies were added that m_txs may not respect yet
+    bool m_reorder{false};
+    //! Length of the prefix of m_txs that is unchanged since m_chunks was
+    //! computed; chunks ending within it are still valid
+    size_t m_unchanged{0};
+};
+
+/** The clusters of a mempool.
+ *
+ * The mempool reports every added transaction, removed transaction, new
+ * dependency (on reorgs) and fee change. Affected clusters are merged or
+ * marked dirty, and Update() brings all dirty clusters back into a
+ * consistent state: clusters that may have been disconnected by removals are
+ * split into their connected components, small clusters are relinearized
+ * (the new linearization is only adopted if its feerate diagram is better
+ * than the existing one), and all are re-chunked from the first changed
+ * position. Only the clusters touched since the previous Update() are
+ * processed, so appending a transaction or evicting a final chunk costs time
+ * proportional to the change, not to the size of the cluster or mempool.
+ *
+ * Mining reads the clusters' chunks in feerate order, eviction removes the
+ * lowest-feerate final chunk of any cluster, and replacement compares
+ * against the chunk feerate of the conflicting transactions.
+ */
+class TxClusterSet
+{
+public:
+    /** Add a new entry, merging the clusters of its in-mempool parents. The
+     *  entry's parent links must already be set. */
+    void AddTx(const CTxMemPoolEntry& entry);
+    /** Record a new dependency between two entries already in clusters. */
+    void AddDependency(const CTxMemPoolEntry& parent, const CTxMemPoolEntry& child);
+    /** Remove a set of entries. Must be called while the links between them
+     *  and the remaining entries are still in place. */
+    void RemoveTxs(const std::vector<const CTxMemPoolEntry*>& entries);
+    /** Record that the modified fee of an entry changed. */
+    void FeeChanged(const CTxMemPoolEntry& entry);
+    /** Bring all clusters modified since the last call back to a consistent,
+     *  linearized and chunked state. */
+    void Update();
+    void Clear();
+
+    /** Feerate (as fee and size) of the chunk containing the entry. */
+    const TxClusterChunk& GetChunk(const CTxMemPoolEntry& entry) const;
+    /** The cluster containing the entry, or nullptr. */
+    const TxCluster* GetCluster(const CTxMemPoolEntry& entry) const;
+    /** The cluster whose last chunk has the lowest feerate, or nullptr. */
+    const TxCluster* GetWorstCluster() const;
+
+    const std::map<uint64_t, std::unique_ptr<TxCluster>>& GetClusters() const { return m_clusters; }
+    size_t Size() const { return m_clusters.size(); }
+    size_t DynamicMemoryUsage() const;
+
+    /** Assert that all clusters are consistent with the entries' links. */
+    void Check(size_t tx_count) const;
+
+private:
+    struct WorstChunkCompare {
+        bool operator()(const TxCluster* a, const TxCluster* b) const;
+    };
+
+    //! The cluster containing an entry, and the entry's index in its
+    //! linearization
+    struct TxPosition {
+        TxCluster* cluster{nullptr};
+        size_t index{0};
+    };
+
+    TxPosition& PositionOf(const CTxMemPoolEntry& entry);
+    const TxPosition& PositionOf(const CTxMemPoolEntry& entry) const;
+    /** Update the positions of the entries of a cluster from index begin on. */
+    void Reindex(TxCluster& cluster, size_t begin = 0);
+    /** Reorder the transactions of a cluster so that parents precede their
+     *  children, keeping the existing order wherever it is already valid. */
+    void SortTopologically(TxCluster& cluster);
+
+    TxCluster* NewCluster();
+    void DeleteCluster(TxCluster* cluster);
+    void MarkDirty(TxCluster* cluster);
+    /** Merge the cluster from into the cluster into, and delete from. */
+    void Merge(TxCluster* into, TxCluster* from);
+    void Split(TxCluster* cluster);
+    static void Rechunk(TxCluster& cluster);
+    void Relinearize(TxCluster& cluster);
+    static size_t ClusterUsage(const TxCluster& cluster);
+
+    std::map<uint64_t, std::unique_ptr<TxCluster>> m_clusters;
+    //! Positions of all entries in clusters. They are kept here rather than
+    //! in CTxMemPoolEntry, so that entries do not grow when the mempool does
+    //! not track clusters.
+    std::unordered_map<const CTxMemPoolEntry*, TxPosition> m_positions;
+    //! Clean clusters, ordered by the feerate of their last chunk
+    std::set<const TxCluster*, WorstChunkCompare> m_by_worst_chunk;
+    std::vector<TxCluster*> m_dirty;
+    uint64_t m_next_id{0};
+    size_t m_cached_usage{0};
+};
+
+#endif // BITCOIN_TXCLUSTER_H
@@ -11,9 +11,13 @@
 #include <shutdown.h>
 #include <uint256.h>
 #include <util/system.h>
+#include <util/thread.h>
+#include <util/time.h>
 #include <util/translation.h>
 #include <util/vector.h>
 
+#include <algorithm>
+#include <optional>
 #include <stdint.h>
 
 static constexpr uint8_t DB_COIN{'C'};
@@ -54,6 +58,7 @@ void CCoinsViewDB::ResizeCache(size_t new_cache_size)
         m_db.reset();
         m_db = std::make_unique<CDBWrapper>(
             m_ldb_path, new_cache_size, m_is_memory, /*fWipe*/ false, /*obfuscate*/ true);
+        ++m_write_count;
     }
 }
 
@@ -80,7 +85,7 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase) {
     CDBBatch batch(*m_db);
     size_t count = 0;
     size_t changed = 0;
@@ -115,8 +120,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        it = erase ? mapCoins.erase(it) : std::next(it);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             m_db->WriteBatch(batch);
@@ -137,6 +141,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
 
     LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
     bool ret = m_db->WriteBatch(batch);
+    ++m_write_count;
     LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
     return ret;
 }
@@ -176,6 +181,8 @@ public:
     // cache warmup on instantiation.
     CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256&hashBlockIn):
         CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256& hashBlockIn, const CDBWrapper::Snapshot& snapshot, uint8_t shard):
+        CCoinsViewCursor(hashBlockIn), m_snapshot(snapshot), pcursor(pcursorIn), m_shard(shard) {}
     ~CCoinsViewDBCursor() {}
 
     bool GetKey(COutPoint &key) const override;
@@ -186,8 +193,16 @@ public:
     void Next() override;
 
 private:
+    //! Read the key at the current position into keyTmp, invalidating the
+    //! cursor at the end of the coins (or of its shard).
+    void ReadKey();
+
+    //! Declared before pcursor so that the iterator is destroyed first.
+    CDBWrapper::Snapshot m_snapshot;
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
+    //! If set, only coins whose txid starts with this byte are visited.
+    std::optional<uint8_t> m_shard;
 
     friend class CCoinsViewDB;
 };
@@ -211,6 +226,19 @@ std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor() const
     return i;
 }
 
+std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor(uint8_t shard, const CDBWrapper::Snapshot& snapshot) const
+{
+    auto i = std::make_unique<CCoinsViewDBCursor>(
+        const_cast<CDBWrapper&>(*m_db).NewIterator(snapshot), GetBestBlock(), snapshot, shard);
+    // Coin keys are ordered by the serialized txid, so the shard starts at the
+    // first key with this leading txid byte.
+    uint256 start;
+    *start.begin() = shard;
+    i->pcursor->Seek(std::make_pair(DB_COIN, start));
+    i->ReadKey();
+    return i;
+}
+
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
@@ -239,9 +267,16 @@ bool CCoinsViewDBCursor::Valid() const
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
+    ReadKey();
+}
+
+void CCoinsViewDBCursor::ReadKey()
+{
     CoinEntry entry(&keyTmp.second);
     if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
         keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
+    } else if (m_shard && *keyTmp.second.hash.begin() != *m_shard) {
+        keyTmp.first = 0; // Past the end of the shard
     } else {
         keyTmp.first = entry.key;
     }
@@ -271,46 +306,79 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+//! Number of key ranges the block index is loaded in, one for each value of
+//! the first byte of the block hash.
+static constexpr int BLOCK_INDEX_SHARD_COUNT{256};
+//! Maximum number of threads used to load the block index.
+static constexpr int MAX_BLOCK_INDEX_LOAD_THREADS{8};
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
-
-    // Load m_block_index
-    while (pcursor->Valid()) {
-        if (ShutdownRequested()) return false;
-        std::pair<uint8_t, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-
-                pcursor->Next();
-            } else {
+    // Reading the entries and hashing their headers for the proof of work
+    // check dominates, and does not depend on other entries: do it for ranges
+    // of the keys in parallel. The entries are inserted into the block index
+    // on this thread, in key order.
+    struct DiskEntry {
+        uint256 hash;
+        CDiskBlockIndex index;
+    };
+    std::vector<std::vector<DiskEntry>> shards(BLOCK_INDEX_SHARD_COUNT);
+    const CDBWrapper::Snapshot snapshot = GetSnapshot();
+
+    auto read_shard = [&](int shard) {
+        std::unique_ptr<CDBIterator> pcursor(NewIterator(snapshot));
+        uint256 start;
+        *start.begin() = shard;
+        pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, start));
+
+        while (pcursor->Valid()) {
+            if (ShutdownRequested()) return false;
+            std::pair<uint8_t, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() != shard) break;
+            DiskEntry entry;
+            if (!pcursor->GetValue(entry.index)) {
                 return error("%s: failed to read value", __func__);
             }
-        } else {
-            break;
+            entry.hash = entry.index.GetBlockHash();
+            if (!CheckProofOfWork(entry.hash, entry.index.nBits, consensusParams)) {
+                return error("%s: CheckProofOfWork failed: %s", __func__, entry.hash.ToString());
+            }
+            shards[shard].push_back(std::move(entry));
+            pcursor->Next();
         }
-    }
+        return true;
+    };
+
+    size_t count{0};
+    auto insert_shard = [&](int shard) {
+        for (const DiskEntry& entry : shards[shard]) {
+            const CDiskBlockIndex& diskindex = entry.index;
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(entry.hash);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+        }
+        count += shards[shard].size();
+        shards[shard] = {};
+        return true;
+    };
 
+    const int64_t time_start = GetTimeMillis();
+    const int num_threads = std::clamp(GetNumCores(), 1, MAX_BLOCK_INDEX_LOAD_THREADS);
+    if (!util::ForEachShard(BLOCK_INDEX_SHARD_COUNT, num_threads, "loadblkidx", read_shard, insert_shard)) {
+        return false;
+    }
+    LogPrintf("Loaded %u block index entries in %dms using %d threads\n", count, GetTimeMillis() - time_start, num_threads);
     return true;
 }
 
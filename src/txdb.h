@@ -11,6 +11,7 @@
 #include <chain.h>
 #include <primitives/block.h>
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <utility>
@@ -49,6 +50,8 @@ protected:
     std::unique_ptr<CDBWrapper> m_db;
     fs::path m_ldb_path;
     bool m_is_memory;
+    //! Number of completed BatchWrite() calls, see WriteCount().
+    std::atomic<uint64_t> m_write_count{0};
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
@@ -59,9 +62,25 @@ public:
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
 
+    //! Number of key ranges the coins can be iterated in with Cursor(shard, snapshot),
+    //! one for each value of the first byte of the txid.
+    static constexpr int SHARD_COUNT{256};
+
+    //! Pin the current state of the database, to iterate over it from several cursors.
+    CDBWrapper::Snapshot GetSnapshot() const { return m_db->GetSnapshot(); }
+
+    //! Get a cursor over the coins, as of `snapshot`, whose txid's first byte is `shard`.
+    //! Iterating over all shards in order visits the coins in the same order as Cursor().
+    std::unique_ptr<CCoinsViewCursor> Cursor(uint8_t shard, const CDBWrapper::Snapshot& snapshot) const;
+
+    //! Number of times the database contents changed. Readers that run
+    //! concurrently with BatchWrite() compare this before and after to find
+    //! out whether what they read may already be stale.
+    uint64_t WriteCount() const { return m_write_count.load(); }
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
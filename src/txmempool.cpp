@@ -10,16 +10,21 @@
 #include <consensus/validation.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
+#include <policy/rbf.h>
 #include <policy/settings.h>
 #include <reverse_iterator.h>
 #include <util/moneystr.h>
+#include <util/rbf.h>
 #include <util/system.h>
 #include <util/time.h>
 #include <validation.h>
 #include <validationinterface.h>
 
+#include <algorithm>
 #include <cmath>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, unsigned int _entryHeight,
@@ -144,11 +149,13 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
                 if (!visited(childIter) && !setAlreadyIncluded.count(childHash)) {
                     UpdateChild(it, childIter, true);
                     UpdateParent(childIter, it, true);
+                    if (m_clusters) m_clusters->AddDependency(*it, *childIter);
                 }
             }
         } // release epoch guard for UpdateForDescendants
         UpdateForDescendants(it, mapMemPoolDescendantsToUpdate, setAlreadyIncluded);
     }
+    if (m_clusters) m_clusters->Update();
 }
 
 bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents /* = true */) const
@@ -333,12 +340,20 @@ void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee,
     assert(int(nSigOpCostWithAncestors) >= 0);
 }
 
-CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator, int check_ratio)
-    : m_check_ratio(check_ratio), minerPolicyEstimator(estimator)
+CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator, int check_ratio, bool track_clusters, size_t max_change_log_size)
+    : m_check_ratio(check_ratio), minerPolicyEstimator(estimator),
+      m_max_change_log_size(std::max<size_t>(max_change_log_size, 1)),
+      m_clusters(track_clusters ? std::make_unique<TxClusterSet>() : nullptr)
 {
     _clear(); //lock free clear
 }
 
+size_t CTxMemPool::ChangeLogSizeForLimit(int64_t max_mempool_bytes)
+{
+    const size_t max_bytes = std::max<int64_t>(max_mempool_bytes, 0) / 100 * MEMPOOL_CHANGE_LOG_MAX_PERCENT;
+    return std::clamp<size_t>(max_bytes / sizeof(ChangeLogEntry), 1, MAX_MEMPOOL_CHANGE_LOG_SIZE);
+}
+
 bool CTxMemPool::isSpent(const COutPoint& outpoint) const
 {
     LOCK(cs);
@@ -395,6 +410,10 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     }
     UpdateAncestorsOf(true, newit, setAncestors);
     UpdateEntryForAncestors(newit, setAncestors);
+    if (m_clusters) {
+        m_clusters->AddTx(*newit);
+        m_clusters->Update();
+    }
 
     nTransactionsUpdated++;
     totalTxSize += entry.GetTxSize();
@@ -411,7 +430,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 {
     // We increment mempool sequence value no matter removal reason
     // even if not directly reported below.
-    uint64_t mempool_sequence = GetAndIncrementSequence();
+    uint64_t mempool_sequence = LogChange(it->GetTx().GetHash(), /* added */ false);
 
     if (reason != MemPoolRemovalReason::BLOCK) {
         // Notify clients that a transaction has been removed from the mempool
@@ -598,12 +617,17 @@ void CTxMemPool::_clear()
 {
     mapTx.clear();
     mapNextTx.clear();
+    if (m_clusters) m_clusters->Clear();
     totalTxSize = 0;
     m_total_fee = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = false;
     rollingMinimumFeeRate = 0;
+    // The removals are not logged, so earlier sequence numbers can no longer
+    // be served.
+    m_change_log.clear();
+    m_change_log_start = m_sequence_number;
     ++nTransactionsUpdated;
 }
 
@@ -741,6 +765,7 @@ void CTxMemPool::check(CChainState& active_chainstate) const
     assert(totalTxSize == checkTotal);
     assert(m_total_fee == check_total_fee);
     assert(innerUsage == cachedInnerUsage);
+    if (m_clusters) m_clusters->Check(mapTx.size());
 }
 
 bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb, bool wtxid)
@@ -819,6 +844,119 @@ std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
     return ret;
 }
 
+static MempoolEntrySnapshot MakeEntrySnapshot(const CTxMemPoolEntry& e)
+{
+    MempoolEntrySnapshot snapshot;
+    snapshot.txid = e.GetTx().GetHash();
+    snapshot.wtxid = e.GetTx().GetWitnessHash();
+    snapshot.fee = e.GetFee();
+    snapshot.modified_fee = e.GetModifiedFee();
+    snapshot.vsize = e.GetTxSize();
+    snapshot.weight = e.GetTxWeight();
+    snapshot.time = e.GetTime();
+    snapshot.height = e.GetHeight();
+    snapshot.count_with_descendants = e.GetCountWithDescendants();
+    snapshot.size_with_descendants = e.GetSizeWithDescendants();
+    snapshot.mod_fees_with_descendants = e.GetModFeesWithDescendants();
+    snapshot.count_with_ancestors = e.GetCountWithAncestors();
+    snapshot.size_with_ancestors = e.GetSizeWithAncestors();
+    snapshot.mod_fees_with_ancestors = e.GetModFeesWithAncestors();
+    snapshot.parents.reserve(e.GetMemPoolParentsConst().size());
+    for (const CTxMemPoolEntry& parent : e.GetMemPoolParentsConst()) {
+        snapshot.parents.push_back(parent.GetTx().GetHash());
+    }
+    snapshot.children.reserve(e.GetMemPoolChildrenConst().size());
+    for (const CTxMemPoolEntry& child : e.GetMemPoolChildrenConst()) {
+        snapshot.children.push_back(child.GetTx().GetHash());
+    }
+    return snapshot;
+}
+
+MempoolEntrySnapshot CTxMemPool::SnapshotEntry(const CTxMemPoolEntry& entry) const
+{
+    AssertLockHeld(cs);
+    MempoolEntrySnapshot snapshot = MakeEntrySnapshot(entry);
+    snapshot.bip125_replaceable = IsRBFOptIn(entry.GetTx(), *this) == RBFTransactionState::REPLACEABLE_BIP125;
+    return snapshot;
+}
+
+std::shared_ptr<const MempoolSnapshot> CTxMemPool::GetSnapshot() const
+{
+    LOCK(cs);
+    if (m_snapshot && m_snapshot_transactions_updated == nTransactionsUpdated) {
+        return m_snapshot;
+    }
+
+    // Entries are visited parents first, so the replaceability of an entry
+    // follows from its own signal and its parents' replaceability, without
+    // walking all ancestors as IsRBFOptIn() does.
+    std::unordered_set<const CTxMemPoolEntry*> replaceable;
+    for (const auto& it : GetSortedDepthAndScore()) {
+        if (SignalsOptInRBF(it->GetTx()) ||
+            std::any_of(it->GetMemPoolParentsConst().begin(), it->GetMemPoolParentsConst().end(),
+                        [&](const CTxMemPoolEntry& parent) { return replaceable.count(&parent) > 0; })) {
+            replaceable.insert(&*it);
+        }
+    }
+
+    auto snapshot = std::make_shared<MempoolSnapshot>();
+    snapshot->sequence = m_sequence_number;
+    snapshot->entries.reserve(mapTx.size());
+    for (const CTxMemPoolEntry& e : mapTx) {
+        MempoolEntrySnapshot& entry = snapshot->entries.emplace_back(MakeEntrySnapshot(e));
+        entry.bip125_replaceable = replaceable.count(&e) > 0;
+    }
+
+    m_snapshot = snapshot;
+    m_snapshot_transactions_updated = nTransactionsUpdated;
+    return snapshot;
+}
+
+uint64_t CTxMemPool::LogChange(const uint256& txid, bool added)
+{
+    AssertLockHeld(cs);
+    const uint64_t sequence = GetAndIncrementSequence();
+    if (m_change_log.size() >= m_max_change_log_size) {
+        m_change_log_start = m_change_log.front().sequence + 1;
+        m_change_log.pop_front();
+    }
+    m_change_log.push_back({sequence, txid, added});
+    return sequence;
+}
+
+std::optional<MempoolChanges> CTxMemPool::GetChangesSince(uint64_t sequence) const
+{
+    LOCK(cs);
+    if (sequence < m_change_log_start || sequence > m_sequence_number) return std::nullopt;
+
+    const auto begin = std::lower_bound(m_change_log.begin(), m_change_log.end(), sequence,
+                                        [](const ChangeLogEntry& entry, uint64_t seq) { return entry.sequence < seq; });
+    // A transaction can be added and removed several times in the range (e.g.
+    // on reorgs); only its first and last change determine the net change.
+    struct TxChanges {
+        bool first_added;
+        uint64_t last_sequence;
+    };
+    std::unordered_map<uint256, TxChanges, SaltedTxidHasher> txs;
+    for (auto it = begin; it != m_change_log.end(); ++it) {
+        auto [tx_it, inserted] = txs.try_emplace(it->txid, TxChanges{it->added, it->sequence});
+        if (!inserted) tx_it->second.last_sequence = it->sequence;
+    }
+
+    MempoolChanges changes;
+    changes.sequence = m_sequence_number;
+    for (auto it = begin; it != m_change_log.end(); ++it) {
+        const TxChanges& tx = txs.at(it->txid);
+        if (tx.last_sequence != it->sequence) continue;
+        if (it->added) {
+            changes.added.push_back(it->txid);
+        } else if (!tx.first_added) {
+            changes.removed.push_back(it->txid);
+        }
+    }
+    return changes;
+}
+
 CTransactionRef CTxMemPool::get(const uint256& hash) const
 {
     LOCK(cs);
@@ -863,6 +1001,10 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
             for (txiter descendantIt : setDescendants) {
                 mapTx.modify(descendantIt, update_ancestor_state(0, nFeeDelta, 0, 0));
             }
+            if (m_clusters) {
+                m_clusters->FeeChanged(*it);
+                m_clusters->Update();
+            }
             ++nTransactionsUpdated;
         }
     }
@@ -951,7 +1093,18 @@ void CCoinsViewMemPool::PackageAddTransaction(const CTransactionRef& tx)
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage +
+           memusage::DynamicUsage(m_change_log) + (m_clusters ? m_clusters->DynamicMemoryUsage() : 0);
+}
+
+CFeeRate CTxMemPool::GetMiningScore(const CTxMemPoolEntry& entry) const
+{
+    AssertLockHeld(cs);
+    if (m_clusters) {
+        const TxClusterChunk& chunk = m_clusters->GetChunk(entry);
+        return CFeeRate(chunk.fee, chunk.size);
+    }
+    return CFeeRate(entry.GetModifiedFee(), entry.GetTxSize());
 }
 
 void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked) {
@@ -965,10 +1118,19 @@ void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked)
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
     AssertLockHeld(cs);
+    if (m_clusters) {
+        // The cluster set needs the links between the removed and remaining
+        // entries, so it is told before they are cut.
+        std::vector<const CTxMemPoolEntry*> removed;
+        removed.reserve(stage.size());
+        for (txiter it : stage) removed.push_back(&*it);
+        m_clusters->RemoveTxs(removed);
+    }
     UpdateForRemoveFromMempool(stage, updateDescendants);
     for (txiter it : stage) {
         removeUnchecked(it, reason);
     }
+    if (m_clusters) m_clusters->Update();
 }
 
 int CTxMemPool::Expire(std::chrono::seconds time)
@@ -1057,19 +1219,29 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
     unsigned nTxnRemoved = 0;
     CFeeRate maxFeeRateRemoved(0);
     while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
-        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
-
         // We set the new mempool min fee to the feerate of the removed set, plus the
         // "minimum reasonable fee rate" (ie some value under which we consider txn
         // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
         // equal to txn which were removed with no block in between.
-        CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+        CFeeRate removed;
+        setEntries stage;
+        if (m_clusters) {
+            // The last chunk of a cluster's linearization is the set that
+            // would be mined last, and it includes all of its descendants.
+            const TxCluster* worst = m_clusters->GetWorstCluster();
+            const TxClusterChunk& chunk = worst->m_chunks.back();
+            removed = CFeeRate(chunk.fee, chunk.size);
+            for (size_t i = worst->ChunkBegin(worst->m_chunks.size() - 1); i < chunk.end; ++i) {
+                stage.insert(mapTx.iterator_to(*worst->m_txs[i]));
+            }
+        } else {
+            indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+            removed = CFeeRate(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+            CalculateDescendants(mapTx.project<0>(it), stage);
+        }
         removed += incrementalRelayFee;
         trackPackageRemoved(removed);
         maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
-
-        setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
         nTxnRemoved += stage.size();
 
         std::vector<CTransaction> txn;
@@ -7,7 +7,9 @@
 #define BITCOIN_TXMEMPOOL_H
 
 #include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
 #include <optional>
 #include <set>
 #include <string>
@@ -21,6 +23,7 @@
 #include <primitives/transaction.h>
 #include <random.h>
 #include <sync.h>
+#include <txcluster.h>
 #include <util/epochguard.h>
 #include <util/hasher.h>
 
@@ -36,6 +39,11 @@ extern RecursiveMutex cs_main;
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
 static const uint32_t MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
+/** Maximum number of additions and removals kept to answer GetChangesSince() */
+static constexpr size_t MAX_MEMPOOL_CHANGE_LOG_SIZE{100000};
+/** Share of the mempool size limit, in percent, that the change log may use */
+static constexpr size_t MEMPOOL_CHANGE_LOG_MAX_PERCENT{5};
+
 struct LockPoints
 {
     // Will be set to the blockchain height and median time past
@@ -389,6 +397,62 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/**
+ * Copy of the data that RPC and REST report about a mempool entry. Unlike
+ * CTxMemPoolEntry it can be read without holding the mempool lock.
+ */
+struct MempoolEntrySnapshot
+{
+    uint256 txid;
+    uint256 wtxid;
+    CAmount fee{0};
+    CAmount modified_fee{0};
+    int32_t vsize{0};
+    int32_t weight{0};
+    std::chrono::seconds time{0};
+    unsigned int height{0};
+    uint64_t count_with_descendants{0};
+    uint64_t size_with_descendants{0};
+    CAmount mod_fees_with_descendants{0};
+    uint64_t count_with_ancestors{0};
+    uint64_t size_with_ancestors{0};
+    CAmount mod_fees_with_ancestors{0};
+    /** In-mempool parents and children, by txid */
+    std::vector<uint256> parents;
+    std::vector<uint256> children;
+    /** Whether the transaction or one of its in-mempool ancestors signals
+     *  BIP125 replaceability */
+    bool bip125_replaceable{false};
+};
+
+/**
+ * Immutable copy of all mempool entries, see CTxMemPool::GetSnapshot().
+ */
+struct MempoolSnapshot
+{
+    /** Mempool sequence number at the time the snapshot was taken */
+    uint64_t sequence{0};
+    /** In the order of the txid index of mapTx */
+    std::vector<MempoolEntrySnapshot> entries;
+};
+
+/**
+ * Net changes to the mempool over a range of sequence numbers, see
+ * CTxMemPool::GetChangesSince().
+ */
+struct MempoolChanges
+{
+    /** Mempool sequence number after the last change */
+    uint64_t sequence{0};
+    /** Transactions that are in the mempool now but were not at the start of
+     *  the range, or were removed and added again, in the order they were
+     *  (last) added */
+    std::vector<uint256> added;
+    /** Transactions that were in the mempool at the start of the range but
+     *  are not anymore */
+    std::vector<uint256> removed;
+};
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -495,10 +559,31 @@ protected:
     // is added or removed from the mempool for any reason.
     mutable uint64_t m_sequence_number GUARDED_BY(cs){1};
 
+    struct ChangeLogEntry {
+        uint64_t sequence;
+        uint256 txid;
+        bool added;
+    };
+    //! Most recent additions and removals, in sequence order, bounded by
+    //! m_max_change_log_size
+    std::deque<ChangeLogEntry> m_change_log GUARDED_BY(cs);
+    const size_t m_max_change_log_size;
+    //! Lowest sequence number from which on all changes are in m_change_log
+    uint64_t m_change_log_start GUARDED_BY(cs){1};
+
+    //! Last snapshot returned by GetSnapshot(), and the value of
+    //! nTransactionsUpdated it was taken at. It is kept alive so that
+    //! sequential pollers of an unchanged mempool don't retake it.
+    mutable std::shared_ptr<const MempoolSnapshot> m_snapshot GUARDED_BY(cs);
+    mutable unsigned int m_snapshot_transactions_updated GUARDED_BY(cs){0};
+
     void trackPackageRemoved(const CFeeRate& rate) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     bool m_is_loaded GUARDED_BY(cs){false};
 
+    //! Cluster linearizations, if enabled (-mempoolclusters)
+    const std::unique_ptr<TxClusterSet> m_clusters PT_GUARDED_BY(cs);
+
 public:
 
     static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12; // public only for testing
@@ -596,8 +681,20 @@ public:
      *
      * @param[in] estimator is used to estimate appropriate transaction fees.
      * @param[in] check_ratio is the ratio used to determine how often sanity checks will run.
+     * @param[in] track_clusters whether to maintain a linearization of every cluster, used
+     *                           by mining, eviction and replacement instead of ancestor
+     *                           and descendant scores.
+     * @param[in] max_change_log_size the number of additions and removals kept to answer
+     *                                GetChangesSince(), see ChangeLogSizeForLimit().
      */
-    explicit CTxMemPool(CBlockPolicyEstimator* estimator = nullptr, int check_ratio = 0);
+    explicit CTxMemPool(CBlockPolicyEstimator* estimator = nullptr, int check_ratio = 0, bool track_clusters = false,
+                        size_t max_change_log_size = MAX_MEMPOOL_CHANGE_LOG_SIZE);
+
+    /** The change log size for a mempool limited to max_mempool_bytes:
+     *  MAX_MEMPOOL_CHANGE_LOG_SIZE, unless that would use more than
+     *  MEMPOOL_CHANGE_LOG_MAX_PERCENT of the limit. The log counts towards
+     *  DynamicMemoryUsage(). */
+    static size_t ChangeLogSizeForLimit(int64_t max_mempool_bytes);
 
     /**
      * If sanity-checking is turned on, check makes sure the pool is
@@ -753,8 +850,27 @@ public:
     TxMempoolInfo info(const GenTxid& gtxid) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
+    /** Return a snapshot of all entries. The snapshot is shared between
+     *  callers and only retaken after the mempool changed, so that readers
+     *  like RPC can serialize the whole mempool without holding cs. */
+    std::shared_ptr<const MempoolSnapshot> GetSnapshot() const;
+    /** Copy the data of a single entry */
+    MempoolEntrySnapshot SnapshotEntry(const CTxMemPoolEntry& entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     size_t DynamicMemoryUsage() const;
 
+    /** Whether cluster linearizations are maintained */
+    bool HasClusters() const { return m_clusters != nullptr; }
+    const TxClusterSet& GetClusters() const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        AssertLockHeld(cs);
+        assert(m_clusters);
+        return *m_clusters;
+    }
+    /** The feerate at which an entry would be mined: the feerate of its chunk
+     *  if clusters are maintained, and its own feerate otherwise. */
+    CFeeRate GetMiningScore(const CTxMemPoolEntry& entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** Adds a transaction to the unbroadcast set */
     void AddUnbroadcastTx(const uint256& txid)
     {
@@ -786,6 +902,16 @@ public:
         return m_sequence_number++;
     }
 
+    /** Take a sequence number for the addition or removal of a transaction,
+     *  and record the change for GetChangesSince(). */
+    uint64_t LogChange(const uint256& txid, bool added) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /** Return the net additions and removals since the given sequence number
+     *  (e.g. a previous result's sequence, or getrawmempool's
+     *  mempool_sequence), or std::nullopt if the change log no longer covers
+     *  it or it lies in the future. */
+    std::optional<MempoolChanges> GetChangesSince(uint64_t sequence) const;
+
     uint64_t GetSequence() const EXCLUSIVE_LOCKS_REQUIRED(cs) {
         return m_sequence_number;
     }
@@ -5,10 +5,17 @@
 #include <util/thread.h>
 
 #include <logging.h>
+#include <sync.h>
+#include <tinyformat.h>
 #include <util/system.h>
 #include <util/threadnames.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <exception>
+#include <thread>
+#include <vector>
 
 void util::TraceThread(const char* thread_name, std::function<void()> thread_func)
 {
@@ -25,3 +32,78 @@ void util::TraceThread(const char* thread_name, std::function<void()> thread_fun
         throw;
     }
 }
+
+bool util::ForEachShard(int num_shards, int num_threads, const std::string& thread_name,
+                        const std::function<bool(int shard)>& process_shard,
+                        const std::function<bool(int shard)>& consume_shard,
+                        const std::function<void()>& interruption_point,
+                        int max_shards_ahead)
+{
+    num_threads = std::clamp(num_threads, 1, std::max(num_shards, 1));
+    if (max_shards_ahead <= 0) max_shards_ahead = num_threads * 2;
+
+    Mutex mutex;
+    std::condition_variable cond;
+    int next_shard{0};
+    int next_consumed{0};
+    std::vector<bool> processed(num_shards, false);
+    bool failed{false};
+    bool stop{false};
+
+    auto worker = [&] {
+        while (true) {
+            int shard;
+            {
+                WAIT_LOCK(mutex, lock);
+                cond.wait(lock, [&] { return stop || next_shard == num_shards || next_shard < next_consumed + max_shards_ahead; });
+                if (stop || next_shard == num_shards) return;
+                shard = next_shard++;
+            }
+            bool ok{false};
+            try {
+                ok = process_shard(shard);
+            } catch (const std::exception& e) {
+                LogPrintf("%s: error processing shard %d: %s\n", thread_name, shard, e.what());
+            }
+            {
+                LOCK(mutex);
+                processed[shard] = true;
+                if (!ok) failed = stop = true;
+            }
+            cond.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    auto join_threads = [&] {
+        WITH_LOCK(mutex, stop = true);
+        cond.notify_all();
+        for (std::thread& thread : threads) thread.join();
+    };
+
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&worker, name = strprintf("%s.%d", thread_name, i)] { util::TraceThread(name.c_str(), worker); });
+    }
+
+    bool ok{true};
+    try {
+        for (int shard = 0; ok && shard < num_shards; ++shard) {
+            // Wait for the shard to be processed, checking for interruption regularly.
+            while (true) {
+                if (interruption_point) interruption_point();
+                WAIT_LOCK(mutex, lock);
+                if (failed) ok = false;
+                if (failed || processed[shard]) break;
+                cond.wait_for(lock, std::chrono::milliseconds{100});
+            }
+            if (ok) ok = consume_shard(shard);
+            WITH_LOCK(mutex, next_consumed = shard + 1);
+            cond.notify_all();
+        }
+    } catch (...) {
+        join_threads();
+        throw;
+    }
+    join_threads();
+    return ok;
+}
@@ -6,6 +6,7 @@
 #define BITCOIN_UTIL_THREAD_H
 
 #include <functional>
+#include <string>
 
 namespace util {
 /**
@@ -13,6 +14,26 @@ namespace util {
  */
 void TraceThread(const char* thread_name, std::function<void()> thread_func);
 
+/**
+ * Split work into num_shards independent pieces and process them using up to
+ * num_threads threads named "<thread_name>.<n>".
+ *
+ * process_shard is called concurrently for different shards. consume_shard is
+ * called on the calling thread for each shard in order, once it has been
+ * processed, so that results combined there are deterministic. Only
+ * max_shards_ahead shards (by default two per thread) are processed ahead of
+ * the one being consumed, to bound the memory used by their results. Exceptions thrown by process_shard are
+ * logged and count as failure; interruption_point is called regularly on the
+ * calling thread and may throw to abort.
+ *
+ * @returns false if process_shard or consume_shard returned false
+ */
+bool ForEachShard(int num_shards, int num_threads, const std::string& thread_name,
+                  const std::function<bool(int shard)>& process_shard,
+                  const std::function<bool(int shard)>& consume_shard,
+                  const std::function<void()>& interruption_point = {},
+                  int max_shards_ahead = 0);
+
 } // namespace util
 
 #endif // BITCOIN_UTIL_THREAD_H
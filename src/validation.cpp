@@ -47,13 +47,19 @@
 #include <util/rbf.h>
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <util/translation.h>
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <numeric>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -72,6 +78,14 @@ static const unsigned int MAX_DISCONNECTED_TX_POOL_SIZE = 20000;
 static constexpr std::chrono::hours DATABASE_WRITE_INTERVAL{1};
 /** Time to wait between flushing chainstate to disk. */
 static constexpr std::chrono::hours DATABASE_FLUSH_INTERVAL{24};
+/** Time background validation waits after the active chainstate processed a block. */
+static constexpr std::chrono::milliseconds BACKGROUND_VALIDATION_BACKOFF{500};
+/** Time background validation waits when it has nothing to connect. */
+static constexpr std::chrono::seconds BACKGROUND_VALIDATION_IDLE_INTERVAL{5};
+/** Maximum number of blocks background validation connects before yielding. */
+static constexpr int BACKGROUND_VALIDATION_BATCH_BLOCKS{16};
+/** Share of the coins cache space left in use after a flush triggered by the cache size. */
+static constexpr int64_t COINS_CACHE_EVICT_TARGET_PERCENT{80};
 /** Maximum age of our tip for us to be considered current for fee estimation */
 static constexpr std::chrono::hours MAX_FEE_ESTIMATION_TIP_AGE{3};
 const std::vector<std::string> CHECKLEVEL_DOC {
@@ -143,11 +157,18 @@ extern std::set<int> setDirtyFileInfo;
 void FlushBlockFile(bool fFinalize = false, bool finalize_undo = false);
 // ... TODO move fully to blockstorage
 
-CBlockIndex* BlockManager::LookupBlockIndex(const uint256& hash) const
+CBlockIndex* BlockManager::LookupBlockIndex(const uint256& hash)
+{
+    AssertLockHeld(cs_main);
+    BlockMap::iterator it = m_block_index.find(hash);
+    return it == m_block_index.end() ? nullptr : &it->second;
+}
+
+const CBlockIndex* BlockManager::LookupBlockIndex(const uint256& hash) const
 {
     AssertLockHeld(cs_main);
     BlockMap::const_iterator it = m_block_index.find(hash);
-    return it == m_block_index.end() ? nullptr : it->second;
+    return it == m_block_index.end() ? nullptr : &it->second;
 }
 
 CBlockIndex* BlockManager::FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
@@ -345,6 +366,8 @@ static void UpdateMempoolForReorg(CChainState& active_chainstate, CTxMemPool& me
 {
     AssertLockHeld(cs_main);
     AssertLockHeld(mempool.cs);
+    // The mempool only follows the active chainstate.
+    if (active_chainstate.m_validates_in_background) return;
     std::vector<uint256> vHashUpdate;
     // disconnectpool's insertion_order index sorts the entries from
     // oldest to newest, but the oldest entry will be the last tx from the
@@ -421,6 +444,17 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, TxValidationS
     return CheckInputScripts(tx, state, view, flags, /* cacheSigStore = */ true, /* cacheFullSciptStore = */ true, txdata);
 }
 
+//! Script check queue used when connecting blocks of the active chainstate,
+//! and to verify the inputs of transactions accepted to the mempool.
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
+/**
+ * Transactions with fewer inputs than this have their scripts checked on the
+ * calling thread when accepted to the mempool, as handing them to the script
+ * check threads would cost more than it saves.
+ */
+static constexpr size_t MIN_PARALLEL_MEMPOOL_SCRIPT_CHECKS{4};
+
 namespace {
 
 class MemPoolAccept
@@ -496,6 +530,13 @@ private:
     // only invoke this on transactions that have otherwise passed policy checks.
     bool PolicyScriptChecks(const ATMPArgs& args, Workspace& ws, PrecomputedTransactionData& txdata) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
 
+    // Run the policy script checks of all transactions of a package at once,
+    // spread over the script check threads. Returns false if any of them
+    // failed, or if there are no script check threads; the transactions then
+    // have to go through PolicyScriptChecks() one at a time to find out which
+    // one failed and why.
+    bool PackageScriptChecks(std::vector<Workspace>& workspaces, std::vector<PrecomputedTransactionData>& txdata) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
     // Re-run the script checks, using consensus flags, and try to cache the
     // result in the scriptcache. This should be done after
     // PolicyScriptChecks(). This requires that all inputs either be in our
@@ -826,8 +867,11 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
             // replaced, not their indirect descendants. While that does
             // mean high feerate children are ignored when deciding whether
             // or not to replace, we do require the replacement to pay more
-            // overall fees too, mitigating most cases.
-            CFeeRate oldFeeRate(mi->GetModifiedFee(), mi->GetTxSize());
+            // overall fees too, mitigating most cases. If the mempool tracks
+            // clusters, the feerate of the chunk the transaction would be
+            // mined in is used instead, which does account for such
+            // children (and for low feerate parents).
+            CFeeRate oldFeeRate = m_pool.GetMiningScore(*mi);
             if (newFeeRate <= oldFeeRate)
             {
                 return state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "insufficient fee",
@@ -923,6 +967,17 @@ bool MemPoolAccept::PolicyScriptChecks(const ATMPArgs& args, Workspace& ws, Prec
 
     // Check input scripts and signatures.
     // This is done last to help prevent CPU exhaustion denial-of-service attacks.
+    if (g_parallel_script_checks && tx.vin.size() >= MIN_PARALLEL_MEMPOOL_SCRIPT_CHECKS) {
+        // Verify the inputs on the script check threads. Failures are rare,
+        // so only then are the checks repeated below, one at a time, to find
+        // the failing input and report why it failed.
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        std::vector<CScriptCheck> vChecks;
+        if (CheckInputScripts(tx, state, m_view, scriptVerifyFlags, true, false, txdata, &vChecks)) {
+            control.Add(vChecks);
+            if (control.Wait()) return true;
+        }
+    }
     if (!CheckInputScripts(tx, state, m_view, scriptVerifyFlags, true, false, txdata)) {
         // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
         // need to turn both off, and compare against just turning off CLEANSTACK
@@ -940,6 +995,22 @@ bool MemPoolAccept::PolicyScriptChecks(const ATMPArgs& args, Workspace& ws, Prec
     return true;
 }
 
+bool MemPoolAccept::PackageScriptChecks(std::vector<Workspace>& workspaces, std::vector<PrecomputedTransactionData>& txdata)
+{
+    if (!g_parallel_script_checks) return false;
+
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    for (size_t i = 0; i < workspaces.size(); ++i) {
+        Workspace& ws = workspaces[i];
+        std::vector<CScriptCheck> vChecks;
+        if (!CheckInputScripts(*ws.m_ptx, ws.m_state, m_view, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, txdata[i], &vChecks)) {
+            return false;
+        }
+        control.Add(vChecks);
+    }
+    return control.Wait();
+}
+
 bool MemPoolAccept::ConsensusScriptChecks(const ATMPArgs& args, Workspace& ws, PrecomputedTransactionData& txdata)
 {
     const CTransaction& tx = *ws.m_ptx;
@@ -1043,7 +1114,7 @@ MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef
 
     if (!Finalize(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
 
-    GetMainSignals().TransactionAddedToMempool(ptx, m_pool.GetAndIncrementSequence());
+    GetMainSignals().TransactionAddedToMempool(ptx, m_pool.LogChange(ptx->GetHash(), /* added */ true));
 
     return MempoolAcceptResult::Success(std::move(ws.m_replaced_transactions), ws.m_base_fees);
 }
@@ -1080,9 +1151,13 @@ PackageMempoolAcceptResult MemPoolAccept::AcceptMultipleTransactions(const std::
         m_viewmempool.PackageAddTransaction(ws.m_ptx);
     }
 
-    for (Workspace& ws : workspaces) {
-        PrecomputedTransactionData txdata;
-        if (!PolicyScriptChecks(args, ws, txdata)) {
+    // Verify the scripts of all transactions in the package concurrently, and
+    // only fall back to checking them one by one if that fails.
+    std::vector<PrecomputedTransactionData> txdata(workspaces.size());
+    const bool package_scripts_ok = PackageScriptChecks(workspaces, txdata);
+    for (size_t i = 0; i < workspaces.size(); ++i) {
+        Workspace& ws = workspaces[i];
+        if (!package_scripts_ok && !PolicyScriptChecks(args, ws, txdata[i])) {
             // Exit early to avoid doing pointless work. Update the failed tx result; the rest are unfinished.
             package_state.Invalid(PackageValidationResult::PCKG_TX, "transaction failed");
             results.emplace(ws.m_ptx->GetWitnessHash(), MempoolAcceptResult::Failure(ws.m_state));
@@ -1369,24 +1444,63 @@ int BlockManager::GetSpendHeight(const CCoinsViewCache& inputs)
 
 
 static CuckooCache::cache<uint256, SignatureCacheHasher> g_scriptExecutionCache;
+static uint256 g_scriptExecutionCacheNonce;
 static CSHA256 g_scriptExecutionCacheHasher;
+static SigCacheCounters g_scriptExecutionCacheCounters GUARDED_BY(cs_main);
 
-void InitScriptExecutionCache() {
-    // Setup the salted hasher
-    uint256 nonce = GetRandHash();
+static void SetScriptExecutionCacheNonce(const uint256& nonce)
+{
+    g_scriptExecutionCacheNonce = nonce;
     // We want the nonce to be 64 bytes long to force the hasher to process
     // this chunk, which makes later hash computations more efficient. We
     // just write our 32-byte entropy twice to fill the 64 bytes.
+    g_scriptExecutionCacheHasher.Reset();
     g_scriptExecutionCacheHasher.Write(nonce.begin(), 32);
     g_scriptExecutionCacheHasher.Write(nonce.begin(), 32);
+}
+
+void InitScriptExecutionCache() {
+    // Setup the salted hasher
+    SetScriptExecutionCacheNonce(GetRandHash());
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
     size_t nElems = g_scriptExecutionCache.setup_bytes(nMaxCacheSize);
+    WITH_LOCK(cs_main, g_scriptExecutionCacheCounters.max_entries = nElems);
     LogPrintf("Using %zu MiB out of %zu/2 requested for script execution cache, able to store %zu elements\n",
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+SigCacheCounters GetScriptExecutionCacheCounters()
+{
+    AssertLockHeld(cs_main);
+    return g_scriptExecutionCacheCounters;
+}
+
+bool DumpScriptExecutionCache(const fs::path& path)
+{
+    AssertLockHeld(cs_main);
+    const std::vector<uint256> entries{g_scriptExecutionCache.get_live_elements()};
+    if (!DumpSaltedCache(path, g_scriptExecutionCacheNonce, entries)) return false;
+    LogPrintf("Dumped %u script execution cache entries\n", entries.size());
+    return true;
+}
+
+bool LoadScriptExecutionCache(const fs::path& path)
+{
+    AssertLockHeld(cs_main);
+    uint256 nonce;
+    std::vector<uint256> entries;
+    if (!LoadSaltedCache(path, nonce, entries)) return false;
+    SetScriptExecutionCacheNonce(nonce);
+    for (const uint256& entry : entries) {
+        g_scriptExecutionCache.insert(entry);
+        ++g_scriptExecutionCacheCounters.inserts;
+    }
+    LogPrintf("Loaded %u script execution cache entries from disk\n", entries.size());
+    return true;
+}
+
 /**
  * Check whether all of this transaction's input scripts succeed.
  *
@@ -1427,8 +1541,10 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
     hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
     AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
     if (g_scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
+        ++g_scriptExecutionCacheCounters.hits;
         return true;
     }
+    ++g_scriptExecutionCacheCounters.misses;
 
     if (!txdata.m_spent_outputs_ready) {
         std::vector<CTxOut> spent_outputs;
@@ -1489,6 +1605,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
         // We executed all of the provided scripts, and were told to
         // cache the result. Do so now.
         g_scriptExecutionCache.insert(hashCacheEntry);
+        ++g_scriptExecutionCacheCounters.inserts;
     }
 
     return true;
@@ -1594,16 +1711,133 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+//! Script check queue used when connecting blocks of a background chainstate.
+static CCheckQueue<CScriptCheck> bgscriptcheckqueue(128);
+
+/**
+ * Closure reading one coin from the view backing a coins cache.
+ * Reads from the chainstate database are safe to issue concurrently (unlike
+ * accesses to the cache itself), so these are run on their own check queue.
+ */
+class CCoinsPrefetchCheck
+{
+private:
+    const CCoinsView* m_view{nullptr};
+    COutPoint m_outpoint;
+    Coin* m_coin{nullptr};
+    std::atomic<int64_t>* m_read_time{nullptr};
+
+public:
+    CCoinsPrefetchCheck() {}
+    CCoinsPrefetchCheck(const CCoinsView& view, const COutPoint& outpoint, Coin& coin, std::atomic<int64_t>& read_time) :
+        m_view(&view), m_outpoint(outpoint), m_coin(&coin), m_read_time(&read_time) { }
+
+    bool operator()()
+    {
+        const int64_t time_start = GetTimeMicros();
+        if (!m_view->GetCoin(m_outpoint, *m_coin)) m_coin->Clear();
+        *m_read_time += GetTimeMicros() - time_start;
+        return true;
+    }
+
+    void swap(CCoinsPrefetchCheck& check) {
+        std::swap(m_view, check.m_view);
+        std::swap(m_outpoint, check.m_outpoint);
+        std::swap(m_coin, check.m_coin);
+        std::swap(m_read_time, check.m_read_time);
+    }
+};
+
+static CCheckQueue<CCoinsPrefetchCheck> coinprefetchqueue(16);
 
 void StartScriptCheckWorkerThreads(int threads_num)
 {
     scriptcheckqueue.StartWorkerThreads(threads_num);
+    coinprefetchqueue.StartWorkerThreads(threads_num, "coinfetch");
 }
 
 void StopScriptCheckWorkerThreads()
 {
     scriptcheckqueue.StopWorkerThreads();
+    coinprefetchqueue.StopWorkerThreads();
+}
+
+/**
+ * Collect the outpoints spent by a block's transactions (or any other set of
+ * transactions) that have to be read from the view backing a cache: those not
+ * created by the transactions themselves and, if cache is given, not already
+ * present in it.
+ */
+static std::vector<COutPoint> GetPrevoutsToFetch(const std::vector<CTransactionRef>& txs, const CCoinsViewCache* cache, CoinsPrefetchStats& stats)
+{
+    // Outputs created by the transactions themselves are never in the backing view.
+    std::unordered_set<uint256, SaltedTxidHasher> block_txids;
+    block_txids.reserve(txs.size());
+    for (const auto& tx : txs) {
+        block_txids.insert(tx->GetHash());
+    }
+
+    std::vector<COutPoint> outpoints;
+    for (const auto& tx : txs) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            ++stats.inputs;
+            if (block_txids.count(txin.prevout.hash)) {
+                ++stats.in_block;
+            } else if (cache && cache->HaveCoinInCache(txin.prevout)) {
+                ++stats.cached;
+            } else {
+                outpoints.push_back(txin.prevout);
+            }
+        }
+    }
+    return outpoints;
+}
+
+/**
+ * Read outpoints from base using the coins prefetch worker threads. Coins
+ * that are not found are left spent. Returns the summed time of the reads.
+ */
+static int64_t ReadCoins(const CCoinsView& base, const std::vector<COutPoint>& outpoints, std::vector<Coin>& coins)
+{
+    coins.assign(outpoints.size(), Coin{});
+    std::atomic<int64_t> read_time{0};
+    if (!outpoints.empty()) {
+        std::vector<CCoinsPrefetchCheck> checks;
+        checks.reserve(outpoints.size());
+        for (size_t i = 0; i < outpoints.size(); ++i) {
+            checks.emplace_back(base, outpoints[i], coins[i], read_time);
+        }
+        CCheckQueueControl<CCoinsPrefetchCheck> control(&coinprefetchqueue);
+        control.Add(checks);
+        control.Wait();
+    }
+    return read_time;
+}
+
+static CoinsPrefetchStats PrefetchTransactionInputs(const std::vector<CTransactionRef>& txs, CCoinsViewCache& cache, const CCoinsView& base)
+{
+    CoinsPrefetchStats stats;
+    const int64_t time_start = GetTimeMicros();
+
+    const std::vector<COutPoint> outpoints = GetPrevoutsToFetch(txs, &cache, stats);
+    std::vector<Coin> coins;
+    stats.read_time = ReadCoins(base, outpoints, coins);
+
+    // Only the calling thread touches the cache.
+    for (size_t i = 0; i < outpoints.size(); ++i) {
+        if (!coins[i].IsSpent() && cache.AddPrefetchedCoin(outpoints[i], std::move(coins[i]))) {
+            ++stats.fetched;
+        }
+    }
+
+    stats.time = GetTimeMicros() - time_start;
+    return stats;
+}
+
+CoinsPrefetchStats PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base)
+{
+    return PrefetchTransactionInputs(block.vtx, cache, base);
 }
 
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
@@ -1778,7 +2012,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
         //  effectively caching the result of part of the verification.
         BlockMap::const_iterator  it = m_blockman.m_block_index.find(hashAssumeValid);
         if (it != m_blockman.m_block_index.end()) {
-            if (it->second->GetAncestor(pindex->nHeight) == pindex &&
+            if (it->second.GetAncestor(pindex->nHeight) == pindex &&
                 pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
                 pindexBestHeader->nChainWork >= nMinimumChainWork) {
                 // This block is a member of the assumed verified chain and an ancestor of the best header.
@@ -1912,7 +2146,9 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // in multiple threads). Preallocate the vector size so a new allocation
     // doesn't invalidate pointers into the vector, and keep txsdata in scope
     // for as long as `control`.
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && g_parallel_script_checks ? &scriptcheckqueue : nullptr);
+    const bool parallel_script_checks = m_validates_in_background ? bgscriptcheckqueue.HasWorkerThreads() : g_parallel_script_checks;
+    CCheckQueue<CScriptCheck>& checkqueue = m_validates_in_background ? bgscriptcheckqueue : scriptcheckqueue;
+    CCheckQueueControl<CScriptCheck> control(fScriptChecks && parallel_script_checks ? &checkqueue : nullptr);
     std::vector<PrecomputedTransactionData> txsdata(block.vtx.size());
 
     std::vector<int> prevheights;
@@ -1971,7 +2207,7 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
             TxValidationState tx_state;
-            if (fScriptChecks && !CheckInputScripts(tx, tx_state, view, flags, fCacheResults, fCacheResults, txsdata[i], g_parallel_script_checks ? &vChecks : nullptr)) {
+            if (fScriptChecks && !CheckInputScripts(tx, tx_state, view, flags, fCacheResults, fCacheResults, txsdata[i], parallel_script_checks ? &vChecks : nullptr)) {
                 // Any transaction validation failure in ConnectBlock is a block consensus failure
                 state.Invalid(BlockValidationResult::BLOCK_CONSENSUS,
                               tx_state.GetRejectReason(), tx_state.GetDebugMessage());
@@ -2028,6 +2264,19 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     return true;
 }
 
+/**
+ * Space available to the coins cache: its own budget plus whatever the mempool
+ * is not currently using of its budget.
+ */
+static int64_t GetCoinsCacheTotalSpace(
+    const CTxMemPool* tx_pool,
+    size_t max_coins_cache_size_bytes,
+    size_t max_mempool_size_bytes)
+{
+    const int64_t nMempoolUsage = tx_pool ? tx_pool->DynamicMemoryUsage() : 0;
+    return max_coins_cache_size_bytes + std::max<int64_t>(max_mempool_size_bytes - nMempoolUsage, 0);
+}
+
 CoinsCacheSizeState CChainState::GetCoinsCacheSizeState(const CTxMemPool* tx_pool)
 {
     return this->GetCoinsCacheSizeState(
@@ -2041,10 +2290,8 @@ CoinsCacheSizeState CChainState::GetCoinsCacheSizeState(
     size_t max_coins_cache_size_bytes,
     size_t max_mempool_size_bytes)
 {
-    const int64_t nMempoolUsage = tx_pool ? tx_pool->DynamicMemoryUsage() : 0;
     int64_t cacheSize = CoinsTip().DynamicMemoryUsage();
-    int64_t nTotalSpace =
-        max_coins_cache_size_bytes + std::max<int64_t>(max_mempool_size_bytes - nMempoolUsage, 0);
+    int64_t nTotalSpace = GetCoinsCacheTotalSpace(tx_pool, max_coins_cache_size_bytes, max_mempool_size_bytes);
 
     //! No need to periodic flush if at least this much space still available.
     static constexpr int64_t MAX_BLOCK_COINSDB_USAGE_BYTES = 10 * 1024 * 1024;  // 10MB
@@ -2181,13 +2428,29 @@ bool CChainState::FlushStateToDisk(
                 return AbortNode(state, "Disk space is too low!", _("Disk space is too low!"));
             }
             // Flush the chainstate (which may refer to block index entries).
-            if (!CoinsTip().Flush())
-                return AbortNode(state, "Failed to write to coin database");
+            // Only wipe the cache when explicitly asked to; otherwise keep the
+            // written coins cached and, if the cache is too large, only evict
+            // enough of them to get back under the limit.
+            if (mode == FlushStateMode::ALWAYS) {
+                if (!CoinsTip().Flush())
+                    return AbortNode(state, "Failed to write to coin database");
+            } else {
+                if (!CoinsTip().Sync())
+                    return AbortNode(state, "Failed to write to coin database");
+                if (fCacheLarge || fCacheCritical) {
+                    const int64_t total_space = GetCoinsCacheTotalSpace(&m_mempool, m_coinstip_cache_size_bytes,
+                        gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000);
+                    const size_t target_usage = std::max<int64_t>(total_space * COINS_CACHE_EVICT_TARGET_PERCENT / 100, 0);
+                    const size_t evicted = CoinsTip().Evict(target_usage);
+                    LogPrint(BCLog::COINDB, "Evicted %u coins from the cache (%.2fkB left)\n",
+                        evicted, CoinsTip().DynamicMemoryUsage() / 1000.0);
+                }
+            }
             nLastFlush = nNow;
             full_flush_completed = true;
         }
     }
-    if (full_flush_completed) {
+    if (full_flush_completed && !m_validates_in_background) {
         // Update best block in wallet (so we can detect restored wallets).
         GetMainSignals().ChainStateFlushed(m_chain.GetLocator());
     }
@@ -2235,17 +2498,21 @@ static void AppendWarning(bilingual_str& res, const bilingual_str& warn)
 static void UpdateTip(CTxMemPool& mempool, const CBlockIndex* pindexNew, const CChainParams& chainParams, CChainState& active_chainstate)
     EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
 {
-    // New best block
-    mempool.AddTransactionsUpdated(1);
+    // The tip of a background chainstate is not the node's best block, and
+    // the mempool is not built on top of it.
+    if (!active_chainstate.m_validates_in_background) {
+        // New best block
+        mempool.AddTransactionsUpdated(1);
 
-    {
-        LOCK(g_best_block_mutex);
-        g_best_block = pindexNew->GetBlockHash();
-        g_best_block_cv.notify_all();
+        {
+            LOCK(g_best_block_mutex);
+            g_best_block = pindexNew->GetBlockHash();
+            g_best_block_cv.notify_all();
+        }
     }
 
     bilingual_str warning_messages;
-    if (!active_chainstate.IsInitialBlockDownload()) {
+    if (!active_chainstate.m_validates_in_background && !active_chainstate.IsInitialBlockDownload()) {
         const CBlockIndex* pindex = pindexNew;
         for (int bit = 0; bit < VERSIONBITS_NUM_BITS; bit++) {
             WarningBitsConditionChecker checker(bit);
@@ -2260,7 +2527,8 @@ static void UpdateTip(CTxMemPool& mempool, const CBlockIndex* pindexNew, const C
             }
         }
     }
-    LogPrintf("%s: new best=%s height=%d version=0x%08x log2_work=%f tx=%lu date='%s' progress=%f cache=%.1fMiB(%utxo)%s\n", __func__,
+    LogPrintf("%s: %snew best=%s height=%d version=0x%08x log2_work=%f tx=%lu date='%s' progress=%f cache=%.1fMiB(%utxo)%s\n", __func__,
+      active_chainstate.m_validates_in_background ? "[background validation] " : "",
       pindexNew->GetBlockHash().ToString(), pindexNew->nHeight, pindexNew->nVersion,
       log(pindexNew->nChainWork.getdouble())/log(2.0), (unsigned long)pindexNew->nChainTx,
       FormatISO8601DateTime(pindexNew->GetBlockTime()),
@@ -2325,16 +2593,237 @@ bool CChainState::DisconnectTip(BlockValidationState& state, DisconnectedBlockTr
     UpdateTip(m_mempool, pindexDelete->pprev, m_params, *this);
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
-    GetMainSignals().BlockDisconnected(pblock, pindexDelete);
+    if (!m_validates_in_background) GetMainSignals().BlockDisconnected(pblock, pindexDelete);
     return true;
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
+static int64_t nTimePrefetchSaved = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
 
+static int64_t nTimeLookaheadBusy = 0;
+static int64_t nTimeLookaheadStall = 0;
+static int64_t nBlocksLookahead = 0;
+static int64_t nBlocksLookaheadMissed = 0;
+
+//! How many blocks BlockLookahead prepares ahead of the one being connected.
+static constexpr size_t MAX_BLOCKS_LOOKAHEAD{8};
+
+/**
+ * Prepares the blocks ActivateBestChain() is about to connect on a separate
+ * thread, so that the work that does not depend on the chainstate overlaps
+ * with connecting the previous blocks: reading the block from disk, the
+ * context-free CheckBlock() and reading its inputs from the coins database.
+ *
+ * Blocks are connected (committed) strictly in order by the calling thread,
+ * which picks up the prepared blocks with Take().
+ */
+class BlockLookahead
+{
+public:
+    struct Job {
+        const CBlockIndex* pindex{nullptr};
+        uint256 hash;
+        FlatFilePos pos;
+        //! Set if the block is already in memory and only its inputs need to be read.
+        std::shared_ptr<const CBlock> block;
+    };
+
+    struct Prepared {
+        const CBlockIndex* pindex{nullptr};
+        //! The block, or nullptr if it could not be read or failed CheckBlock().
+        //! The block is then left for ConnectTip() to read and report on.
+        std::shared_ptr<const CBlock> block;
+        //! Inputs of the block read from the coins database, and the database
+        //! write count before they were read.
+        std::vector<COutPoint> outpoints;
+        std::vector<Coin> coins;
+        uint64_t db_write_count{0};
+        int64_t time_read{0};
+        int64_t time_check{0};
+        int64_t time_prefetch{0};
+    };
+
+    BlockLookahead(const Consensus::Params& consensus_params, const CCoinsView& coins_view, const CCoinsViewDB& coins_db)
+        : m_consensus_params(consensus_params), m_coins_view(coins_view), m_coins_db(coins_db)
+    {
+        m_thread = std::thread(&util::TraceThread, "lookahead", [this] { ThreadPrepare(); });
+    }
+
+    ~BlockLookahead()
+    {
+        WITH_LOCK(m_mutex, m_stop = true);
+        m_cond.notify_all();
+        m_thread.join();
+    }
+
+    /**
+     * Set the blocks about to be connected, in connection order. Blocks that
+     * are already prepared or being prepared are not prepared again; pending
+     * jobs for blocks no longer in the list are dropped.
+     */
+    void Schedule(const std::vector<Job>& jobs)
+    {
+        {
+            LOCK(m_mutex);
+            m_jobs.clear();
+            for (const Job& job : jobs) {
+                if (job.pindex == m_working) continue;
+                if (std::any_of(m_ready.begin(), m_ready.end(), [&](const Prepared& p) { return p.pindex == job.pindex; })) continue;
+                m_jobs.push_back(job);
+            }
+        }
+        m_cond.notify_all();
+    }
+
+    /**
+     * Get the prepared block pindex, waiting for it if it is being or about to
+     * be prepared. Returns nothing if pindex was not scheduled. Blocks prepared
+     * before pindex are discarded.
+     */
+    std::optional<Prepared> Take(const CBlockIndex* pindex, int64_t& stall_time)
+    {
+        const int64_t time_start = GetTimeMicros();
+        WAIT_LOCK(m_mutex, lock);
+        while (true) {
+            for (auto it = m_ready.begin(); it != m_ready.end(); ++it) {
+                if (it->pindex != pindex) continue;
+                std::optional<Prepared> prepared{std::move(*it)};
+                m_ready.erase(m_ready.begin(), std::next(it));
+                m_cond.notify_all();
+                stall_time = GetTimeMicros() - time_start;
+                return prepared;
+            }
+            if (m_working != pindex && (m_jobs.empty() || m_jobs.front().pindex != pindex)) {
+                stall_time = GetTimeMicros() - time_start;
+                return std::nullopt;
+            }
+            // Anything prepared so far precedes pindex and will not be used.
+            m_ready.clear();
+            m_cond.notify_all();
+            m_cond.wait(lock);
+        }
+    }
+
+    /**
+     * Add the inputs read for a prepared block to the coins cache, unless the
+     * coins database was written to since they were read: the entries the
+     * cache held for them may have been flushed, and the coins read stale.
+     * Returns how many coins were added.
+     */
+    size_t AddCoins(Prepared& prepared, CCoinsViewCache& cache) const
+    {
+        if (prepared.db_write_count != m_coins_db.WriteCount()) return 0;
+        size_t added{0};
+        for (size_t i = 0; i < prepared.outpoints.size(); ++i) {
+            if (!prepared.coins[i].IsSpent() && cache.AddPrefetchedCoin(prepared.outpoints[i], std::move(prepared.coins[i]))) {
+                ++added;
+            }
+        }
+        return added;
+    }
+
+private:
+    void ThreadPrepare()
+    {
+        while (true) {
+            Job job;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                    return m_stop || (!m_jobs.empty() && m_ready.size() < MAX_BLOCKS_LOOKAHEAD);
+                });
+                if (m_stop) return;
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+                m_working = job.pindex;
+            }
+            Prepared prepared{Prepare(job)};
+            {
+                LOCK(m_mutex);
+                m_working = nullptr;
+                m_ready.push_back(std::move(prepared));
+            }
+            m_cond.notify_all();
+        }
+    }
+
+    Prepared Prepare(const Job& job) const
+    {
+        Prepared prepared;
+        prepared.pindex = job.pindex;
+
+        int64_t time_start = GetTimeMicros();
+        std::shared_ptr<const CBlock> block = job.block;
+        if (!block) {
+            // This thread owns the block until it is handed over, so it is
+            // safe to run CheckBlock() (which caches its result in fChecked).
+            auto block_new = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*block_new, job.pos, m_consensus_params) || block_new->GetHash() != job.hash) {
+                return prepared;
+            }
+            prepared.time_read = GetTimeMicros() - time_start;
+            time_start = GetTimeMicros();
+            BlockValidationState state;
+            if (!CheckBlock(*block_new, state, m_consensus_params)) {
+                return prepared;
+            }
+            prepared.time_check = GetTimeMicros() - time_start;
+            block = std::move(block_new);
+        }
+
+        time_start = GetTimeMicros();
+        prepared.db_write_count = m_coins_db.WriteCount();
+        CoinsPrefetchStats stats;
+        prepared.outpoints = GetPrevoutsToFetch(block->vtx, nullptr, stats);
+        ReadCoins(m_coins_view, prepared.outpoints, prepared.coins);
+        prepared.time_prefetch = GetTimeMicros() - time_start;
+        prepared.block = std::move(block);
+        return prepared;
+    }
+
+    const Consensus::Params& m_consensus_params;
+    //! View the inputs are read from; must be safe for concurrent reads.
+    const CCoinsView& m_coins_view;
+    const CCoinsViewDB& m_coins_db;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Job> m_jobs GUARDED_BY(m_mutex);
+    std::deque<Prepared> m_ready GUARDED_BY(m_mutex);
+    //! Block being prepared by the thread, if any.
+    const CBlockIndex* m_working GUARDED_BY(m_mutex){nullptr};
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+};
+
+/**
+ * The next blocks ActivateBestChain() will connect on its way from the tip of
+ * chain to pindex_most_work, as far as their data is available.
+ */
+static std::vector<BlockLookahead::Job> GetLookaheadJobs(const CChain& chain, const CBlockIndex* pindex_most_work, const std::shared_ptr<const CBlock>& pblock) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const CBlockIndex* pindex_fork = chain.FindFork(pindex_most_work);
+    const int height_fork = pindex_fork ? pindex_fork->nHeight : -1;
+    const int height_end = std::min<int>(pindex_most_work->nHeight, height_fork + 1 + MAX_BLOCKS_LOOKAHEAD);
+
+    std::vector<BlockLookahead::Job> jobs;
+    for (const CBlockIndex* pindex = pindex_most_work->GetAncestor(height_end); pindex && pindex->nHeight > height_fork; pindex = pindex->pprev) {
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            jobs.clear();
+            continue;
+        }
+        const bool have_block = pindex == pindex_most_work && pblock && pblock->GetHash() == pindex->GetBlockHash();
+        jobs.push_back({pindex, pindex->GetBlockHash(), pindex->GetBlockPos(), have_block ? pblock : nullptr});
+    }
+    std::reverse(jobs.begin(), jobs.end());
+    return jobs;
+}
+
 struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
     std::shared_ptr<const CBlock> pblock;
@@ -2404,10 +2893,22 @@ bool CChainState::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    // Warm the coins cache with the block's inputs using the worker threads,
+    // rather than have ConnectBlock() read them from disk one at a time.
+    if (g_parallel_script_checks) {
+        const CoinsPrefetchStats prefetch = PrefetchBlockInputs(blockConnecting, CoinsTip(), CoinsErrorCatcher());
+        const int64_t saved = prefetch.read_time - prefetch.time;
+        nTimePrefetch += prefetch.time;
+        nTimePrefetchSaved += saved;
+        LogPrint(BCLog::BENCH, "  - Prefetch %u txins: %.2fms (%u in block, %u cached (%.1f%%), %u fetched, %.2fms saved) [%.2fs, %.2fs saved]\n",
+                 prefetch.inputs, prefetch.time * MILLI, prefetch.in_block, prefetch.cached,
+                 prefetch.inputs == 0 ? 0.0 : 100.0 * prefetch.cached / prefetch.inputs, prefetch.fetched,
+                 saved * MILLI, nTimePrefetch * MICRO, nTimePrefetchSaved * MICRO);
+    }
     {
         CCoinsViewCache view(&CoinsTip());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view);
-        GetMainSignals().BlockChecked(blockConnecting, state);
+        if (!m_validates_in_background) GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
                 InvalidBlockFound(pindexNew, state);
@@ -2427,8 +2928,9 @@ bool CChainState::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew
     }
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
     LogPrint(BCLog::BENCH, "  - Writing chainstate: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime5 - nTime4) * MILLI, nTimeChainState * MICRO, nTimeChainState * MILLI / nBlocksTotal);
-    // Remove conflicting transactions from the mempool.;
-    m_mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
+    // Remove conflicting transactions from the mempool, which only follows
+    // the active chainstate.
+    if (!m_validates_in_background) m_mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
     disconnectpool.removeForBlock(blockConnecting.vtx);
     // Update m_chain & related variables.
     m_chain.SetTip(pindexNew);
@@ -2519,7 +3021,7 @@ void CChainState::PruneBlockIndexCandidates() {
  *
  * @returns true unless a system error occurred
  */
-bool CChainState::ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace)
+bool CChainState::ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace, BlockLookahead* lookahead)
 {
     AssertLockHeld(cs_main);
     AssertLockHeld(m_mempool.cs);
@@ -2531,7 +3033,7 @@ bool CChainState::ActivateBestChainStep(BlockValidationState& state, CBlockIndex
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool;
     while (m_chain.Tip() && m_chain.Tip() != pindexFork) {
-        if (!DisconnectTip(state, &disconnectpool)) {
+        if (!DisconnectTip(state, m_validates_in_background ? nullptr : &disconnectpool)) {
             // This is likely a fatal error, but keep the mempool consistent,
             // just in case. Only remove from the mempool in this case.
             UpdateMempoolForReorg(*this, m_mempool, disconnectpool, false);
@@ -2564,7 +3066,26 @@ bool CChainState::ActivateBestChainStep(BlockValidationState& state, CBlockIndex
 
         // Connect new blocks.
         for (CBlockIndex* pindexConnect : reverse_iterate(vpindexToConnect)) {
-            if (!ConnectTip(state, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+            std::shared_ptr<const CBlock> pblockConnect = pindexConnect == pindexMostWork ? pblock : nullptr;
+            if (lookahead) {
+                // Pick up the block (and its inputs) prepared while the
+                // previous blocks were being connected.
+                int64_t stall_time{0};
+                std::optional<BlockLookahead::Prepared> prepared = lookahead->Take(pindexConnect, stall_time);
+                nTimeLookaheadStall += stall_time;
+                if (prepared && prepared->block) {
+                    if (!pblockConnect) pblockConnect = prepared->block;
+                    const size_t added = lookahead->AddCoins(*prepared, CoinsTip());
+                    nTimeLookaheadBusy += prepared->time_read + prepared->time_check + prepared->time_prefetch;
+                    ++nBlocksLookahead;
+                    LogPrint(BCLog::BENCH, "  - Lookahead: %.2fms read, %.2fms check, %.2fms prefetch (%u of %u coins used), %.2fms stalled [%.2fs busy, %.2fs stalled, %d prepared, %d missed]\n",
+                             prepared->time_read * MILLI, prepared->time_check * MILLI, prepared->time_prefetch * MILLI, added, prepared->outpoints.size(),
+                             stall_time * MILLI, nTimeLookaheadBusy * MICRO, nTimeLookaheadStall * MICRO, nBlocksLookahead, nBlocksLookaheadMissed);
+                } else {
+                    ++nBlocksLookaheadMissed;
+                }
+            }
+            if (!ConnectTip(state, pindexConnect, pblockConnect, connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (state.GetResult() != BlockValidationResult::BLOCK_MUTATED) {
@@ -2597,7 +3118,7 @@ bool CChainState::ActivateBestChainStep(BlockValidationState& state, CBlockIndex
         // any disconnected transactions back to the mempool.
         UpdateMempoolForReorg(*this, m_mempool, disconnectpool, true);
     }
-    m_mempool.check(*this);
+    if (!m_validates_in_background) m_mempool.check(*this);
 
     CheckForkWarningConditions();
 
@@ -2658,6 +3179,8 @@ bool CChainState::ActivateBestChain(BlockValidationState& state, std::shared_ptr
     CBlockIndex *pindexMostWork = nullptr;
     CBlockIndex *pindexNewTip = nullptr;
     int nStopAtHeight = gArgs.GetArg("-stopatheight", DEFAULT_STOPATHEIGHT);
+    // Started once there is more than one block to connect.
+    std::optional<BlockLookahead> lookahead;
     do {
         // Block until the validation queue drains. This should largely
         // never happen in normal operation, however may happen during
@@ -2686,9 +3209,15 @@ bool CChainState::ActivateBestChain(BlockValidationState& state, std::shared_ptr
                     break;
                 }
 
+                const std::vector<BlockLookahead::Job> lookahead_jobs = GetLookaheadJobs(m_chain, pindexMostWork, pblock);
+                if (lookahead || lookahead_jobs.size() > 1) {
+                    if (!lookahead) lookahead.emplace(m_params.GetConsensus(), CoinsErrorCatcher(), CoinsDB());
+                    lookahead->Schedule(lookahead_jobs);
+                }
+
                 bool fInvalidFound = false;
                 std::shared_ptr<const CBlock> nullBlockPtr;
-                if (!ActivateBestChainStep(state, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace)) {
+                if (!ActivateBestChainStep(state, pindexMostWork, pblock && pblock->GetHash() == pindexMostWork->GetBlockHash() ? pblock : nullBlockPtr, fInvalidFound, connectTrace, lookahead ? &*lookahead : nullptr)) {
                     // A system error occurred
                     return false;
                 }
@@ -2700,9 +3229,11 @@ bool CChainState::ActivateBestChain(BlockValidationState& state, std::shared_ptr
                 }
                 pindexNewTip = m_chain.Tip();
 
+                // Blocks connected by a background chainstate are history below
+                // the active tip, so they are not announced to subscribers.
                 for (const PerBlockConnectTrace& trace : connectTrace.GetBlocksConnected()) {
                     assert(trace.pblock && trace.pindex);
-                    GetMainSignals().BlockConnected(trace.pblock, trace.pindex);
+                    if (!m_validates_in_background) GetMainSignals().BlockConnected(trace.pblock, trace.pindex);
                 }
             } while (!m_chain.Tip() || (starting_tip && CBlockIndexWorkComparator()(m_chain.Tip(), starting_tip)));
             if (!blocks_connected) return true;
@@ -2712,7 +3243,7 @@ bool CChainState::ActivateBestChain(BlockValidationState& state, std::shared_ptr
 
             // Notify external listeners about the new tip.
             // Enqueue while holding cs_main to ensure that UpdatedBlockTip is called in the order in which blocks are connected
-            if (pindexFork != pindexNewTip) {
+            if (pindexFork != pindexNewTip && !m_validates_in_background) {
                 // Notify ValidationInterface subscribers
                 GetMainSignals().UpdatedBlockTip(pindexNewTip, pindexFork, fInitialDownload);
 
@@ -2795,8 +3326,8 @@ bool CChainState::InvalidateBlock(BlockValidationState& state, CBlockIndex* pind
 
     {
         LOCK(cs_main);
-        for (const auto& entry : m_blockman.m_block_index) {
-            CBlockIndex *candidate = entry.second;
+        for (auto& entry : m_blockman.m_block_index) {
+            CBlockIndex *candidate = &entry.second;
             // We don't need to put anything in our active chain into the
             // multimap, because those candidates will be found and considered
             // as we disconnect.
@@ -2893,8 +3424,8 @@ bool CChainState::InvalidateBlock(BlockValidationState& state, CBlockIndex* pind
         // to setBlockIndexCandidates.
         BlockMap::iterator it = m_blockman.m_block_index.begin();
         while (it != m_blockman.m_block_index.end()) {
-            if (it->second->IsValid(BLOCK_VALID_TRANSACTIONS) && it->second->HaveTxsDownloaded() && !setBlockIndexCandidates.value_comp()(it->second, m_chain.Tip())) {
-                setBlockIndexCandidates.insert(it->second);
+            if (it->second.IsValid(BLOCK_VALID_TRANSACTIONS) && it->second.HaveTxsDownloaded() && !setBlockIndexCandidates.value_comp()(&it->second, m_chain.Tip())) {
+                setBlockIndexCandidates.insert(&it->second);
             }
             it++;
         }
@@ -2917,17 +3448,17 @@ void CChainState::ResetBlockFailureFlags(CBlockIndex *pindex) {
     // Remove the invalidity flag from this block and all its descendants.
     BlockMap::iterator it = m_blockman.m_block_index.begin();
     while (it != m_blockman.m_block_index.end()) {
-        if (!it->second->IsValid() && it->second->GetAncestor(nHeight) == pindex) {
-            it->second->nStatus &= ~BLOCK_FAILED_MASK;
-            setDirtyBlockIndex.insert(it->second);
-            if (it->second->IsValid(BLOCK_VALID_TRANSACTIONS) && it->second->HaveTxsDownloaded() && setBlockIndexCandidates.value_comp()(m_chain.Tip(), it->second)) {
-                setBlockIndexCandidates.insert(it->second);
+        if (!it->second.IsValid() && it->second.GetAncestor(nHeight) == pindex) {
+            it->second.nStatus &= ~BLOCK_FAILED_MASK;
+            setDirtyBlockIndex.insert(&it->second);
+            if (it->second.IsValid(BLOCK_VALID_TRANSACTIONS) && it->second.HaveTxsDownloaded() && setBlockIndexCandidates.value_comp()(m_chain.Tip(), &it->second)) {
+                setBlockIndexCandidates.insert(&it->second);
             }
-            if (it->second == pindexBestInvalid) {
+            if (&it->second == pindexBestInvalid) {
                 // Reset invalid block marker if it was pointing to one of those.
                 pindexBestInvalid = nullptr;
             }
-            m_blockman.m_failed_blocks.erase(it->second);
+            m_blockman.m_failed_blocks.erase(&it->second);
         }
         it++;
     }
@@ -2951,20 +3482,20 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
     uint256 hash = block.GetHash();
     BlockMap::iterator it = m_block_index.find(hash);
     if (it != m_block_index.end())
-        return it->second;
+        return &it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    BlockMap::iterator mi = m_block_index.emplace(std::piecewise_construct, std::forward_as_tuple(hash), std::forward_as_tuple(block)).first;
+    CBlockIndex* pindexNew = &(*mi).second;
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
     pindexNew->nSequenceId = 0;
-    BlockMap::iterator mi = m_block_index.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
     BlockMap::iterator miPrev = m_block_index.find(block.hashPrevBlock);
     if (miPrev != m_block_index.end())
     {
-        pindexNew->pprev = (*miPrev).second;
+        pindexNew->pprev = &(*miPrev).second;
         pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
         pindexNew->BuildSkip();
     }
@@ -3318,7 +3849,7 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationS
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
         if (miSelf != m_block_index.end()) {
             // Block header is already known.
-            CBlockIndex* pindex = miSelf->second;
+            CBlockIndex* pindex = &miSelf->second;
             if (ppindex)
                 *ppindex = pindex;
             if (pindex->nStatus & BLOCK_FAILED_MASK) {
@@ -3340,7 +3871,7 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationS
             LogPrintf("ERROR: %s: prev block not found\n", __func__);
             return state.Invalid(BlockValidationResult::BLOCK_MISSING_PREV, "prev-blk-not-found");
         }
-        pindexPrev = (*mi).second;
+        pindexPrev = &(*mi).second;
         if (pindexPrev->nStatus & BLOCK_FAILED_MASK) {
             LogPrintf("ERROR: %s: prev block invalid\n", __func__);
             return state.Invalid(BlockValidationResult::BLOCK_INVALID_PREV, "bad-prevblk");
@@ -3506,9 +4037,30 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, Block
     return true;
 }
 
+/**
+ * Marks the active chainstate as busy processing a block for as long as it is
+ * in scope, so that background validation backs off.
+ */
+class ActiveBlockProcessing
+{
+    ChainstateManager& m_chainman;
+
+public:
+    explicit ActiveBlockProcessing(ChainstateManager& chainman) : m_chainman(chainman)
+    {
+        ++m_chainman.m_active_block_processing;
+    }
+    ~ActiveBlockProcessing()
+    {
+        m_chainman.m_active_block_processed_time = GetTimeMicros();
+        --m_chainman.m_active_block_processing;
+    }
+};
+
 bool ChainstateManager::ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock>& block, bool force_processing, bool* new_block)
 {
     AssertLockNotHeld(cs_main);
+    ActiveBlockProcessing active_block_processing{*this};
 
     {
         CBlockIndex *pindex = nullptr;
@@ -3586,8 +4138,8 @@ void BlockManager::PruneOneBlockFile(const int fileNumber)
     AssertLockHeld(cs_main);
     LOCK(cs_LastBlockFile);
 
-    for (const auto& entry : m_block_index) {
-        CBlockIndex* pindex = entry.second;
+    for (auto& entry : m_block_index) {
+        CBlockIndex* pindex = &entry.second;
         if (pindex->nFile == fileNumber) {
             pindex->nStatus &= ~BLOCK_HAVE_DATA;
             pindex->nStatus &= ~BLOCK_HAVE_UNDO;
@@ -3717,11 +4269,11 @@ CBlockIndex * BlockManager::InsertBlockIndex(const uint256& hash)
     // Return existing
     BlockMap::iterator mi = m_block_index.find(hash);
     if (mi != m_block_index.end())
-        return (*mi).second;
+        return &(*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    mi = m_block_index.insert(std::make_pair(hash, pindexNew)).first;
+    mi = m_block_index.emplace(std::piecewise_construct, std::forward_as_tuple(hash), std::forward_as_tuple()).first;
+    CBlockIndex* pindexNew = &(*mi).second;
     pindexNew->phashBlock = &((*mi).first);
 
     return pindexNew;
@@ -3735,19 +4287,39 @@ bool BlockManager::LoadBlockIndex(
     if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
         return false;
 
-    // Calculate nChainWork
-    std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
-    vSortedByHeight.reserve(m_block_index.size());
-    for (const std::pair<const uint256, CBlockIndex*>& item : m_block_index)
-    {
-        CBlockIndex* pindex = item.second;
-        vSortedByHeight.push_back(std::make_pair(pindex->nHeight, pindex));
+    // Calculate nChainWork. Every entry's ancestors are in the index too, so
+    // heights are dense and the entries are put in height order with a
+    // counting sort rather than a comparison sort. A corrupt index may break
+    // that; then fall back to the comparison sort.
+    int min_height{0};
+    int max_height{-1};
+    for (const std::pair<const uint256, CBlockIndex>& item : m_block_index) {
+        min_height = std::min(min_height, item.second.nHeight);
+        max_height = std::max(max_height, item.second.nHeight);
+    }
+    std::vector<CBlockIndex*> vSortedByHeight;
+    if (min_height >= 0 && (max_height < 0 || static_cast<size_t>(max_height) < m_block_index.size())) {
+        std::vector<size_t> height_offsets(max_height + 2, 0);
+        for (const std::pair<const uint256, CBlockIndex>& item : m_block_index) {
+            ++height_offsets[item.second.nHeight + 1];
+        }
+        std::partial_sum(height_offsets.begin(), height_offsets.end(), height_offsets.begin());
+        vSortedByHeight.resize(m_block_index.size());
+        for (std::pair<const uint256, CBlockIndex>& item : m_block_index) {
+            vSortedByHeight[height_offsets[item.second.nHeight]++] = &item.second;
+        }
+    } else {
+        LogPrintf("%s: block index heights range from %d to %d for %u entries\n", __func__, min_height, max_height, m_block_index.size());
+        vSortedByHeight.reserve(m_block_index.size());
+        for (std::pair<const uint256, CBlockIndex>& item : m_block_index) {
+            vSortedByHeight.push_back(&item.second);
+        }
+        std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
+                  [](const CBlockIndex* a, const CBlockIndex* b) { return a->nHeight < b->nHeight; });
     }
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
-    for (const std::pair<int, CBlockIndex*>& item : vSortedByHeight)
+    for (CBlockIndex* pindex : vSortedByHeight)
     {
         if (ShutdownRequested()) return false;
-        CBlockIndex* pindex = item.second;
         pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
         pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
         // We can link the chain of blocks for which we've received transactions at some point.
@@ -3786,10 +4358,6 @@ void BlockManager::Unload() {
     m_failed_blocks.clear();
     m_blocks_unlinked.clear();
 
-    for (const BlockMap::value_type& entry : m_block_index) {
-        delete entry.second;
-    }
-
     m_block_index.clear();
 }
 
@@ -3821,8 +4389,8 @@ bool CChainState::LoadBlockIndexDB()
     // Check presence of blk files
     LogPrintf("Checking all blk files are present...\n");
     std::set<int> setBlkDataFiles;
-    for (const std::pair<const uint256, CBlockIndex*>& item : m_blockman.m_block_index) {
-        CBlockIndex* pindex = item.second;
+    for (const std::pair<const uint256, CBlockIndex>& item : m_blockman.m_block_index) {
+        const CBlockIndex* pindex = &item.second;
         if (pindex->nStatus & BLOCK_HAVE_DATA) {
             setBlkDataFiles.insert(pindex->nFile);
         }
@@ -4046,13 +4614,13 @@ bool CChainState::ReplayBlocks()
     if (m_blockman.m_block_index.count(hashHeads[0]) == 0) {
         return error("ReplayBlocks(): reorganization to unknown block requested");
     }
-    pindexNew = m_blockman.m_block_index[hashHeads[0]];
+    pindexNew = m_blockman.LookupBlockIndex(hashHeads[0]);
 
     if (!hashHeads[1].IsNull()) { // The old tip is allowed to be 0, indicating it's the first flush.
         if (m_blockman.m_block_index.count(hashHeads[1]) == 0) {
             return error("ReplayBlocks(): reorganization from unknown block requested");
         }
-        pindexOld = m_blockman.m_block_index[hashHeads[1]];
+        pindexOld = m_blockman.LookupBlockIndex(hashHeads[1]);
         pindexFork = LastCommonAncestor(pindexOld, pindexNew);
         assert(pindexFork != nullptr);
     }
@@ -4185,10 +4753,195 @@ bool CChainState::LoadGenesisBlock()
     return true;
 }
 
+/** A block read from a block file before its parent was known. */
+struct UnknownParentBlock {
+    FlatFilePos pos;
+    //! The block itself, if it fit in g_external_block_budget when it was
+    //! read. Otherwise it is read from disk again once its parent is known.
+    std::shared_ptr<const CBlock> block;
+};
+
+// Blocks with unknown parent, by parent hash (only used for reindex)
+static std::multimap<uint256, UnknownParentBlock> mapBlocksUnknownParent;
+
+ExternalBlockBudget g_external_block_budget;
+
+bool ExternalBlockBudget::TryReserve(size_t bytes)
+{
+    LOCK(m_mutex);
+    if (m_bytes + bytes > MAX_BYTES) return false;
+    m_bytes += bytes;
+    return true;
+}
+
+bool ExternalBlockBudget::Reserve(size_t bytes, int file_number)
+{
+    WAIT_LOCK(m_mutex, lock);
+    m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+        return !m_reading_ahead || file_number <= m_next_file || m_bytes + bytes <= MAX_BYTES;
+    });
+    if (!m_reading_ahead) return false;
+    m_bytes += bytes;
+    return true;
+}
+
+void ExternalBlockBudget::Release(size_t bytes)
+{
+    {
+        LOCK(m_mutex);
+        assert(m_bytes >= bytes);
+        m_bytes -= bytes;
+    }
+    m_cond.notify_all();
+}
+
+void ExternalBlockBudget::StartReadAhead(int file_number)
+{
+    LOCK(m_mutex);
+    m_next_file = file_number;
+    m_reading_ahead = true;
+}
+
+void ExternalBlockBudget::SetNextFile(int file_number)
+{
+    WITH_LOCK(m_mutex, m_next_file = file_number);
+    m_cond.notify_all();
+}
+
+void ExternalBlockBudget::StopReadAhead()
+{
+    WITH_LOCK(m_mutex, m_reading_ahead = false);
+    m_cond.notify_all();
+}
+
+/**
+ * Find and deserialize the next block in a block file, starting the search
+ * for the message start at nRewind. Returns nullptr once no further block
+ * can be found.
+ */
+static std::shared_ptr<CBlock> ReadNextExternalBlock(CBufferedFile& blkdat, uint64_t& nRewind, const CChainParams& params, uint64_t& nBlockPos)
+{
+    while (!blkdat.eof()) {
+        if (ShutdownRequested()) return nullptr;
+
+        blkdat.SetPos(nRewind);
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+            blkdat.FindByte(params.MessageStart()[0]);
+            nRewind = blkdat.GetPos()+1;
+            blkdat >> buf;
+            if (memcmp(buf, params.MessageStart(), CMessageHeader::MESSAGE_START_SIZE)) {
+                continue;
+            }
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            return nullptr;
+        }
+        try {
+            // read block
+            nBlockPos = blkdat.GetPos();
+            blkdat.SetLimit(nBlockPos + nSize);
+            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+            blkdat >> *pblock;
+            nRewind = blkdat.GetPos();
+            return pblock;
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+    return nullptr;
+}
+
+bool CChainState::ProcessExternalBlock(const std::shared_ptr<const CBlock>& pblock, const uint256& hash, const FlatFilePos* dbp, int& nLoaded)
+{
+    const CBlock& block = *pblock;
+    {
+        LOCK(cs_main);
+        // detect out of order blocks, and store them for later
+        if (hash != m_params.GetConsensus().hashGenesisBlock && !m_blockman.LookupBlockIndex(block.hashPrevBlock)) {
+            LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                    block.hashPrevBlock.ToString());
+            if (dbp) {
+                UnknownParentBlock unknown_parent{*dbp, nullptr};
+                if (g_external_block_budget.TryReserve(::GetSerializeSize(block, PROTOCOL_VERSION))) {
+                    unknown_parent.block = pblock;
+                }
+                mapBlocksUnknownParent.emplace(block.hashPrevBlock, std::move(unknown_parent));
+            }
+            return true;
+        }
+
+        // process in case the block isn't known yet
+        CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
+        if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
+          BlockValidationState state;
+          if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr)) {
+              nLoaded++;
+          }
+          if (state.IsError()) {
+              return false;
+          }
+        } else if (hash != m_params.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
+            LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
+        }
+    }
+
+    // Activate the genesis block so normal node progress can continue
+    if (hash == m_params.GetConsensus().hashGenesisBlock) {
+        BlockValidationState state;
+        if (!ActivateBestChain(state, nullptr)) {
+            return false;
+        }
+    }
+
+    NotifyHeaderTip(*this);
+
+    // Recursively process earlier encountered successors of this block
+    std::deque<uint256> queue;
+    queue.push_back(hash);
+    while (!queue.empty()) {
+        uint256 head = queue.front();
+        queue.pop_front();
+        auto range = mapBlocksUnknownParent.equal_range(head);
+        while (range.first != range.second) {
+            auto it = range.first;
+            std::shared_ptr<const CBlock> pblockrecursive = it->second.block;
+            if (pblockrecursive) {
+                g_external_block_budget.Release(::GetSerializeSize(*pblockrecursive, PROTOCOL_VERSION));
+            } else {
+                std::shared_ptr<CBlock> pblockread = std::make_shared<CBlock>();
+                if (ReadBlockFromDisk(*pblockread, it->second.pos, m_params.GetConsensus())) {
+                    pblockrecursive = std::move(pblockread);
+                }
+            }
+            if (pblockrecursive) {
+                LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                        head.ToString());
+                LOCK(cs_main);
+                BlockValidationState dummy;
+                if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &it->second.pos, nullptr)) {
+                    nLoaded++;
+                    queue.push_back(pblockrecursive->GetHash());
+                }
+            }
+            range.first++;
+            mapBlocksUnknownParent.erase(it);
+            NotifyHeaderTip(*this);
+        }
+    }
+    return true;
+}
+
 void CChainState::LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
@@ -4196,103 +4949,12 @@ void CChainState::LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            if (ShutdownRequested()) return;
-
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
+        uint64_t nBlockPos = 0;
+        while (std::shared_ptr<CBlock> pblock = ReadNextExternalBlock(blkdat, nRewind, m_params, nBlockPos)) {
+            if (dbp)
+                dbp->nPos = nBlockPos;
             try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(m_params.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, m_params.MessageStart(), CMessageHeader::MESSAGE_START_SIZE)) {
-                    continue;
-                }
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
-                {
-                    LOCK(cs_main);
-                    // detect out of order blocks, and store them for later
-                    if (hash != m_params.GetConsensus().hashGenesisBlock && !m_blockman.LookupBlockIndex(block.hashPrevBlock)) {
-                        LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                        continue;
-                    }
-
-                    // process in case the block isn't known yet
-                    CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
-                    if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
-                      BlockValidationState state;
-                      if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr)) {
-                          nLoaded++;
-                      }
-                      if (state.IsError()) {
-                          break;
-                      }
-                    } else if (hash != m_params.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
-                        LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
-                    }
-                }
-
-                // Activate the genesis block so normal node progress can continue
-                if (hash == m_params.GetConsensus().hashGenesisBlock) {
-                    BlockValidationState state;
-                    if (!ActivateBestChain(state, nullptr)) {
-                        break;
-                    }
-                }
-
-                NotifyHeaderTip(*this);
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, FlatFilePos>::iterator, std::multimap<uint256, FlatFilePos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, FlatFilePos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, m_params.GetConsensus())) {
-                            LogPrint(BCLog::REINDEX, "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            BlockValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, nullptr, true, &it->second, nullptr)) {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
-                            }
-                        }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip(*this);
-                    }
-                }
+                if (!ProcessExternalBlock(pblock, pblock->GetHash(), dbp, nLoaded)) break;
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
@@ -4303,6 +4965,46 @@ void CChainState::LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp)
     LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
 }
 
+std::vector<ExternalBlock> ReadExternalBlockFile(FILE* file, int file_number, const CChainParams& params)
+{
+    std::vector<ExternalBlock> blocks;
+    try {
+        // This takes over file and calls fclose() on it in the CBufferedFile destructor
+        CBufferedFile blkdat(file, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
+        uint64_t nRewind = blkdat.GetPos();
+        uint64_t nBlockPos = 0;
+        while (std::shared_ptr<CBlock> pblock = ReadNextExternalBlock(blkdat, nRewind, params, nBlockPos)) {
+            // Blocks failing the checks are still imported, so that they are
+            // rejected (and marked invalid) the same way as when read serially.
+            BlockValidationState state;
+            CheckBlock(*pblock, state, params.GetConsensus());
+            const uint256 hash{pblock->GetHash()};
+            const size_t size{::GetSerializeSize(*pblock, PROTOCOL_VERSION)};
+            if (!g_external_block_budget.Reserve(size, file_number)) break;
+            blocks.push_back({std::move(pblock), hash, FlatFilePos(file_number, nBlockPos), size});
+        }
+    } catch (const std::runtime_error& e) {
+        AbortNode(std::string("System error: ") + e.what());
+    }
+    return blocks;
+}
+
+void CChainState::LoadExternalBlocks(const std::vector<ExternalBlock>& blocks)
+{
+    int64_t nStart = GetTimeMillis();
+
+    int nLoaded = 0;
+    for (const ExternalBlock& external : blocks) {
+        if (ShutdownRequested()) return;
+        try {
+            if (!ProcessExternalBlock(external.block, external.hash, &external.pos, nLoaded)) break;
+        } catch (const std::exception& e) {
+            LogPrintf("%s: I/O error - %s\n", __func__, e.what());
+        }
+    }
+    LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
+}
+
 void CChainState::CheckBlockIndex()
 {
     if (!fCheckBlockIndex) {
@@ -4321,8 +5023,8 @@ void CChainState::CheckBlockIndex()
 
     // Build forward-pointing map of the entire block tree.
     std::multimap<CBlockIndex*,CBlockIndex*> forward;
-    for (const std::pair<const uint256, CBlockIndex*>& entry : m_blockman.m_block_index) {
-        forward.insert(std::make_pair(entry.second->pprev, entry.second));
+    for (std::pair<const uint256, CBlockIndex>& entry : m_blockman.m_block_index) {
+        forward.insert(std::make_pair(entry.second.pprev, &entry.second));
     }
 
     assert(forward.size() == m_blockman.m_block_index.size());
@@ -4528,6 +5230,111 @@ bool CChainState::ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
 
+/** Number of transactions from mempool.dat that are prepared and accepted together */
+static constexpr size_t MEMPOOL_LOAD_BATCH_SIZE{1000};
+
+namespace {
+/** A transaction read from mempool.dat that has not expired */
+struct MempoolDumpEntry {
+    CTransactionRef tx;
+    int64_t time;
+};
+} // namespace
+
+/**
+ * Reorder entries so that transactions come after the transactions in the
+ * list whose outputs they spend, and otherwise keep their order. mempool.dat
+ * is written in such an order already, but it is not relied on.
+ */
+static void SortTopologically(std::vector<MempoolDumpEntry>& entries)
+{
+    std::unordered_map<uint256, size_t, SaltedTxidHasher> index;
+    index.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        index.emplace(entries[i].tx->GetHash(), i);
+    }
+
+    std::vector<MempoolDumpEntry> sorted;
+    sorted.reserve(entries.size());
+    std::vector<bool> visited(entries.size(), false);
+    // Depth-first search that emits parents before their children. Each
+    // stack item is an entry and the number of its inputs visited so far.
+    std::vector<std::pair<size_t, size_t>> stack;
+    for (size_t root = 0; root < entries.size(); ++root) {
+        if (visited[root]) continue;
+        visited[root] = true;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            const size_t i = stack.back().first;
+            const CTransaction& tx = *entries[i].tx;
+            const size_t input = stack.back().second++;
+            if (input < tx.vin.size()) {
+                const auto parent = index.find(tx.vin[input].prevout.hash);
+                if (parent != index.end() && !visited[parent->second]) {
+                    visited[parent->second] = true;
+                    stack.emplace_back(parent->second, 0);
+                }
+            } else {
+                sorted.push_back(std::move(entries[i]));
+                stack.pop_back();
+            }
+        }
+    }
+    entries = std::move(sorted);
+}
+
+/**
+ * Prepare transactions that are about to be accepted to the mempool: read
+ * their inputs from the coins database into the coins cache, and verify their
+ * scripts on the script check threads. The valid signatures end up in the
+ * signature cache, so accepting the transactions one by one afterwards does
+ * not verify them again. Failures are not reported here, but when the
+ * transaction is accepted. cs_main is not held while reading the coins or
+ * verifying the scripts, only while creating the checks.
+ */
+static void PrepareMempoolBatch(const std::vector<CTransactionRef>& txs, const CTxMemPool& pool, CChainState& active_chainstate) LOCKS_EXCLUDED(cs_main)
+{
+    const CCoinsView* coins_db;
+    uint64_t db_write_count;
+    {
+        LOCK(cs_main);
+        coins_db = &active_chainstate.CoinsErrorCatcher();
+        db_write_count = active_chainstate.CoinsDB().WriteCount();
+    }
+    CoinsPrefetchStats stats;
+    const std::vector<COutPoint> outpoints = GetPrevoutsToFetch(txs, nullptr, stats);
+    std::vector<Coin> coins;
+    ReadCoins(*coins_db, outpoints, coins);
+
+    // The checks refer to the precomputed data, which has to outlive them.
+    std::vector<PrecomputedTransactionData> txdata(txs.size());
+    std::vector<CScriptCheck> checks;
+    {
+        LOCK2(cs_main, pool.cs);
+        CCoinsViewCache& coins_tip = active_chainstate.CoinsTip();
+        // If the database was written to meanwhile, the coins read may be
+        // stale, see BlockLookahead::AddCoins().
+        if (db_write_count == active_chainstate.CoinsDB().WriteCount()) {
+            for (size_t i = 0; i < outpoints.size(); ++i) {
+                if (!coins[i].IsSpent()) coins_tip.AddPrefetchedCoin(outpoints[i], std::move(coins[i]));
+            }
+        }
+        CCoinsViewMemPool view_mempool(&coins_tip, pool);
+        CCoinsViewCache view(&view_mempool);
+        for (size_t i = 0; i < txs.size(); ++i) {
+            const CTransaction& tx = *txs[i];
+            if (tx.IsCoinBase() || !view.HaveInputs(tx)) continue;
+            TxValidationState state;
+            CheckInputScripts(tx, state, view, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, txdata[i], &checks);
+            // Later transactions in the batch may spend the outputs of this one.
+            AddCoins(view, tx, MEMPOOL_HEIGHT);
+        }
+    }
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(checks);
+    control.Wait();
+}
+
 bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mockable_fopen_function)
 {
     const CChainParams& chainparams = Params();
@@ -4552,23 +5359,66 @@ bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mocka
         if (version != MEMPOOL_DUMP_VERSION) {
             return false;
         }
-        uint64_t num;
-        file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+        // Read the whole file first, so that the transactions can be prepared
+        // for acceptance in bulk.
+        std::vector<MempoolDumpEntry> entries;
+        std::map<uint256, CAmount> mapDeltas;
+        std::set<uint256> unbroadcast_txids;
+        // When the file turns out to be truncated or corrupt, the transactions
+        // read up to that point are still loaded, together with their fee
+        // deltas, as if they had been accepted while reading.
+        bool read_ok = true;
+        try {
+            uint64_t num;
+            file >> num;
+            while (num--) {
+                CTransactionRef tx;
+                int64_t nTime;
+                int64_t nFeeDelta;
+                file >> tx;
+                file >> nTime;
+                file >> nFeeDelta;
+
+                CAmount amountdelta = nFeeDelta;
+                if (amountdelta) {
+                    pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+                }
+                if (nTime > nNow - nExpiryTimeout) {
+                    entries.push_back({std::move(tx), nTime});
+                } else {
+                    ++expired;
+                }
+                if (ShutdownRequested())
+                    return false;
+            }
+            file >> mapDeltas;
+            file >> unbroadcast_txids;
+        } catch (const std::exception& e) {
+            LogPrintf("Failed to deserialize mempool data on disk: %s. Loading the %u transactions read before the error.\n", e.what(), entries.size());
+            read_ok = false;
+        }
+
+        SortTopologically(entries);
+
+        // Accept the transactions in batches. Before each batch, warm the
+        // coins cache with its inputs and verify its scripts using the worker
+        // threads, so that the accepts themselves mostly hit caches.
+        const std::string progress_title = _("Loading mempool…").translated;
+        uiInterface.ShowProgress(progress_title, 0, false);
+        for (size_t batch_start = 0; batch_start < entries.size(); batch_start += MEMPOOL_LOAD_BATCH_SIZE) {
+            const size_t batch_end = std::min(entries.size(), batch_start + MEMPOOL_LOAD_BATCH_SIZE);
+            if (scriptcheckqueue.HasWorkerThreads()) {
+                std::vector<CTransactionRef> txs;
+                txs.reserve(batch_end - batch_start);
+                for (size_t i = batch_start; i < batch_end; ++i) {
+                    txs.push_back(entries[i].tx);
+                }
+                PrepareMempoolBatch(txs, pool, active_chainstate);
             }
-            if (nTime > nNow - nExpiryTimeout) {
+            for (size_t i = batch_start; i < batch_end; ++i) {
+                const CTransactionRef& tx = entries[i].tx;
                 LOCK(cs_main);
-                if (AcceptToMemoryPoolWithTime(chainparams, pool, active_chainstate, tx, nTime, false /* bypass_limits */,
+                if (AcceptToMemoryPoolWithTime(chainparams, pool, active_chainstate, tx, entries[i].time, false /* bypass_limits */,
                                                false /* test_accept */).m_result_type == MempoolAcceptResult::ResultType::VALID) {
                     ++count;
                 } else {
@@ -4582,27 +5432,29 @@ bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mocka
                         ++failed;
                     }
                 }
-            } else {
-                ++expired;
+                if (ShutdownRequested()) {
+                    uiInterface.ShowProgress("", 100, false);
+                    return false;
+                }
             }
-            if (ShutdownRequested())
-                return false;
+            uiInterface.ShowProgress(progress_title, (int)(batch_end * 100 / entries.size()), false);
         }
-        std::map<uint256, CAmount> mapDeltas;
-        file >> mapDeltas;
+        uiInterface.ShowProgress("", 100, false);
 
         for (const auto& i : mapDeltas) {
             pool.PrioritiseTransaction(i.first, i.second);
         }
 
-        std::set<uint256> unbroadcast_txids;
-        file >> unbroadcast_txids;
         unbroadcast = unbroadcast_txids.size();
         for (const auto& txid : unbroadcast_txids) {
             // Ensure transactions were accepted to mempool then add to
             // unbroadcast set.
             if (pool.get(txid) != nullptr) pool.AddUnbroadcastTx(txid);
         }
+        if (!read_ok) {
+            LogPrintf("Imported mempool transactions from incomplete file: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
+            return false;
+        }
     } catch (const std::exception& e) {
         LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
         return false;
@@ -4755,7 +5607,8 @@ const AssumeutxoData* ExpectedAssumeutxo(
 bool ChainstateManager::ActivateSnapshot(
         CAutoFile& coins_file,
         const SnapshotMetadata& metadata,
-        bool in_memory)
+        bool in_memory,
+        SnapshotLoadStats* stats)
 {
     uint256 base_blockhash = metadata.m_base_blockhash;
 
@@ -4808,8 +5661,10 @@ bool ChainstateManager::ActivateSnapshot(
             static_cast<size_t>(current_coinstip_cache_size * SNAPSHOT_CACHE_PERC));
     }
 
+    SnapshotLoadStats load_stats;
     const bool snapshot_ok = this->PopulateAndValidateSnapshot(
-        *snapshot_chainstate, coins_file, metadata);
+        *snapshot_chainstate, coins_file, metadata, load_stats);
+    if (stats) *stats = load_stats;
 
     if (!snapshot_ok) {
         WITH_LOCK(::cs_main, this->MaybeRebalanceCaches());
@@ -4824,6 +5679,7 @@ bool ChainstateManager::ActivateSnapshot(
         assert(chaintip_loaded);
 
         m_active_chainstate = m_snapshot_chainstate.get();
+        if (m_ibd_chainstate) m_ibd_chainstate->m_validates_in_background = true;
 
         LogPrintf("[snapshot] successfully activated snapshot %s\n", base_blockhash.ToString());
         LogPrintf("[snapshot] (%.2f MB)\n",
@@ -4834,10 +5690,104 @@ bool ChainstateManager::ActivateSnapshot(
     return true;
 }
 
+namespace {
+/**
+ * Deserializes the coins of a UTXO snapshot on a dedicated thread and hands
+ * them out in batches, so that reading and decoding the file overlaps with
+ * populating the coins cache.
+ */
+class SnapshotCoinsReader
+{
+public:
+    using Batch = std::vector<std::pair<COutPoint, Coin>>;
+
+    //! Number of coins per batch handed out by Next().
+    static constexpr size_t BATCH_SIZE{10000};
+    //! Number of decoded batches the reader may run ahead of the consumer.
+    static constexpr size_t MAX_QUEUED_BATCHES{8};
+
+    SnapshotCoinsReader(CAutoFile& coins_file, uint64_t coins_count)
+        : m_coins_file(coins_file), m_coins_count(coins_count)
+    {
+        m_thread = std::thread(&util::TraceThread, "loadsnapshot", [this] { ThreadRead(); });
+    }
+
+    ~SnapshotCoinsReader()
+    {
+        WITH_LOCK(m_mutex, m_interrupt = true);
+        m_cv.notify_all();
+        m_thread.join();
+    }
+
+    /**
+     * Wait for the next batch of coins. Returns false once the reader stopped,
+     * either because all coins were read or because the file could not be
+     * deserialized any further.
+     */
+    bool Next(Batch& batch) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return !m_batches.empty() || m_done; });
+            if (m_batches.empty()) return false;
+            batch = std::move(m_batches.front());
+            m_batches.pop_front();
+        }
+        m_cv.notify_all();
+        return true;
+    }
+
+private:
+    void ThreadRead() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        uint64_t coins_left{m_coins_count};
+        bool failed{false};
+        while (coins_left > 0 && !failed) {
+            Batch batch;
+            const size_t batch_size = std::min<uint64_t>(coins_left, BATCH_SIZE);
+            batch.reserve(batch_size);
+            try {
+                while (batch.size() < batch_size) {
+                    auto& [outpoint, coin] = batch.emplace_back();
+                    m_coins_file >> outpoint;
+                    m_coins_file >> coin;
+                }
+            } catch (const std::ios_base::failure&) {
+                batch.pop_back();
+                failed = true;
+            }
+            coins_left -= batch.size();
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_interrupt || m_batches.size() < MAX_QUEUED_BATCHES; });
+                if (m_interrupt) return;
+                m_batches.push_back(std::move(batch));
+            }
+            m_cv.notify_all();
+        }
+        WITH_LOCK(m_mutex, m_done = true);
+        m_cv.notify_all();
+    }
+
+    CAutoFile& m_coins_file;
+    const uint64_t m_coins_count;
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Batch> m_batches GUARDED_BY(m_mutex);
+    //! Set by the reader once it will not queue any more batches.
+    bool m_done GUARDED_BY(m_mutex){false};
+    //! Set when the consumer goes away before all coins were read.
+    bool m_interrupt GUARDED_BY(m_mutex){false};
+    std::thread m_thread;
+};
+} // namespace
+
 bool ChainstateManager::PopulateAndValidateSnapshot(
     CChainState& snapshot_chainstate,
     CAutoFile& coins_file,
-    const SnapshotMetadata& metadata)
+    const SnapshotMetadata& metadata,
+    SnapshotLoadStats& load_stats)
 {
     // It's okay to release cs_main before we're done using `coins_cache` because we know
     // that nothing else will be referencing the newly created snapshot_chainstate yet.
@@ -4866,23 +5816,34 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     const AssumeutxoData& au_data = *maybe_au_data;
 
     COutPoint outpoint;
-    Coin coin;
     const uint64_t coins_count = metadata.m_coins_count;
     uint64_t coins_left = metadata.m_coins_count;
 
     LogPrintf("[snapshot] loading coins from snapshot %s\n", base_blockhash.ToString());
     int64_t flush_now{0};
     int64_t coins_processed{0};
+    const auto load_start{GetTime<std::chrono::microseconds>()};
+
+    std::optional<SnapshotCoinsReader> reader;
+    reader.emplace(coins_file, coins_count);
+    SnapshotCoinsReader::Batch batch;
+    size_t batch_pos{0};
 
     while (coins_left > 0) {
-        try {
-            coins_file >> outpoint;
-            coins_file >> coin;
-        } catch (const std::ios_base::failure&) {
-            LogPrintf("[snapshot] bad snapshot format or truncated snapshot after deserializing %d coins\n",
-                      coins_count - coins_left);
-            return false;
+        if (batch_pos == batch.size()) {
+            load_stats.peak_cache_usage = std::max(load_stats.peak_cache_usage, coins_cache.DynamicMemoryUsage());
+            batch_pos = 0;
+            if (!reader->Next(batch)) {
+                LogPrintf("[snapshot] bad snapshot format or truncated snapshot after deserializing %d coins\n",
+                          coins_count - coins_left);
+                return false;
+            }
+            if (batch.empty()) continue;
         }
+        outpoint = batch[batch_pos].first;
+        Coin& coin = batch[batch_pos].second;
+        ++batch_pos;
+
         if (coin.nHeight > base_height ||
             outpoint.n >= std::numeric_limits<decltype(outpoint.n)>::max() // Avoid integer wrap-around in coinstats.cpp:ApplyHash
         ) {
@@ -4931,6 +5892,10 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
             }
         }
     }
+    // Wait for the reader thread to exit before accessing coins_file again below.
+    reader.reset();
+    load_stats.peak_cache_usage = std::max(load_stats.peak_cache_usage, coins_cache.DynamicMemoryUsage());
+    load_stats.coins_loaded = coins_count;
 
     // Important that we set this. This and the coins_cache accesses above are
     // sort of a layer violation, but either we reach into the innards of
@@ -4960,6 +5925,7 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     LogPrintf("[snapshot] flushing snapshot chainstate to disk\n");
     // No need to acquire cs_main since this chainstate isn't being used yet.
     coins_cache.Flush(); // TODO: if #17487 is merged, add erase=false here for better performance.
+    load_stats.load_time = GetTime<std::chrono::microseconds>() - load_start;
 
     assert(coins_cache.GetBestBlock() == base_blockhash);
 
@@ -5064,6 +6030,83 @@ void ChainstateManager::Reset()
     m_snapshot_validated = false;
 }
 
+void ChainstateManager::StartBackgroundValidation()
+{
+    LOCK(m_background_validation_mutex);
+    if (m_background_validation_thread.joinable()) return;
+    if (m_background_script_threads > 0) {
+        bgscriptcheckqueue.StartWorkerThreads(m_background_script_threads, "bgscriptch");
+    }
+    m_background_validation_interrupt.reset();
+    m_background_validation_thread = std::thread(&util::TraceThread, "bgvalidation", [this] { ThreadBackgroundValidation(); });
+}
+
+void ChainstateManager::InterruptBackgroundValidation()
+{
+    m_background_validation_interrupt();
+}
+
+void ChainstateManager::StopBackgroundValidation()
+{
+    LOCK(m_background_validation_mutex);
+    if (!m_background_validation_thread.joinable()) return;
+    m_background_validation_thread.join();
+    bgscriptcheckqueue.StopWorkerThreads();
+}
+
+void ChainstateManager::ThreadBackgroundValidation()
+{
+    bool idle{false};
+    while (m_background_validation_interrupt.sleep_for(idle ? BACKGROUND_VALIDATION_IDLE_INTERVAL : BACKGROUND_VALIDATION_BACKOFF)) {
+        // Give way to the active chainstate while it processes blocks, and for a
+        // little while after, so that tip updates are not delayed.
+        idle = false;
+        if (m_active_block_processing > 0 ||
+            GetTimeMicros() - m_active_block_processed_time < count_microseconds(BACKGROUND_VALIDATION_BACKOFF)) {
+            continue;
+        }
+
+        CChainState* background{nullptr};
+        {
+            LOCK(::cs_main);
+            if (!m_snapshot_chainstate || !m_ibd_chainstate || m_snapshot_validated) {
+                // Nothing is left to validate in the background.
+                return;
+            }
+            CBlockIndex* snapshot_base{m_blockman.LookupBlockIndex(*m_snapshot_chainstate->m_from_snapshot_blockhash)};
+            const CBlockIndex* tip{m_ibd_chainstate->m_chain.Tip()};
+            if (!snapshot_base || !tip) {
+                idle = true;
+                continue;
+            }
+
+            // Only let the background chainstate connect a batch of blocks at a
+            // time, so that we get to check for active chainstate work in between.
+            CBlockIndex* target{nullptr};
+            const int last_height{std::min(snapshot_base->nHeight, tip->nHeight + BACKGROUND_VALIDATION_BATCH_BLOCKS)};
+            for (int height = tip->nHeight + 1; height <= last_height; ++height) {
+                CBlockIndex* pindex{snapshot_base->GetAncestor(height)};
+                // Like ReceivedBlockTransactions(), only consider blocks whose
+                // transactions, and those of all their ancestors, are stored.
+                if (!(pindex->nStatus & BLOCK_HAVE_DATA) || !pindex->IsValid(BLOCK_VALID_TRANSACTIONS) || pindex->nChainTx == 0) break;
+                target = pindex;
+            }
+            if (!target) {
+                idle = true;
+                continue;
+            }
+            background = m_ibd_chainstate.get();
+            background->setBlockIndexCandidates.insert(target);
+        }
+
+        BlockValidationState state;
+        if (!background->ActivateBestChain(state, nullptr)) {
+            LogPrintf("[snapshot] background validation failed to connect blocks (%s)\n", state.ToString());
+            idle = true;
+        }
+    }
+}
+
 void ChainstateManager::MaybeRebalanceCaches()
 {
     if (m_ibd_chainstate && !m_snapshot_chainstate) {
@@ -5080,16 +6123,17 @@ void ChainstateManager::MaybeRebalanceCaches()
         // If both chainstates exist, determine who needs more cache based on IBD status.
         //
         // Note: shrink caches first so that we don't inadvertently overwhelm available memory.
+        const double background_share = std::clamp(m_background_cache_percent, 1, 99) / 100.0;
         if (m_snapshot_chainstate->IsInitialBlockDownload()) {
             m_ibd_chainstate->ResizeCoinsCaches(
-                m_total_coinstip_cache * 0.05, m_total_coinsdb_cache * 0.05);
+                m_total_coinstip_cache * background_share, m_total_coinsdb_cache * background_share);
             m_snapshot_chainstate->ResizeCoinsCaches(
-                m_total_coinstip_cache * 0.95, m_total_coinsdb_cache * 0.95);
+                m_total_coinstip_cache * (1 - background_share), m_total_coinsdb_cache * (1 - background_share));
         } else {
             m_snapshot_chainstate->ResizeCoinsCaches(
-                m_total_coinstip_cache * 0.05, m_total_coinsdb_cache * 0.05);
+                m_total_coinstip_cache * background_share, m_total_coinsdb_cache * background_share);
             m_ibd_chainstate->ResizeCoinsCaches(
-                m_total_coinstip_cache * 0.95, m_total_coinsdb_cache * 0.95);
+                m_total_coinstip_cache * (1 - background_share), m_total_coinsdb_cache * (1 - background_share));
         }
     }
 }
@@ -12,6 +12,7 @@
 
 #include <amount.h>
 #include <attributes.h>
+#include <chain.h>
 #include <coins.h>
 #include <consensus/validation.h>
 #include <crypto/common.h> // for ReadLE64
@@ -22,15 +23,19 @@
 #include <protocol.h> // For CMessageHeader::MessageStartChars
 #include <script/script_error.h>
 #include <sync.h>
+#include <threadinterrupt.h>
 #include <txmempool.h> // For CTxMemPool::cs
 #include <txdb.h>
 #include <versionbits.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <util/check.h>
 #include <util/hasher.h>
 #include <util/translation.h>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <optional>
@@ -43,6 +48,7 @@
 
 class CChainState;
 class BlockValidationState;
+class BlockLookahead;
 class CBlockIndex;
 class CBlockTreeDB;
 class CBlockUndo;
@@ -51,6 +57,7 @@ struct CCheckpointData;
 class CInv;
 class CConnman;
 class CScriptCheck;
+struct SigCacheCounters;
 class CTxMemPool;
 class ChainstateManager;
 struct ChainTxData;
@@ -76,6 +83,10 @@ static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 336;
 static const int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** -bgpar default (number of script-checking threads used by background validation of a UTXO snapshot) */
+static const int DEFAULT_BACKGROUND_SCRIPTCHECK_THREADS = 2;
+/** -bgdbcache default (percentage of the coins caches given to background validation while the snapshot chainstate syncs) */
+static const int DEFAULT_BACKGROUND_DBCACHE_PERCENT = 5;
 static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
@@ -107,7 +118,23 @@ enum class SynchronizationState {
 };
 
 extern RecursiveMutex cs_main;
-typedef std::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
+/**
+ * The block index entries are stored in the map nodes themselves, next to
+ * the hash phashBlock points to, and the nodes are allocated from a pool so
+ * the index is packed densely into large chunks of memory instead of a heap
+ * allocation for the node plus one for the CBlockIndex. Nodes never move, so
+ * pointers to entries stay valid until they are erased.
+ *
+ * As for CCoinsMap, the size of 4 pointers is added to MAX_BLOCK_SIZE_BYTES
+ * to account for the implementation defined node overhead.
+ */
+using BlockMap = std::unordered_map<uint256,
+                                    CBlockIndex,
+                                    BlockHasher,
+                                    std::equal_to<uint256>,
+                                    PoolAllocator<std::pair<const uint256, CBlockIndex>,
+                                                  sizeof(std::pair<const uint256, CBlockIndex>) + sizeof(void*) * 4>>;
+using BlockMapMemoryResource = BlockMap::allocator_type::ResourceType;
 extern Mutex g_best_block_mutex;
 extern std::condition_variable g_best_block_cv;
 extern uint256 g_best_block;
@@ -137,9 +164,9 @@ extern const std::vector<std::string> CHECKLEVEL_DOC;
 
 /** Unload database information */
 void UnloadBlockIndex(CTxMemPool* mempool, ChainstateManager& chainman);
-/** Run instances of script checking worker threads */
+/** Run instances of script checking (and coins prefetching) worker threads */
 void StartScriptCheckWorkerThreads(int threads_num);
-/** Stop all of the script checking worker threads */
+/** Stop all of the script checking (and coins prefetching) worker threads */
 void StopScriptCheckWorkerThreads();
 /**
  * Return transaction from the block at block_index.
@@ -330,6 +357,106 @@ public:
 
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
+/** Get the counters of the script-execution cache. */
+SigCacheCounters GetScriptExecutionCacheCounters() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/** Save the salt and the entries of the script-execution cache to a file. */
+bool DumpScriptExecutionCache(const fs::path& path) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/**
+ * Replace the salt of the script-execution cache with the one saved by
+ * DumpScriptExecutionCache, and insert the saved entries. Should be called
+ * right after InitScriptExecutionCache.
+ */
+bool LoadScriptExecutionCache(const fs::path& path) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/** Statistics about warming a coins cache with the inputs of a block. */
+struct CoinsPrefetchStats {
+    //! Number of inputs spent by the block.
+    unsigned int inputs{0};
+    //! Inputs spending an output created earlier in the same block.
+    unsigned int in_block{0};
+    //! Inputs that were already present in the cache.
+    unsigned int cached{0};
+    //! Inputs read from the backing view and added to the cache.
+    unsigned int fetched{0};
+    //! Wall-clock time spent prefetching, in microseconds.
+    int64_t time{0};
+    //! Sum of the time spent in individual backing view reads, in microseconds.
+    //! This approximates how long the same reads take when done serially.
+    int64_t read_time{0};
+};
+
+/**
+ * Read the coins spent by a block that are missing from a cache from the
+ * cache's backing view, using the coins prefetch worker threads, and add them
+ * to the cache so ConnectBlock() does not have to do the reads one by one.
+ *
+ * @param[in]     block  The block whose inputs to prefetch
+ * @param[in,out] cache  The cache to warm
+ * @param[in]     base   The view backing cache; must be safe for concurrent reads
+ */
+CoinsPrefetchStats PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base);
+
+/** A block read from a block file, ahead of it being imported. */
+struct ExternalBlock {
+    std::shared_ptr<const CBlock> block;
+    uint256 hash;
+    //! Position of the block in the block files.
+    FlatFilePos pos;
+    //! Serialized size of the block, reserved in g_external_block_budget
+    //! until the block is imported.
+    size_t size;
+};
+
+/**
+ * Memory budget for blocks read from block files and held in memory until
+ * they can be imported: those read ahead of the block file being imported
+ * during -reindex, and out-of-order blocks whose parent is not known yet.
+ */
+class ExternalBlockBudget
+{
+public:
+    static constexpr size_t MAX_BYTES{64 << 20};
+
+    /** Reserve bytes if they fit in the budget. */
+    bool TryReserve(size_t bytes) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /**
+     * Reserve bytes for a block of a block file read ahead, waiting for them
+     * to fit in the budget. Blocks of the next file to be imported never
+     * wait, so that importing always makes progress.
+     *
+     * @returns false if reading ahead was stopped
+     */
+    bool Reserve(size_t bytes, int file_number) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    void Release(size_t bytes) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Start reading ahead, with file_number being the next file to be imported. */
+    void StartReadAhead(int file_number) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Set the next file to be imported, once the previous one was. */
+    void SetNextFile(int file_number) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Stop reading ahead, and wake up the readers waiting for the budget. */
+    void StopReadAhead() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    size_t m_bytes GUARDED_BY(m_mutex){0};
+    int m_next_file GUARDED_BY(m_mutex){0};
+    bool m_reading_ahead GUARDED_BY(m_mutex){false};
+};
+
+extern ExternalBlockBudget g_external_block_budget;
+
+/**
+ * Read all blocks from a block file (blk?????.dat), and run the context-free
+ * checks (proof of work, merkle root, transactions) on them. The results are
+ * cached in the blocks, so importing them does not repeat the checks.
+ *
+ * Unlike importing, this does not depend on the chainstate and can be done
+ * for several block files at once. The blocks read are reserved in
+ * g_external_block_budget, waiting for it as needed; reading stops early if
+ * reading ahead is stopped. Takes over file and closes it.
+ */
+std::vector<ExternalBlock> ReadExternalBlockFile(FILE* file, int file_number, const CChainParams& params);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -422,8 +549,11 @@ private:
      */
     void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight, int chain_tip_height, int prune_height, bool is_ibd);
 
+    //! Chunks of memory the block index entries are allocated from.
+    BlockMapMemoryResource m_block_index_memory_resource;
+
 public:
-    BlockMap m_block_index GUARDED_BY(cs_main);
+    BlockMap m_block_index GUARDED_BY(cs_main){0, BlockHasher{}, BlockMap::key_equal{}, &m_block_index_memory_resource};
 
     /** In order to efficiently track invalidity of headers, we keep the set of
       * blocks which we tried to connect and found to be invalid here (ie which
@@ -485,7 +615,8 @@ public:
         const CChainParams& chainparams,
         CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    CBlockIndex* LookupBlockIndex(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    CBlockIndex* LookupBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    const CBlockIndex* LookupBlockIndex(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     /** Find the last common block between the parameter chain and a locator. */
     CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -640,6 +771,11 @@ public:
      */
     const std::optional<uint256> m_from_snapshot_blockhash;
 
+    //! Whether this chainstate validates the chain history below an active
+    //! snapshot chainstate in the background. Its blocks are then connected by
+    //! the background validation thread using separate script check workers.
+    bool m_validates_in_background GUARDED_BY(::cs_main){false};
+
     /**
      * The set of all CBlockIndex entries with BLOCK_VALID_TRANSACTIONS (for itself and all ancestors) and
      * as good as our current tip or better. Entries may be failed, though, and pruning nodes may be
@@ -684,6 +820,9 @@ public:
     /** Import blocks from an external file */
     void LoadExternalBlockFile(FILE* fileIn, FlatFilePos* dbp = nullptr);
 
+    /** Import the blocks of a block file read by ReadExternalBlockFile() */
+    void LoadExternalBlocks(const std::vector<ExternalBlock>& blocks);
+
     /**
      * Update the on-disk chain state.
      * The caches and indexes are flushed depending on the mode we're called with
@@ -789,13 +928,20 @@ public:
     std::string ToString() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
 private:
-    bool ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool.cs);
+    bool ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace, BlockLookahead* lookahead) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool.cs);
     bool ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool.cs);
 
     void InvalidBlockFound(CBlockIndex* pindex, const BlockValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pindexNew, const FlatFilePos& pos) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Import one block read from a block file, followed by the blocks read
+     * earlier that were waiting for it as their parent.
+     * @returns false if importing should stop
+     */
+    bool ProcessExternalBlock(const std::shared_ptr<const CBlock>& pblock, const uint256& hash, const FlatFilePos* dbp, int& nLoaded);
+
     bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     void CheckForkWarningConditions() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -806,6 +952,17 @@ private:
     friend ChainstateManager;
 };
 
+/** Statistics about loading the coins of a UTXO snapshot. */
+struct SnapshotLoadStats {
+    //! Number of coins read from the snapshot file.
+    uint64_t coins_loaded{0};
+    //! Time spent reading the coins into the coins cache and flushing them to
+    //! disk, excluding the validation of the resulting UTXO set hash.
+    std::chrono::microseconds load_time{0};
+    //! Highest memory usage of the snapshot coins cache during the load.
+    size_t peak_cache_usage{0};
+};
+
 /**
  * Provides an interface for creating and interacting with one or two
  * chainstates: an IBD chainstate generated by downloading blocks, and
@@ -889,7 +1046,25 @@ private:
     [[nodiscard]] bool PopulateAndValidateSnapshot(
         CChainState& snapshot_chainstate,
         CAutoFile& coins_file,
-        const SnapshotMetadata& metadata);
+        const SnapshotMetadata& metadata,
+        SnapshotLoadStats& load_stats);
+
+    //! Number of blocks being processed for the active chainstate right now.
+    std::atomic<int> m_active_block_processing{0};
+    //! Time (in microseconds) the active chainstate last finished processing a block.
+    std::atomic<int64_t> m_active_block_processed_time{0};
+
+    //! Guards starting and stopping the background validation thread, which
+    //! happen on the RPC and shutdown threads respectively.
+    Mutex m_background_validation_mutex;
+    CThreadInterrupt m_background_validation_interrupt;
+    std::thread m_background_validation_thread GUARDED_BY(m_background_validation_mutex);
+
+    //! Connect the blocks of the background chainstate towards the base of the
+    //! snapshot in small batches, backing off while the active chainstate is busy.
+    void ThreadBackgroundValidation();
+
+    friend class ActiveBlockProcessing;
 
 public:
     std::thread m_load_block;
@@ -931,8 +1106,12 @@ public:
     //!   faking nTx* block index data along the way.
     //! - Move the new chainstate to `m_snapshot_chainstate` and make it our
     //!   ChainstateActive().
+    //!
+    //! Coins are deserialized on a separate thread while being added to the
+    //! coins cache. If `stats` is given, it is filled with load statistics.
     [[nodiscard]] bool ActivateSnapshot(
-        CAutoFile& coins_file, const SnapshotMetadata& metadata, bool in_memory);
+        CAutoFile& coins_file, const SnapshotMetadata& metadata, bool in_memory,
+        SnapshotLoadStats* stats = nullptr);
 
     //! The most-work chain.
     CChainState& ActiveChainstate() const;
@@ -1010,11 +1189,30 @@ public:
     //! Clear (deconstruct) chainstate data.
     void Reset();
 
+    //! Share of the coins caches, in percent, given to the background chainstate
+    //! while the snapshot chainstate is syncing. The split is reversed once the
+    //! snapshot chainstate has caught up.
+    int m_background_cache_percent{DEFAULT_BACKGROUND_DBCACHE_PERCENT};
+
     //! Check to see if caches are out of balance and if so, call
     //! ResizeCoinsCaches() as needed.
     void MaybeRebalanceCaches() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
+    //! Number of script checking worker threads used for background
+    //! validation, in addition to the thread connecting the blocks (-bgpar).
+    int m_background_script_threads{0};
+
+    //! Start the thread validating the chain history of the loaded snapshot
+    //! chainstate in the background, and its script checking worker threads.
+    //! The thread exits once the snapshot is validated.
+    void StartBackgroundValidation() EXCLUSIVE_LOCKS_REQUIRED(!m_background_validation_mutex);
+    //! Interrupt the background validation thread; call StopBackgroundValidation() to join it.
+    void InterruptBackgroundValidation();
+    void StopBackgroundValidation() EXCLUSIVE_LOCKS_REQUIRED(!m_background_validation_mutex);
+
     ~ChainstateManager() {
+        InterruptBackgroundValidation();
+        StopBackgroundValidation();
         LOCK(::cs_main);
         UnloadBlockIndex(/* mempool */ nullptr, *this);
         Reset();
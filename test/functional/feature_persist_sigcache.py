@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test persisting the signature cache and the script execution cache.
+
+With -persistsigcache, bitcoind saves both caches to sigcache.dat and
+scriptcache.dat on shutdown and loads them on startup, so that transactions
+validated while they were in the mempool need not be validated again when
+they are mined after a restart.
+"""
+import os
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+from test_framework.wallet import MiniWallet, MiniWalletMode
+
+
+class PersistSigCacheTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        # Don't reload the mempool, which would fill the caches again.
+        self.extra_args = [["-persistsigcache", "-persistmempool=0"]]
+
+    def run_test(self):
+        node = self.nodes[0]
+        sigcache = os.path.join(node.datadir, self.chain, "sigcache.dat")
+        scriptcache = os.path.join(node.datadir, self.chain, "scriptcache.dat")
+
+        wallet = MiniWallet(node, mode=MiniWalletMode.RAW_P2PK)
+        wallet.generate(3)
+        node.generate(100)
+
+        self.log.info("Validate three transactions spending signed outputs")
+        for _ in range(3):
+            wallet.send_self_transfer(from_node=node)
+        assert_equal(len(node.getrawmempool()), 3)
+
+        self.log.info("Check that the caches are saved on shutdown and loaded on startup")
+        with node.assert_debug_log(expected_msgs=[
+            "Dumped 3 signature cache entries",
+            "Dumped 3 script execution cache entries",
+        ]):
+            self.stop_node(0)
+        assert os.path.isfile(sigcache)
+        assert os.path.isfile(scriptcache)
+        with node.assert_debug_log(expected_msgs=[
+            "Loaded 3 signature cache entries from disk",
+            "Loaded 3 script execution cache entries from disk",
+        ]):
+            self.start_node(0)
+        assert_equal(len(node.getrawmempool()), 0)
+
+        self.log.info("Check that -persistsigcache=0 neither loads nor overwrites the saved caches")
+        self.restart_node(0, extra_args=["-persistsigcache=0", "-persistmempool=0"])
+        with node.assert_debug_log(expected_msgs=[], unexpected_msgs=["cache entries"]):
+            self.restart_node(0, extra_args=["-persistsigcache=0", "-persistmempool=0"])
+        with node.assert_debug_log(expected_msgs=["Loaded 3 signature cache entries from disk"]):
+            self.restart_node(0)
+
+
+if __name__ == '__main__':
+    PersistSigCacheTest().main()
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the getmempoolchanges RPC and the /rest/mempool/changes endpoint.
+
+A client that starts from getrawmempool's mempool_sequence and applies the
+added and removed txids of each result must end up with the mempool's txids,
+across transaction acceptance, block connection and reorgs.
+"""
+
+import http.client
+import json
+import urllib.parse
+
+from test_framework.blocktools import COINBASE_MATURITY
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+)
+from test_framework.wallet import MiniWallet
+
+
+class MempoolChangesTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [["-rest"]]
+
+    def rest_changes(self, sequence, status=200):
+        url = urllib.parse.urlparse(self.nodes[0].url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', f'/rest/mempool/changes/{sequence}.json')
+        resp = conn.getresponse()
+        assert_equal(resp.status, status)
+        if status == 200:
+            return json.loads(resp.read().decode('utf-8'))
+
+    def get_changes(self, sequence):
+        changes = self.nodes[0].getmempoolchanges(sequence)
+        assert_equal(self.rest_changes(sequence), changes)
+        return changes
+
+    def sync_mirror(self):
+        """Apply the changes since the last sync to the mirrored txids and
+        check them against the mempool."""
+        changes = self.get_changes(self.sequence)
+        self.mirror -= set(changes['removed'])
+        self.mirror |= set(changes['added'])
+        self.sequence = changes['mempool_sequence']
+        assert_equal(self.mirror, set(self.nodes[0].getrawmempool()))
+        return changes
+
+    def run_test(self):
+        node = self.nodes[0]
+        wallet = MiniWallet(node)
+        wallet.generate(5)
+        node.generate(COINBASE_MATURITY)
+
+        self.log.info("Start mirroring from getrawmempool")
+        snapshot = node.getrawmempool(False, True)
+        self.mirror = set(snapshot['txids'])
+        self.sequence = snapshot['mempool_sequence']
+        start = self.sequence
+        assert_equal(self.get_changes(start), {'mempool_sequence': start, 'added': [], 'removed': []})
+
+        self.log.info("Added transactions are reported in order")
+        parent = wallet.send_self_transfer(from_node=node)['txid']
+        child = wallet.send_self_transfer(from_node=node, utxo_to_spend=wallet.get_utxo(txid=parent))['txid']
+        other = wallet.send_self_transfer(from_node=node)['txid']
+        changes = self.sync_mirror()
+        assert_equal(changes['added'], [parent, child, other])
+        assert_equal(changes['removed'], [])
+
+        self.log.info("Transactions mined in a block are reported as removed")
+        block = node.generate(1)[0]
+        changes = self.sync_mirror()
+        assert_equal(changes['added'], [])
+        assert_equal(set(changes['removed']), {parent, child, other})
+        # Since the start, the transactions were added and removed again.
+        assert_equal(self.get_changes(start)['added'], [])
+        assert_equal(self.get_changes(start)['removed'], [])
+
+        self.log.info("Transactions returned to the mempool by a reorg are reported as added")
+        node.invalidateblock(block)
+        changes = self.sync_mirror()
+        assert_equal(set(changes['added']), {parent, child, other})
+        assert_equal(changes['removed'], [])
+        assert_equal(self.get_changes(start)['added'], changes['added'])
+
+        self.log.info("Sequence numbers in the future are rejected")
+        assert_raises_rpc_error(-8, "Mempool changes since this sequence are not available", node.getmempoolchanges, self.sequence + 1)
+        assert_raises_rpc_error(-8, "Negative mempool sequence", node.getmempoolchanges, -1)
+        self.rest_changes(self.sequence + 1, status=404)
+        self.rest_changes('x', status=400)
+
+
+if __name__ == '__main__':
+    MempoolChangesTest().main()
@@ -2,7 +2,8 @@
 # Copyright (c) 2019-2020 The Bitcoin Core developers
 # Distributed under the MIT software license, see the accompanying
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
-"""Test the generation of UTXO snapshots using `dumptxoutset`.
+"""Test the generation of UTXO snapshots using `dumptxoutset`, and the
+rejection of snapshots that can't be loaded using `loadtxoutset`.
 """
 
 from test_framework.blocktools import COINBASE_MATURITY
@@ -49,5 +50,13 @@ class DumptxoutsetTest(BitcoinTestFramework):
         assert_raises_rpc_error(
             -8, '{} already exists'.format(FILENAME),  node.dumptxoutset, FILENAME)
 
+        self.log.info("Test that loadtxoutset rejects snapshots it can't load")
+        assert_raises_rpc_error(
+            -8, "Couldn't open file", node.loadtxoutset, 'missing.dat')
+        # No assumeutxo hash is configured for height 100.
+        assert_raises_rpc_error(
+            -32603, 'Unable to load UTXO snapshot', node.loadtxoutset, FILENAME)
+        assert_equal(node.getblockcount(), 100)
+
 if __name__ == '__main__':
     DumptxoutsetTest().main()
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+# Copyright (c) 2021 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the getsigcacheinfo RPC."""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+from test_framework.wallet import MiniWallet, MiniWalletMode
+
+
+class GetSigCacheInfoTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [["-maxsigcachesize=4"]]
+
+    def run_test(self):
+        node = self.nodes[0]
+        wallet = MiniWallet(node, mode=MiniWalletMode.RAW_P2PK)
+        wallet.generate(1)
+        node.generate(100)
+
+        info = node.getsigcacheinfo()
+        # Each cache gets half of the 4 MiB, in 32-byte entries.
+        assert_equal(info["signatures"]["max_entries"], 2 * 1024 * 1024 // 32)
+        assert_equal(info["scripts"]["max_entries"], 2 * 1024 * 1024 // 32)
+
+        self.log.info("Accepting a transaction to the mempool caches its signature and its scripts")
+        wallet.send_self_transfer(from_node=node)
+        after_tx = node.getsigcacheinfo()
+        assert_equal(after_tx["signatures"]["inserts"], info["signatures"]["inserts"] + 1)
+        assert_equal(after_tx["scripts"]["inserts"], info["scripts"]["inserts"] + 1)
+        assert after_tx["signatures"]["misses"] > info["signatures"]["misses"]
+        assert after_tx["scripts"]["misses"] > info["scripts"]["misses"]
+
+        self.log.info("Connecting a block with the transaction finds its scripts in the cache")
+        node.generate(1)
+        after_block = node.getsigcacheinfo()
+        # Once when checking the block template, and once when connecting it.
+        assert_equal(after_block["scripts"]["hits"], after_tx["scripts"]["hits"] + 2)
+        assert_equal(after_block["signatures"]["inserts"], after_tx["signatures"]["inserts"])
+
+
+if __name__ == '__main__':
+    GetSigCacheInfoTest().main()
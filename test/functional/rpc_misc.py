@@ -54,6 +54,13 @@ class RpcMiscTest(BitcoinTestFramework):
 
         assert_raises_rpc_error(-8, "unknown mode foobar", node.getmemoryinfo, mode="foobar")
 
+        self.log.info("test getstartupinfo")
+        startup = node.getstartupinfo()
+        steps = ['blockindex', 'chainstate', 'verify', 'indexes', 'wallets']
+        for step in steps:
+            assert_greater_than_or_equal(startup[step], 0)
+        assert_equal(startup['total'], sum(startup[step] for step in steps))
+
         self.log.info("test logging")
         assert_equal(node.logging()['qt'], True)
         node.logging(exclude=['qt'])